@@ -0,0 +1,182 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "pool.h"
+#include "tool.h"
+
+#include <settings.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+    uint32_t setting;
+    const char *value;
+} EDIT;
+
+typedef struct
+{
+    PATH_LIST files;
+    EDIT *edits;
+    size_t editCount;
+    bool dryRun;
+    atomic_size_t failed;
+    atomic_size_t changed;
+} APPLY_JOB;
+
+static void applyUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool apply [-j threads] [-n] [-l list] [-e name=value]... [file|dir]...\n\n"
+                    "  -e  Set an option, e.g. -e widescreen=on -e video_scale=104\n"
+                    "  -l  Read paths from a file, one per line (- for stdin)\n"
+                    "  -j  Worker threads (default: all cores)\n"
+                    "  -n  Dry run, check and report only\n\n"
+                    "Directories are searched for *.bin. Options:\n");
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+        fprintf(stderr, "  %s\n", settings[i].name);
+}
+
+static void applyFile(size_t index, unsigned int worker, void *ctx)
+{
+    APPLY_JOB *job = ctx;
+    const char *path = job->files.paths[index];
+    NIN_CFG raw, cfg;
+    char message[128];
+
+    const char *err = readConfigFile(path, &raw);
+    if(err == NULL)
+    {
+        NCFG_STATUS status = ncfgLoad(&cfg, &raw, sizeof(NIN_CFG));
+        if(status == NCFG_OK)
+        {
+            ncfgNormalize(&cfg);
+            // A file some edits can't be made to stays as it is
+            for(size_t i = 0; err == NULL && i < job->editCount; ++i)
+            {
+                if(!settingParse(&cfg, job->edits[i].setting, job->edits[i].value))
+                {
+                    snprintf(message, sizeof(message), "Can't set %s to \"%s\"", settings[job->edits[i].setting].name,
+                             job->edits[i].value);
+                    err = message;
+                }
+            }
+
+            ncfgSerialize(&cfg, &cfg);
+            if(err == NULL && memcmp(&cfg, &raw, sizeof(NIN_CFG)) != 0)
+            {
+                if(!job->dryRun)
+                    err = writeConfigFile(path, &cfg);
+                // Only what's on the card (or would be) counts
+                if(err == NULL)
+                    atomic_fetch_add_explicit(&job->changed, 1, memory_order_relaxed);
+            }
+        }
+        else
+            err = ncfgStatusStr(status);
+    }
+
+    if(err != NULL)
+    {
+        atomic_fetch_add_explicit(&job->failed, 1, memory_order_relaxed);
+        fprintf(stderr, "%s: %s\n", path, err);
+    }
+}
+
+int cmdApply(int argc, char *argv[])
+{
+    APPLY_JOB job = { 0 };
+    unsigned int threads = 0;
+    int ret = 1;
+    int opt;
+
+    job.edits = malloc(sizeof(EDIT) * argc);
+    if(job.edits == NULL)
+        return 1;
+
+    while((opt = getopt(argc, argv, "e:l:j:n")) != -1)
+    {
+        switch(opt)
+        {
+            case 'e':
+            {
+                char *value = strchr(optarg, '=');
+                int setting = -1;
+                if(value != NULL)
+                {
+                    *value++ = '\0';
+                    setting = settingFind(optarg);
+                }
+
+                // Catch typos before touching any file
+                NIN_CFG test = { 0 };
+                if(setting < 0 || !settingParse(&test, setting, value))
+                {
+                    fprintf(stderr, "Invalid edit: %s%s%s\n", optarg, value ? "=" : "", value ? value : "");
+                    goto out;
+                }
+
+                job.edits[job.editCount].setting = setting;
+                job.edits[job.editCount++].value = value;
+                break;
+            }
+            case 'l':
+                if(!pathListRead(&job.files, optarg))
+                    goto out;
+                break;
+            case 'j':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                job.dryRun = true;
+                break;
+            default:
+                applyUsage();
+                goto out;
+        }
+    }
+
+    for(int i = optind; i < argc; ++i)
+        if(!pathListCollect(&job.files, argv[i], ".bin"))
+            goto out;
+
+    if(job.files.count == 0)
+    {
+        applyUsage();
+        goto out;
+    }
+
+    uint64_t start = nanoTime();
+    poolRun(job.files.count, threads, applyFile, &job);
+    double elapsed = (nanoTime() - start) / 1e9;
+
+    size_t failed = atomic_load(&job.failed);
+    printf("%zu files, %zu failed, %zu %s in %.3f s (%.0f files/s, %.1f MB/s)\n",
+           job.files.count, failed, atomic_load(&job.changed), job.dryRun ? "would change" : "changed", elapsed,
+           job.files.count / elapsed, job.files.count * sizeof(NIN_CFG) / elapsed / (1024 * 1024));
+
+    ret = failed ? 2 : 0;
+
+out:
+    pathListFree(&job.files);
+    free(job.edits);
+    return ret;
+}
@@ -0,0 +1,939 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <games.h>
+#include <ini.h>
+#include <ncfg.h>
+#include <patch.h>
+#include <render.h>
+#include <settings.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_CONFIGS 4096
+#define DEFAULT_ROUNDS  2000
+#define LINE_LENGTH     80
+#define LABEL_WIDTH     24
+#define VALUE_COLUMN    (3 + LABEL_WIDTH + 1)
+#define RENDER_FRAMES   2000
+#define TV_WIDTH        1280
+#define TV_HEIGHT       720
+
+static uint32_t rngState = 0x4E494E43; // "NINC"
+
+static uint32_t rng()
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static uint64_t nanoTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Random but valid configs in on-disk format, so every iteration takes the full path
+static void generate(NIN_CFG *cfgs, size_t count)
+{
+    for(size_t i = 0; i < count; ++i)
+    {
+        NIN_CFG *cfg = cfgs + i;
+        memset(cfg, 0, sizeof(NIN_CFG));
+        cfg->Magicbytes = NCFG_MAGIC;
+        cfg->Version = NIN_CFG_VERSION;
+        cfg->Config = rng();
+        cfg->VideoMode = rng();
+        cfg->Language = rng() % (NIN_LAN_LAST + 1);
+        if(cfg->Language == NIN_LAN_LAST)
+            cfg->Language = NIN_LAN_AUTO;
+
+        snprintf(cfg->GamePath, sizeof(cfg->GamePath), "/games/%08X/game.iso", rng());
+        snprintf(cfg->CheatPath, sizeof(cfg->CheatPath), "/codes/%08X.gct", rng());
+        cfg->MaxPads = rng() % (NIN_CFG_MAXPAD + 1);
+        cfg->GameID = rng();
+        cfg->MemCardBlocks = rng() % (MEM_CARD_MAX + 1);
+        cfg->VideoScale = 40 + (rng() % 41) * 2;
+        cfg->VideoOffset = (int)(rng() % 41) - 20;
+        cfg->NetworkProfile = rng();
+        cfg->WiiUGamepadSlot = rng() % (NIN_CFG_MAXPAD + 1);
+
+        ncfgSerialize(cfg, cfg);
+    }
+}
+
+// A frame of settings rows the way the UI used to build them, printf for every row
+static void formatPrintf(const NIN_CFG *cfg, char lines[SETTINGS_COUNT][LINE_LENGTH])
+{
+    char value[SETTING_VALUE_SIZE];
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+    {
+        settingFormat(cfg, i, value);
+        snprintf(lines[i], LINE_LENGTH, "%s %-24s<%s>", i == 0 ? "->" : "  ", settings[i].label, value);
+    }
+}
+
+// And the way drawSetting() in main.c does it now, copying from the string pool into prebuilt rows
+static void formatPool(const NIN_CFG *cfg, char lines[SETTINGS_COUNT][LINE_LENGTH])
+{
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+    {
+        char *row = lines[i];
+        char value[SETTING_VALUE_SIZE];
+        size_t len;
+        const char *text = settingText(cfg, i, &len);
+        if(text == NULL)
+        {
+            settingFormat(cfg, i, value);
+            text = value;
+            len = strlen(value);
+        }
+
+        memcpy(row, i == 0 ? "->" : "  ", 2);
+        memcpy(row + VALUE_COLUMN, text, len);
+        row[VALUE_COLUMN + len] = '>';
+        row[VALUE_COLUMN + len + 1] = '\0';
+    }
+}
+
+static uint32_t readBE32(const void *data)
+{
+    const uint8_t *p = data;
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+#define CHECK_WORD(field) ok &= host->field == readBE32((const uint8_t *)raw + offsetof(NIN_CFG, field));
+#define CHECK_BYTES(field) ok &= memcmp(&host->field, &raw->field, sizeof(raw->field)) == 0;
+
+// Decodes raw byte by byte, so this holds on hosts of either byte order
+static bool matchesDisk(const NIN_CFG *host, const NIN_CFG *raw)
+{
+    bool ok = true;
+    NCFG_LAYOUT(CHECK_WORD, CHECK_BYTES)
+    return ok;
+}
+
+// The on-disk layout as fixed bytes, independent of CommonConfig.h, NCFG_LAYOUT and the host byte order:
+// where Nintendont on the console expects each field and how its value looks there
+static const struct
+{
+    uint16_t offset;
+    uint8_t size;
+    uint8_t bytes[4];
+} layoutBytes[] = {
+    { 0, 4, { 0x01, 0x07, 0x0C, 0xF6 } },   // Magicbytes
+    { 4, 4, { 0x00, 0x00, 0x00, 0x0A } },   // Version 10
+    { 8, 4, { 0x00, 0x02, 0x00, 0x08 } },   // Config: NIN_CFG_MEMCARDEMU | NIN_CFG_CC_RUMBLE
+    { 12, 4, { 0x00, 0x01, 0x00, 0x14 } },  // VideoMode: NIN_VID_FORCE | NIN_VID_PROG | NIN_VID_FORCE_NTSC
+    { 16, 4, { 0x00, 0x00, 0x00, 0x01 } },  // Language: German
+    { 20, 4, { '/', 'g', 'a', 'm' } },      // GamePath
+    { 275, 4, { '/', 'c', 'h', 't' } },     // CheatPath
+    { 532, 4, { 0x00, 0x00, 0x00, 0x04 } }, // MaxPads
+    { 536, 4, { 'G', 'A', 'L', 'E' } },     // GameID
+    { 540, 1, { 0x02 } },                   // MemCardBlocks
+    { 541, 1, { 0x78 } },                   // VideoScale 120
+    { 542, 1, { 0xFC } },                   // VideoOffset -4
+    { 543, 1, { 0x01 } },                   // NetworkProfile
+    { 544, 4, { 0x00, 0x00, 0x00, 0x01 } }, // WiiUGamepadSlot
+};
+
+// ncfgSerialize() has to put a config at exactly those bytes and ncfgLoad() has to read them back
+static bool checkLayout()
+{
+    NIN_CFG cfg, raw, back;
+    memset(&cfg, 0, sizeof(NIN_CFG));
+    cfg.Magicbytes = NCFG_MAGIC;
+    cfg.Version = 10;
+    cfg.Config = NIN_CFG_MEMCARDEMU | NIN_CFG_CC_RUMBLE;
+    cfg.VideoMode = NIN_VID_FORCE | NIN_VID_PROG | NIN_VID_FORCE_NTSC;
+    cfg.Language = 1;
+    strcpy(cfg.GamePath, "/games/GALE01/game.iso");
+    strcpy(cfg.CheatPath, "/cht/GALE01.gct");
+    cfg.MaxPads = 4;
+    cfg.GameID = 0x47414C45;
+    cfg.MemCardBlocks = 2;
+    cfg.VideoScale = 120;
+    cfg.VideoOffset = -4;
+    cfg.NetworkProfile = 1;
+    cfg.WiiUGamepadSlot = 1;
+
+    bool ok = sizeof(NIN_CFG) == 548;
+    ncfgSerialize(&cfg, &raw);
+    for(size_t i = 0; i < sizeof(layoutBytes) / sizeof(layoutBytes[0]); ++i)
+    {
+        if(memcmp((const uint8_t *)&raw + layoutBytes[i].offset, layoutBytes[i].bytes, layoutBytes[i].size) != 0)
+        {
+            fprintf(stderr, "Bytes at offset %u differ from the console layout!\n", layoutBytes[i].offset);
+            ok = false;
+        }
+    }
+
+    ok &= ncfgLoad(&back, &raw, sizeof(NIN_CFG)) == NCFG_OK && memcmp(&back, &cfg, sizeof(NIN_CFG)) == 0;
+    printf("layout: %zu fields against fixed bytes: %s\n", sizeof(layoutBytes) / sizeof(layoutBytes[0]), ok ? "OK" : "FAILED");
+    return ok;
+}
+
+// Batch conversion to host order against one config at a time like ncfgLoad() does it. Both have to
+// match the bytes on disk and converting back has to give the input again.
+static bool benchSwap(const NIN_CFG *in, size_t count, size_t rounds)
+{
+    NIN_CFG *cfgs = malloc(sizeof(NIN_CFG) * count);
+    if(cfgs == NULL)
+        return false;
+
+    bool ok = true;
+    memcpy(cfgs, in, sizeof(NIN_CFG) * count);
+    ncfgSwapBatch(cfgs, count);
+    for(size_t i = 0; i < count && ok; ++i)
+    {
+        NIN_CFG cfg;
+        ok = ncfgLoad(&cfg, in + i, sizeof(NIN_CFG)) == NCFG_OK && memcmp(&cfg, cfgs + i, sizeof(NIN_CFG)) == 0 &&
+             matchesDisk(cfgs + i, in + i);
+    }
+
+    ncfgSwapBatch(cfgs, count);
+    if(!ok || memcmp(cfgs, in, sizeof(NIN_CFG) * count) != 0)
+    {
+        fprintf(stderr, "Batch byte swap doesn't round-trip!\n");
+        free(cfgs);
+        return false;
+    }
+
+    // An even number of rounds leaves cfgs in on-disk order, so both loops see the same data
+    rounds = (rounds + 1) & ~(size_t)1;
+    uint64_t start = nanoTime();
+    for(size_t r = 0; r < rounds; ++r)
+        for(size_t i = 0; i < count; ++i)
+            ncfgByteSwap(cfgs + i);
+    uint64_t single = nanoTime() - start;
+
+    start = nanoTime();
+    for(size_t r = 0; r < rounds; ++r)
+        ncfgSwapBatch(cfgs, count);
+    uint64_t batch = nanoTime() - start;
+
+    double total = (double)count * rounds;
+    printf("byte swap: %zu configs x %zu rounds\n", count, rounds);
+    printf("  per field: %.2f ns/config, batch: %.2f ns/config (%.1fx)\n", single / total, batch / total,
+           (double)single / batch);
+
+    ok = memcmp(cfgs, in, sizeof(NIN_CFG) * count) == 0;
+    if(!ok)
+        fprintf(stderr, "Byte swap loops disagree!\n");
+
+    free(cfgs);
+    return ok;
+}
+
+// Per frame cost of rendering all settings rows, before and after the string pool. Both have to agree.
+static bool benchFormat(const NIN_CFG *in, size_t count, size_t rounds)
+{
+    static char before[SETTINGS_COUNT][LINE_LENGTH];
+    static char after[SETTINGS_COUNT][LINE_LENGTH];
+
+    NIN_CFG *cfgs = malloc(sizeof(NIN_CFG) * count);
+    if(cfgs == NULL)
+        return false;
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        ncfgLoad(cfgs + i, in + i, sizeof(NIN_CFG));
+        ncfgNormalize(cfgs + i);
+    }
+
+    uint64_t start = nanoTime();
+    settingsInit();
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+        snprintf(after[i], LINE_LENGTH, "   %-*s<", LABEL_WIDTH, settings[i].label);
+    uint64_t init = nanoTime() - start;
+
+    size_t mismatches = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        formatPrintf(cfgs + i, before);
+        formatPool(cfgs + i, after);
+        if(memcmp(before, after, sizeof(before)) != 0)
+            ++mismatches;
+    }
+
+    uint32_t checksum = 0;
+    uint64_t elapsed[2];
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        start = nanoTime();
+        for(size_t r = 0; r < rounds; ++r)
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                if(pass == 0)
+                    formatPrintf(cfgs + i, before);
+                else
+                    formatPool(cfgs + i, after);
+            }
+
+            checksum += (uint8_t)before[r % SETTINGS_COUNT][VALUE_COLUMN] + (uint8_t)after[r % SETTINGS_COUNT][VALUE_COLUMN];
+        }
+        elapsed[pass] = nanoTime() - start;
+    }
+
+    double frames = (double)count * rounds;
+    printf("settings rows: %zu configs x %zu rounds, %u rows per frame (pool built in %.1f us)\n",
+           count, rounds, SETTINGS_COUNT, init / 1e3);
+    printf("  printf: %.1f ns/frame\n", elapsed[0] / frames);
+    printf("  pool:   %.1f ns/frame, %.1fx (checksum %08X)\n", elapsed[1] / frames, (double)elapsed[0] / elapsed[1], checksum);
+
+    free(cfgs);
+    if(mismatches)
+    {
+        fprintf(stderr, "%zu configs rendered differently!\n", mismatches);
+        return false;
+    }
+
+    return true;
+}
+
+// Diffing every config against the next one and applying that patch has to give the next config, also after a
+// trip through the file format. Then the cost of diffing, of applying those patches and of applying the
+// handful of changes which usually get pushed to many consoles.
+static bool benchPatch(const NIN_CFG *in, size_t count, size_t rounds)
+{
+    NIN_CFG *cfgs = malloc(sizeof(NIN_CFG) * count);
+    PATCH *patches = malloc(sizeof(PATCH) * count);
+    if(cfgs == NULL || patches == NULL)
+    {
+        free(cfgs);
+        free(patches);
+        return false;
+    }
+
+    for(size_t i = 0; i < count; ++i)
+        ncfgLoad(cfgs + i, in + i, sizeof(NIN_CFG));
+
+    size_t mismatches = 0;
+    size_t entries = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        const NIN_CFG *to = cfgs + (i + 1) % count;
+        PATCH *patch = patches + i;
+        entries += patchDiff(patch, cfgs + i, to);
+
+        PATCH file;
+        patchSerialize(patch, &file);
+        NIN_CFG cfg = cfgs[i];
+        if(patchLoad(&file, &file, patchSize(patch)) != PATCH_OK)
+            ++mismatches;
+        else
+        {
+            patchApply(&file, &cfg);
+            if(memcmp(&cfg, to, sizeof(NIN_CFG)) != 0)
+                ++mismatches;
+        }
+    }
+
+    NIN_CFG base = cfgs[0];
+    base.Config &= ~(NIN_CFG_FORCE_WIDE | NIN_CFG_WIIU_WIDE);
+    base.VideoScale = 0;
+    base.MemCardBlocks = 2;
+    base.WiiUGamepadSlot = 0;
+    NIN_CFG tweaked = base;
+    tweaked.Config |= NIN_CFG_FORCE_WIDE | NIN_CFG_WIIU_WIDE;
+    tweaked.VideoScale = 104;
+    tweaked.MemCardBlocks = 4;
+    tweaked.WiiUGamepadSlot = 1;
+    PATCH fleet;
+    patchDiff(&fleet, &base, &tweaked);
+
+    uint32_t checksum = 0;
+    uint64_t elapsed[3];
+    for(int pass = 0; pass < 3; ++pass)
+    {
+        uint64_t start = nanoTime();
+        for(size_t r = 0; r < rounds; ++r)
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                NIN_CFG cfg = cfgs[i];
+                if(pass == 0)
+                    checksum += patchDiff(patches + i, cfgs + i, cfgs + (i + 1) % count);
+                else
+                {
+                    patchApply(pass == 1 ? patches + i : &fleet, &cfg);
+                    checksum += cfg.Config ^ cfg.WiiUGamepadSlot;
+                }
+            }
+        }
+        elapsed[pass] = nanoTime() - start;
+    }
+
+    double total = (double)count * rounds;
+    printf("patches: %zu configs x %zu rounds, %.1f entries per diff, %u in the fleet patch\n",
+           count, rounds, (double)entries / count, fleet.count);
+    printf("  diff:  %.1f ns/config\n", elapsed[0] / total);
+    printf("  apply: %.1f ns/config\n", elapsed[1] / total);
+    printf("  fleet: %.1f ns/config, %.0f configs/s (checksum %08X)\n", elapsed[2] / total, total / (elapsed[2] / 1e9), checksum);
+
+    free(cfgs);
+    free(patches);
+    if(mismatches)
+    {
+        fprintf(stderr, "%zu patches didn't reproduce their config!\n", mismatches);
+        return false;
+    }
+
+    return true;
+}
+
+// Text export and import of every config, which have to give the config back. Then the cost of both.
+static bool benchIni(const NIN_CFG *in, size_t count, size_t rounds)
+{
+    NIN_CFG *cfgs = malloc(sizeof(NIN_CFG) * count);
+    char *texts = malloc(INI_MAX_SIZE * count);
+    size_t *lengths = malloc(sizeof(size_t) * count);
+    if(cfgs == NULL || texts == NULL || lengths == NULL || !iniInit())
+    {
+        free(cfgs);
+        free(texts);
+        free(lengths);
+        return false;
+    }
+
+    size_t bytes = 0;
+    size_t mismatches = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        ncfgLoad(cfgs + i, in + i, sizeof(NIN_CFG));
+        lengths[i] = iniExport(cfgs + i, texts + i * INI_MAX_SIZE);
+        bytes += lengths[i];
+
+        NIN_CFG cfg = { .Magicbytes = NCFG_MAGIC };
+        uint32_t line;
+        if(iniImport(&cfg, texts + i * INI_MAX_SIZE, lengths[i], &line) != INI_OK ||
+           memcmp(&cfg, cfgs + i, sizeof(NIN_CFG)) != 0)
+            ++mismatches;
+    }
+
+    uint32_t checksum = 0;
+    uint64_t elapsed[2];
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        uint64_t start = nanoTime();
+        for(size_t r = 0; r < rounds; ++r)
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                char *text = texts + i * INI_MAX_SIZE;
+                if(pass == 0)
+                    checksum += iniExport(cfgs + i, text);
+                else
+                {
+                    NIN_CFG cfg;
+                    uint32_t line;
+                    checksum += iniImport(&cfg, text, lengths[i], &line) + cfg.Config;
+                }
+            }
+        }
+        elapsed[pass] = nanoTime() - start;
+    }
+
+    double total = (double)count * rounds;
+    printf("text: %zu configs x %zu rounds, %.0f bytes per config\n", count, rounds, (double)bytes / count);
+    printf("  export: %.1f ns/config\n", elapsed[0] / total);
+    printf("  import: %.1f ns/config, %.0f configs/s, %.1f MB/s (checksum %08X)\n", elapsed[1] / total,
+           total / (elapsed[1] / 1e9), bytes * rounds / (elapsed[1] / 1e9) / (1024 * 1024), checksum);
+
+    free(cfgs);
+    free(texts);
+    free(lengths);
+    if(mismatches)
+    {
+        fprintf(stderr, "%zu configs changed on the way through text!\n", mismatches);
+        return false;
+    }
+
+    return true;
+}
+
+// Software rendering of UI frames into a TV sized buffer: Repainting everything each frame like
+// WHBLogConsole did against renderScreen() only drawing changed cells into two alternating frames.
+// Every frame moves the cursor or edits a setting, like a button press would.
+static bool benchRender(size_t frames)
+{
+    static RENDER_ATLAS atlas;
+    static SCREEN screen;
+    static char lines[SETTINGS_COUNT][LINE_LENGTH];
+
+    uint32_t *pixels = malloc(TV_WIDTH * TV_HEIGHT * sizeof(uint32_t) * 3);
+    if(pixels == NULL)
+        return false;
+
+    for(uint32_t g = 0; g < RENDER_GLYPHS; ++g)
+        for(uint32_t y = 0; y < RENDER_GLYPH_HEIGHT; ++y)
+            atlas.rows[g][y] = g == 0 ? 0 : rng() & ((1 << RENDER_GLYPH_WIDTH) - 1);
+
+    // The third frame is for checking the result
+    RENDER_FRAME frame[3];
+    for(int i = 0; i < 3; ++i)
+    {
+        frame[i].pixels = pixels + i * TV_WIDTH * TV_HEIGHT;
+        frame[i].pitch = frame[i].width = TV_WIDTH;
+        frame[i].height = TV_HEIGHT;
+        renderInvalidate(frame + i);
+    }
+
+    uint64_t elapsed[2];
+    uint64_t cells = 0;
+    for(int pass = 0; pass < 2; ++pass)
+    {
+        NIN_CFG cfg;
+        memset(&cfg, 0, sizeof(NIN_CFG));
+        uint32_t cursor = 0;
+        screenClear(&screen);
+
+        uint64_t start = nanoTime();
+        for(size_t f = 0; f < frames; ++f)
+        {
+            if(rng() & 1)
+                cursor = rng() % SETTINGS_COUNT;
+            else
+                settingEdit(&cfg, cursor, rng() & 1);
+
+            formatPool(&cfg, lines);
+            for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+            {
+                memcpy(lines[i], i == cursor ? "->" : "  ", 2);
+                screenSetLine(&screen, i, lines[i]);
+            }
+            screenSetLine(&screen, SETTINGS_COUNT + 1, settings[cursor].info);
+
+            RENDER_FRAME *back = frame + (f & 1);
+            if(pass == 0)
+                renderInvalidate(back);
+
+            uint32_t changed = renderScreen(back, &atlas, &screen, 0x000033FF, 0xFFFFFFFF);
+            for(uint32_t row = 0; pass == 1 && row < SCREEN_LINES; ++row)
+                if(changed & (1u << row))
+                    cells += back->last[row] - back->first[row] + 1;
+        }
+        elapsed[pass] = nanoTime() - start;
+    }
+
+    // Updating only changed cells has to end up with the same pixels as a full repaint
+    renderScreen(frame + 2, &atlas, &screen, 0x000033FF, 0xFFFFFFFF);
+    bool same = memcmp(frame[(frames - 1) & 1].pixels, frame[2].pixels, TV_WIDTH * TV_HEIGHT * sizeof(uint32_t)) == 0;
+
+    printf("rendering: %zu frames of %ux%u\n", frames, TV_WIDTH, TV_HEIGHT);
+    printf("  full:    %.1f us/frame\n", elapsed[0] / 1e3 / frames);
+    printf("  changed: %.1f us/frame, %.1fx (%.1f cells/frame)\n", elapsed[1] / 1e3 / frames,
+           (double)elapsed[0] / elapsed[1], (double)cells / frames);
+
+    free(pixels);
+    if(!same)
+        fprintf(stderr, "Rendering only changed cells differs from a full repaint!\n");
+
+    return same;
+}
+
+// The video mode cycle as Nintendont defines it: Auto, Force with each one-hot force flag, None, Force (deflicker)
+// with each flag. Right walks it forwards, left backwards.
+static const uint32_t videoModeCycle[] = {
+    NIN_VID_AUTO,
+    NIN_VID_FORCE | NIN_VID_FORCE_PAL50,
+    NIN_VID_FORCE | NIN_VID_FORCE_PAL60,
+    NIN_VID_FORCE | NIN_VID_FORCE_NTSC,
+    NIN_VID_FORCE | NIN_VID_FORCE_MPAL,
+    NIN_VID_NONE,
+    NIN_VID_FORCE_DF | NIN_VID_FORCE_PAL50,
+    NIN_VID_FORCE_DF | NIN_VID_FORCE_PAL60,
+    NIN_VID_FORCE_DF | NIN_VID_FORCE_NTSC,
+    NIN_VID_FORCE_DF | NIN_VID_FORCE_MPAL,
+};
+#define VIDEO_MODE_CYCLE (sizeof(videoModeCycle) / sizeof(videoModeCycle[0]))
+
+// Where a video mode sits in videoModeCycle, -1 for invalid ones. Auto and None ignore the force flags.
+static int videoModePosition(uint32_t videoMode)
+{
+    uint32_t mode = videoMode & NIN_VID_MASK;
+    if(mode == NIN_VID_AUTO || mode == NIN_VID_NONE)
+        videoMode = mode;
+    else
+        videoMode &= NIN_VID_MASK | NIN_VID_FORCE_MASK;
+
+    for(size_t i = 0; i < VIDEO_MODE_CYCLE; ++i)
+        if(videoModeCycle[i] == videoMode)
+            return i;
+
+    return -1;
+}
+
+// Every mode, force flags and direction, with and without extended bits: valid states have to go to their
+// neighbour in videoModeCycle, invalid ones (no or several force flags, unknown modes) to Auto and extended bits
+// have to survive. Then how values Nintendont writes show up, normalizing force + deflicker and the cost of a press.
+static bool benchVideoMode(size_t rounds)
+{
+    static const uint32_t extended[] = { 0, NIN_VID_PROG, NIN_VID_PROG | NIN_VID_PATCH_PAL50 };
+    static const struct
+    {
+        uint32_t videoMode;
+        const char *shown;
+    } formats[] = {
+        { NIN_VID_AUTO, "Auto" },
+        { NIN_VID_FORCE | NIN_VID_FORCE_PAL50, "Force PAL50" },
+        { NIN_VID_FORCE | NIN_VID_FORCE_NTSC, "Force NTSC" },
+        { NIN_VID_FORCE_DF | NIN_VID_FORCE_MPAL, "Force (Deflicker) MPAL" },
+        { NIN_VID_FORCE | NIN_VID_FORCE_PAL50 | NIN_VID_FORCE_NTSC, "Invalid" },
+        { NIN_VID_FORCE_DF, "Invalid" },
+        { NIN_VID_NONE | NIN_VID_FORCE_PAL60, "None" },
+    };
+    int index = settingFind("video_mode");
+    if(index < 0)
+    {
+        fprintf(stderr, "No video_mode setting!\n");
+        return false;
+    }
+
+    char got[LINE_LENGTH];
+    size_t states = 0;
+    size_t errors = 0;
+    NIN_CFG cfg;
+    memset(&cfg, 0, sizeof(NIN_CFG));
+
+    for(uint32_t e = 0; e < sizeof(extended) / sizeof(extended[0]); ++e)
+    {
+        for(uint32_t mode = 0; mode <= NIN_VID_MASK >> 16; ++mode)
+        {
+            for(uint32_t force = 0; force <= NIN_VID_FORCE_MASK; ++force)
+            {
+                for(int right = 0; right < 2; ++right)
+                {
+                    uint32_t start = extended[e] | mode << 16 | force;
+                    int position = videoModePosition(start);
+                    uint32_t want = position < 0 ? NIN_VID_AUTO :
+                                    videoModeCycle[(position + (right ? 1 : VIDEO_MODE_CYCLE - 1)) % VIDEO_MODE_CYCLE];
+                    want |= extended[e];
+
+                    cfg.VideoMode = start;
+                    settingEdit(&cfg, index, right);
+                    ++states;
+
+                    if(cfg.VideoMode != want)
+                    {
+                        fprintf(stderr, "video mode %08X %s: %08X instead of %08X\n", start, right ? "right" : "left", cfg.VideoMode, want);
+                        ++errors;
+                    }
+                }
+            }
+        }
+    }
+
+    for(size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i)
+    {
+        cfg.VideoMode = formats[i].videoMode;
+        settingFormat(&cfg, index, got);
+        if(strcmp(got, formats[i].shown) != 0)
+        {
+            fprintf(stderr, "video mode %08X: \"%s\" instead of \"%s\"\n", formats[i].videoMode, got, formats[i].shown);
+            ++errors;
+        }
+    }
+
+    memset(&cfg, 0, sizeof(NIN_CFG));
+    cfg.VideoMode = NIN_VID_FORCE | NIN_VID_FORCE_DF | NIN_VID_FORCE_NTSC;
+    ncfgNormalize(&cfg);
+    if((cfg.VideoMode & NIN_VID_MASK) != NIN_VID_FORCE_DF || (cfg.VideoMode & NIN_VID_FORCE_MASK) != NIN_VID_FORCE_NTSC)
+    {
+        fprintf(stderr, "force + deflicker normalized to %08X\n", cfg.VideoMode);
+        ++errors;
+    }
+
+    uint32_t checksum = 0;
+    cfg.VideoMode = NIN_VID_AUTO;
+    uint64_t start = nanoTime();
+    for(size_t r = 0; r < rounds; ++r)
+    {
+        // Scrambled directions, so the branch predictor can't learn the walk
+        bool right = (uint32_t)(r * 0x9E3779B9u) >> 31;
+        settingEdit(&cfg, index, right);
+        checksum += cfg.VideoMode;
+    }
+    uint64_t elapsed = nanoTime() - start;
+
+    printf("video mode: %zu transitions checked, %.1f ns/press (checksum %08X)\n", states, (double)elapsed / rounds, checksum);
+
+    if(errors)
+    {
+        fprintf(stderr, "%zu video mode checks failed!\n", errors);
+        return false;
+    }
+
+    return true;
+}
+
+// settingsMerge() beyond the options: GamePath, GameID and bits no option owns have to be merged too, with
+// conflicts reported and ours kept
+static bool benchMerge()
+{
+    NIN_CFG base, ours, theirs;
+    memset(&base, 0, sizeof(NIN_CFG));
+    base.VideoMode = NIN_VID_AUTO;
+    ours = theirs = base;
+
+    strcpy(theirs.GamePath, "/games/GALE01/game.iso");
+    theirs.GameID = 0x47414C45;
+    theirs.VideoMode |= NIN_VID_PATCH_PAL50;
+    theirs.Config |= NIN_CFG_CHEATS | NIN_CFG_DEBUGGER;
+    ours.GameID = 0x474D3845;
+    ours.Config |= NIN_CFG_DEBUGGER;
+
+    NIN_CFG want = theirs;
+    want.GameID = ours.GameID;
+
+    uint32_t conflicts;
+    uint32_t taken = settingsMerge(&ours, &base, &theirs, &conflicts);
+    bool ok = memcmp(&ours, &want, sizeof(NIN_CFG)) == 0 && taken == SETTINGS_MERGE_OTHER && conflicts == SETTINGS_MERGE_OTHER;
+    printf("merge: %s\n", ok ? "OK" : "FAILED");
+    if(!ok)
+        fprintf(stderr, "Merging bits no option owns went wrong (took %08X, conflicts %08X)!\n", taken, conflicts);
+
+    return ok;
+}
+
+// A tiny SD card for benchGames(). Directory handles are indices into memDirs.
+typedef struct
+{
+    const char *path;
+    bool dir;
+    uint64_t mtime;
+} MEM_FILE;
+
+static MEM_FILE memFiles[8];
+static uint32_t memFileCount;
+static struct
+{
+    const char *path;
+    size_t length;
+    uint32_t next;
+} memDirs[2];
+
+static bool memOpenDir(void *ctx, const char *path, uintptr_t *dir)
+{
+    size_t length = strlen(path);
+    while(length && path[length - 1] == '/')
+        --length;
+
+    for(uintptr_t i = 0; i < sizeof(memDirs) / sizeof(memDirs[0]); ++i)
+    {
+        if(memDirs[i].path == NULL)
+        {
+            memDirs[i].path = path;
+            memDirs[i].length = length;
+            memDirs[i].next = 0;
+            *dir = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool memReadDir(void *ctx, uintptr_t dir, GAMES_DIR_ENTRY *entry)
+{
+    while(memDirs[dir].next < memFileCount)
+    {
+        const MEM_FILE *file = memFiles + memDirs[dir].next++;
+        const char *name = file->path + memDirs[dir].length;
+        if(strncmp(file->path, memDirs[dir].path, memDirs[dir].length) != 0 || *name != '/' || strchr(++name, '/') != NULL)
+            continue;
+
+        strcpy(entry->name, name);
+        entry->dir = file->dir;
+        entry->mtime = file->mtime;
+        entry->size = GAMES_HEADER_SIZE;
+        return true;
+    }
+
+    return false;
+}
+
+static void memCloseDir(void *ctx, uintptr_t dir)
+{
+    memDirs[dir].path = NULL;
+}
+
+static bool memStat(void *ctx, const char *path, uint64_t *mtime, uint64_t *size)
+{
+    for(uint32_t i = 0; i < memFileCount; ++i)
+    {
+        if(!memFiles[i].dir && strcmp(memFiles[i].path, path) == 0)
+        {
+            *mtime = memFiles[i].mtime;
+            *size = GAMES_HEADER_SIZE;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Every file is a GALE01 disc, disc2.iso the second one
+static bool memRead(void *ctx, const char *path, uint32_t offset, void *buffer, uint32_t size)
+{
+    uint8_t *header = buffer;
+    if(offset != 0 || size < GAMES_HEADER_SIZE)
+        return false;
+
+    memset(header, 0, size);
+    memcpy(header, "GALE01", 6);
+    header[6] = strstr(path, "disc2") != NULL;
+    memcpy(header + 0x1C, "\xC2\x33\x9F\x3D", 4);
+    strcpy((char *)header + 0x20, "Super Smash Bros. Melee");
+    return true;
+}
+
+static const GAMES_FS memFS = {
+    .openDir = memOpenDir,
+    .readDir = memReadDir,
+    .closeDir = memCloseDir,
+    .stat = memStat,
+    .read = memRead,
+};
+
+// Warm game scans against the cache: an unchanged card only lists GAMES_DIR, a file added to a known game
+// directory (which changes the directory's mtime) has to be found. The cache has to survive the index file.
+static bool benchGames()
+{
+    GAMES *games = malloc(sizeof(GAMES) * 2);
+    void *file = malloc(GAMES_FILE_MAX);
+    if(games == NULL || file == NULL)
+    {
+        fprintf(stderr, "EOM!\n");
+        free(games);
+        free(file);
+        return false;
+    }
+
+    GAMES *cache = games + 1;
+    GAMES_STATS cold, warm, added;
+    memFileCount = 0;
+    memFiles[memFileCount++] = (MEM_FILE){ "sd" GAMES_DIR, true, 1 };
+    memFiles[memFileCount++] = (MEM_FILE){ "sd" GAMES_DIR "/GALE01", true, 1 };
+    memFiles[memFileCount++] = (MEM_FILE){ "sd" GAMES_DIR "/GALE01/game.iso", false, 1 };
+
+    uint32_t count = gamesScan(games, NULL, &memFS, "sd", false, &cold);
+    bool ok = count == 1 && gamesLoad(cache, file, gamesSerialize(games, file)) && cache->count == 1 &&
+              cache->games[0].dirMtime == 1;
+
+    ok = ok && gamesScan(games, cache, &memFS, "sd", false, &warm) == 1 && warm.dirs == 1 && warm.reads == 0;
+
+    memFiles[memFileCount++] = (MEM_FILE){ "sd" GAMES_DIR "/GALE01/disc2.iso", false, 2 };
+    memFiles[1].mtime = 2;
+    ok = ok && gamesScan(games, cache, &memFS, "sd", false, &added) == 2 && added.dirs == 2 && added.reads == 1 &&
+         games->games[0].disc + games->games[1].disc == 1;
+
+    printf("games: cold %u dirs listed, warm %u, after adding a disc %u: %s\n", cold.dirs, warm.dirs, added.dirs,
+           ok ? "OK" : "FAILED");
+    if(!ok)
+        fprintf(stderr, "Warm game scans don't match the card!\n");
+
+    free(games);
+    free(file);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? strtoul(argv[1], NULL, 0) : DEFAULT_CONFIGS;
+    size_t rounds = argc > 2 ? strtoul(argv[2], NULL, 0) : DEFAULT_ROUNDS;
+    if(count == 0 || rounds == 0)
+    {
+        fprintf(stderr, "Usage: %s [configs] [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    NIN_CFG *in = malloc(sizeof(NIN_CFG) * count);
+    NIN_CFG *out = malloc(sizeof(NIN_CFG) * count);
+    if(in == NULL || out == NULL)
+    {
+        fprintf(stderr, "EOM!\n");
+        return 1;
+    }
+
+    generate(in, count);
+
+    uint32_t checksum = 0;
+    size_t failed = 0;
+    uint64_t start = nanoTime();
+    for(size_t r = 0; r < rounds; ++r)
+    {
+        for(size_t i = 0; i < count; ++i)
+        {
+            NIN_CFG cfg;
+            if(ncfgLoad(&cfg, in + i, sizeof(NIN_CFG)) != NCFG_OK)
+            {
+                ++failed;
+                continue;
+            }
+
+            ncfgNormalize(&cfg);
+            ncfgSerialize(&cfg, out + i);
+            checksum += out[i].Config ^ out[i].VideoMode;
+        }
+    }
+    uint64_t elapsed = nanoTime() - start;
+
+    double total = (double)count * rounds;
+    printf("load+validate+normalize+serialize: %zu configs x %zu rounds\n", count, rounds);
+    printf("  %.3f s, %.1f ns/config, %.0f configs/s (checksum %08X)\n",
+           elapsed / 1e9, elapsed / total, total / (elapsed / 1e9), checksum);
+
+    free(out);
+
+    if(failed)
+    {
+        fprintf(stderr, "%zu configs failed to validate!\n", failed);
+        free(in);
+        return 1;
+    }
+
+    bool ok = checkLayout() && benchSwap(in, count, rounds);
+    if(ok)
+        ok = benchFormat(in, count, rounds / 20 ? rounds / 20 : 1);
+    if(ok)
+        ok = benchPatch(in, count, rounds / 20 ? rounds / 20 : 1);
+    if(ok)
+        ok = benchIni(in, count, rounds / 20 ? rounds / 20 : 1);
+    free(in);
+    if(ok)
+        ok = benchVideoMode(count * rounds);
+    if(ok)
+        ok = benchMerge();
+    if(ok)
+        ok = benchGames();
+    if(ok)
+        ok = benchRender(RENDER_FRAMES);
+
+    return ok ? 0 : 1;
+}
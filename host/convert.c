@@ -0,0 +1,159 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "pool.h"
+#include "tool.h"
+
+#include <migrate.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_VERSIONS 64
+
+typedef struct
+{
+    PATH_LIST files;
+    uint32_t target;
+    bool dryRun;
+    // One composed migration per source version, built before the first file gets touched
+    MIGRATION *migrations[MAX_VERSIONS];
+    atomic_size_t failed;
+    atomic_size_t changed;
+} MIGRATE_JOB;
+
+static void migrateUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool migrate [-t version] [-j threads] [-n] [-l list] [file|dir]...\n\n"
+                    "  -t  Target version (default: %u)\n"
+                    "  -l  Read paths from a file, one per line (- for stdin)\n"
+                    "  -j  Worker threads (default: all cores)\n"
+                    "  -n  Dry run, check and report only\n\n"
+                    "Directories are searched for *.bin.\n", NIN_CFG_VERSION);
+}
+
+static void migrateFile(size_t index, unsigned int worker, void *ctx)
+{
+    MIGRATE_JOB *job = ctx;
+    const char *path = job->files.paths[index];
+    NIN_CFG raw;
+
+    const char *err = readConfigFile(path, &raw);
+    if(err == NULL)
+    {
+        uint32_t version = ncfgBE32(raw.Version);
+        if(ncfgBE32(raw.Magicbytes) != NCFG_MAGIC)
+            err = ncfgStatusStr(NCFG_ERROR_MAGIC);
+        else if(version >= MAX_VERSIONS || job->migrations[version] == NULL)
+            err = ncfgStatusStr(NCFG_ERROR_VERSION);
+        else if(version != job->target)
+        {
+            migrationApply(job->migrations[version], &raw, &raw);
+            atomic_fetch_add_explicit(&job->changed, 1, memory_order_relaxed);
+            if(!job->dryRun)
+                err = writeConfigFile(path, &raw);
+        }
+    }
+
+    if(err != NULL)
+    {
+        atomic_fetch_add_explicit(&job->failed, 1, memory_order_relaxed);
+        fprintf(stderr, "%s: %s\n", path, err);
+    }
+}
+
+int cmdMigrate(int argc, char *argv[])
+{
+    MIGRATE_JOB job = { .target = NIN_CFG_VERSION };
+    unsigned int threads = 0;
+    int ret = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "t:l:j:n")) != -1)
+    {
+        switch(opt)
+        {
+            case 't':
+                job.target = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                if(!pathListRead(&job.files, optarg))
+                    goto out;
+                break;
+            case 'j':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                job.dryRun = true;
+                break;
+            default:
+                migrateUsage();
+                goto out;
+        }
+    }
+
+    if(migrationSize(job.target) != sizeof(NIN_CFG))
+    {
+        fprintf(stderr, "Can't migrate to version %u\n", job.target);
+        goto out;
+    }
+
+    for(uint32_t v = 0; v < MAX_VERSIONS; ++v)
+    {
+        if(migrationSize(v) != sizeof(NIN_CFG))
+            continue;
+
+        job.migrations[v] = malloc(sizeof(MIGRATION));
+        if(job.migrations[v] == NULL || !migrationBuild(job.migrations[v], v, job.target))
+        {
+            free(job.migrations[v]);
+            job.migrations[v] = NULL;
+        }
+    }
+
+    for(int i = optind; i < argc; ++i)
+        if(!pathListCollect(&job.files, argv[i], ".bin"))
+            goto out;
+
+    if(job.files.count == 0)
+    {
+        migrateUsage();
+        goto out;
+    }
+
+    uint64_t start = nanoTime();
+    poolRun(job.files.count, threads, migrateFile, &job);
+    double elapsed = (nanoTime() - start) / 1e9;
+
+    size_t failed = atomic_load(&job.failed);
+    printf("%zu files, %zu failed, %zu %s to version %u in %.3f s (%.0f files/s)\n",
+           job.files.count, failed, atomic_load(&job.changed), job.dryRun ? "would migrate" : "migrated",
+           job.target, elapsed, job.files.count / elapsed);
+
+    ret = failed ? 2 : 0;
+
+out:
+    for(uint32_t v = 0; v < MAX_VERSIONS; ++v)
+        free(job.migrations[v]);
+
+    pathListFree(&job.files);
+    return ret;
+}
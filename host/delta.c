@@ -0,0 +1,335 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "pool.h"
+#include "tool.h"
+
+#include <patch.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PATCH_SUFFIX ".patch"
+
+typedef struct
+{
+    PATH_LIST files;
+    NIN_CFG base;
+    const char *output;
+    bool verbose;
+    atomic_size_t failed;
+    atomic_size_t entries;
+} DIFF_JOB;
+
+typedef struct
+{
+    PATH_LIST files;
+    PATCH patch;
+    bool dryRun;
+    atomic_size_t failed;
+    atomic_size_t changed;
+} PATCH_JOB;
+
+static void diffUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool diff [-j threads] [-o patch] [-l list] [-v] base [file|dir]...\n\n"
+                    "  -o  Write the patch to this file (only with a single file)\n"
+                    "  -l  Read paths from a file, one per line (- for stdin)\n"
+                    "  -j  Worker threads (default: all cores)\n"
+                    "  -v  Print the entries of every patch\n\n"
+                    "Writes the changes from base to every file into file" PATCH_SUFFIX ".\n"
+                    "Directories are searched for *.bin.\n");
+}
+
+static void patchUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool patch [-j threads] [-n] [-l list] patch [file|dir]...\n\n"
+                    "  -l  Read paths from a file, one per line (- for stdin)\n"
+                    "  -j  Worker threads (default: all cores)\n"
+                    "  -n  Dry run, check and report only\n\n"
+                    "Directories are searched for *.bin.\n");
+}
+
+// Reads and validates a nincfg.bin in the current version, cfg ends up in host byte order
+static const char *loadConfigFile(const char *path, NIN_CFG *cfg)
+{
+    const char *err = readConfigFile(path, cfg);
+    if(err == NULL)
+    {
+        NCFG_STATUS status = ncfgLoad(cfg, cfg, sizeof(NIN_CFG));
+        if(status != NCFG_OK)
+            err = ncfgStatusStr(status);
+    }
+
+    return err;
+}
+
+static const char *readPatchFile(const char *path, PATCH *patch)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return strerror(errno);
+
+    struct stat st;
+    const char *err = NULL;
+    if(fstat(fd, &st) != 0)
+        err = strerror(errno);
+    else if(st.st_size > sizeof(PATCH))
+        err = patchStatusStr(PATCH_ERROR_SIZE);
+    else
+    {
+        ssize_t r = pread(fd, patch, st.st_size, 0);
+        if(r < 0)
+            err = strerror(errno);
+        else
+        {
+            PATCH_STATUS status = patchLoad(patch, patch, r);
+            if(status != PATCH_OK)
+                err = patchStatusStr(status);
+        }
+    }
+
+    close(fd);
+    return err;
+}
+
+static const char *writePatchFile(const char *path, const PATCH *patch)
+{
+    PATCH out;
+    patchSerialize(patch, &out);
+    return writeFile(path, &out, patchSize(patch));
+}
+
+static void printPatch(const char *path, const PATCH *patch)
+{
+    // One printf per patch, so the output of the workers doesn't get mixed up
+    char text[PATCH_MAX_ENTRIES * 64 + 4096];
+    int len = snprintf(text, sizeof(text), "%s: %u entries\n", path, patch->count);
+    for(uint32_t i = 0; i < patch->count && len < sizeof(text); ++i)
+    {
+        const PATCH_ENTRY *entry = patch->entries + i;
+        len += snprintf(text + len, sizeof(text) - len, "  %-16s %3u  mask %08X  value %08X\n",
+                        patchFieldName(entry->field), entry->word, entry->mask, entry->value);
+    }
+
+    fputs(text, stdout);
+}
+
+static void diffFile(size_t index, unsigned int worker, void *ctx)
+{
+    DIFF_JOB *job = ctx;
+    const char *path = job->files.paths[index];
+    NIN_CFG cfg;
+    PATCH patch;
+
+    const char *err = loadConfigFile(path, &cfg);
+    if(err == NULL)
+    {
+        atomic_fetch_add_explicit(&job->entries, patchDiff(&patch, &job->base, &cfg), memory_order_relaxed);
+        if(job->verbose)
+            printPatch(path, &patch);
+
+        if(job->output != NULL)
+            err = writePatchFile(job->output, &patch);
+        else
+        {
+            char out[4096];
+            snprintf(out, sizeof(out), "%s" PATCH_SUFFIX, path);
+            err = writePatchFile(out, &patch);
+        }
+    }
+
+    if(err != NULL)
+    {
+        atomic_fetch_add_explicit(&job->failed, 1, memory_order_relaxed);
+        fprintf(stderr, "%s: %s\n", path, err);
+    }
+}
+
+static void patchFile(size_t index, unsigned int worker, void *ctx)
+{
+    PATCH_JOB *job = ctx;
+    const char *path = job->files.paths[index];
+    NIN_CFG raw, cfg;
+
+    const char *err = readConfigFile(path, &raw);
+    if(err == NULL)
+    {
+        NCFG_STATUS status = ncfgLoad(&cfg, &raw, sizeof(NIN_CFG));
+        if(status == NCFG_OK)
+        {
+            patchApply(&job->patch, &cfg);
+            ncfgSerialize(&cfg, &cfg);
+            if(memcmp(&cfg, &raw, sizeof(NIN_CFG)) != 0)
+            {
+                atomic_fetch_add_explicit(&job->changed, 1, memory_order_relaxed);
+                if(!job->dryRun)
+                    err = writeConfigFile(path, &cfg);
+            }
+        }
+        else
+            err = ncfgStatusStr(status);
+    }
+
+    if(err != NULL)
+    {
+        atomic_fetch_add_explicit(&job->failed, 1, memory_order_relaxed);
+        fprintf(stderr, "%s: %s\n", path, err);
+    }
+}
+
+int cmdDiff(int argc, char *argv[])
+{
+    DIFF_JOB job = { 0 };
+    unsigned int threads = 0;
+    int ret = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "o:l:j:v")) != -1)
+    {
+        switch(opt)
+        {
+            case 'o':
+                job.output = optarg;
+                break;
+            case 'l':
+                if(!pathListRead(&job.files, optarg))
+                    goto out;
+                break;
+            case 'j':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'v':
+                job.verbose = true;
+                break;
+            default:
+                diffUsage();
+                goto out;
+        }
+    }
+
+    if(optind >= argc)
+    {
+        diffUsage();
+        goto out;
+    }
+
+    const char *err = loadConfigFile(argv[optind], &job.base);
+    if(err != NULL)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], err);
+        goto out;
+    }
+
+    for(int i = optind + 1; i < argc; ++i)
+        if(!pathListCollect(&job.files, argv[i], ".bin"))
+            goto out;
+
+    if(job.files.count == 0 || (job.output != NULL && job.files.count != 1))
+    {
+        diffUsage();
+        goto out;
+    }
+
+    uint64_t start = nanoTime();
+    poolRun(job.files.count, threads, diffFile, &job);
+    double elapsed = (nanoTime() - start) / 1e9;
+
+    size_t failed = atomic_load(&job.failed);
+    printf("%zu files, %zu failed, %zu entries in %.3f s (%.0f files/s)\n",
+           job.files.count, failed, atomic_load(&job.entries), elapsed, job.files.count / elapsed);
+
+    ret = failed ? 2 : 0;
+
+out:
+    pathListFree(&job.files);
+    return ret;
+}
+
+int cmdPatch(int argc, char *argv[])
+{
+    PATCH_JOB job = { 0 };
+    unsigned int threads = 0;
+    int ret = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "l:j:n")) != -1)
+    {
+        switch(opt)
+        {
+            case 'l':
+                if(!pathListRead(&job.files, optarg))
+                    goto out;
+                break;
+            case 'j':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                job.dryRun = true;
+                break;
+            default:
+                patchUsage();
+                goto out;
+        }
+    }
+
+    if(optind >= argc)
+    {
+        patchUsage();
+        goto out;
+    }
+
+    const char *err = readPatchFile(argv[optind], &job.patch);
+    if(err != NULL)
+    {
+        fprintf(stderr, "%s: %s\n", argv[optind], err);
+        goto out;
+    }
+
+    for(int i = optind + 1; i < argc; ++i)
+        if(!pathListCollect(&job.files, argv[i], ".bin"))
+            goto out;
+
+    if(job.files.count == 0)
+    {
+        patchUsage();
+        goto out;
+    }
+
+    uint64_t start = nanoTime();
+    poolRun(job.files.count, threads, patchFile, &job);
+    double elapsed = (nanoTime() - start) / 1e9;
+
+    size_t failed = atomic_load(&job.failed);
+    printf("%zu files, %zu failed, %zu %s by %u entries in %.3f s (%.0f files/s, %.1f MB/s)\n",
+           job.files.count, failed, atomic_load(&job.changed), job.dryRun ? "would change" : "changed",
+           job.patch.count, elapsed, job.files.count / elapsed,
+           job.files.count * sizeof(NIN_CFG) / elapsed / (1024 * 1024));
+
+    ret = failed ? 2 : 0;
+
+out:
+    pathListFree(&job.files);
+    return ret;
+}
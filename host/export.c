@@ -0,0 +1,297 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "pool.h"
+#include "tool.h"
+
+#include <ini.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define INI_SUFFIX ".ini"
+
+typedef struct
+{
+    PATH_LIST files;
+    const char *output;
+    bool dryRun;
+    atomic_size_t failed;
+    atomic_size_t changed;
+} TEXT_JOB;
+
+static void exportUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool export [-j threads] [-o file] [-l list] [file|dir]...\n\n"
+                    "  -o  Write the text to this file instead (only with a single file, - for stdout)\n"
+                    "  -l  Read paths from a file, one per line (- for stdin)\n"
+                    "  -j  Worker threads (default: all cores)\n\n"
+                    "Writes every file as file" INI_SUFFIX ". Directories are searched for *.bin.\n");
+}
+
+static void importUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool import [-j threads] [-n] [-l list] [file|dir]...\n\n"
+                    "  -l  Read paths from a file, one per line (- for stdin)\n"
+                    "  -j  Worker threads (default: all cores)\n"
+                    "  -n  Dry run, check and report only\n\n"
+                    "Sets the options in file" INI_SUFFIX " in file, which gets created if it doesn't exist.\n"
+                    "Directories are searched for *" INI_SUFFIX ".\n");
+}
+
+static void exportFile(size_t index, unsigned int worker, void *ctx)
+{
+    TEXT_JOB *job = ctx;
+    const char *path = job->files.paths[index];
+    NIN_CFG cfg;
+    char text[INI_MAX_SIZE];
+
+    const char *err = readConfigFile(path, &cfg);
+    if(err == NULL)
+    {
+        NCFG_STATUS status = ncfgLoad(&cfg, &cfg, sizeof(NIN_CFG));
+        if(status == NCFG_OK)
+        {
+            size_t len = iniExport(&cfg, text);
+            if(job->output != NULL && strcmp(job->output, "-") == 0)
+                fwrite(text, 1, len, stdout);
+            else if(job->output != NULL)
+                err = writeFile(job->output, text, len);
+            else
+            {
+                char out[4096];
+                snprintf(out, sizeof(out), "%s" INI_SUFFIX, path);
+                err = writeFile(out, text, len);
+            }
+        }
+        else
+            err = ncfgStatusStr(status);
+    }
+
+    if(err != NULL)
+    {
+        atomic_fetch_add_explicit(&job->failed, 1, memory_order_relaxed);
+        fprintf(stderr, "%s: %s\n", path, err);
+    }
+}
+
+// Reads path into text, which has to have room for INI_MAX_SIZE bytes. Returns NULL or an error string.
+static const char *readTextFile(const char *path, char *text, size_t *size)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return strerror(errno);
+
+    // One byte more to see if the file is too big without a stat
+    const char *err = NULL;
+    ssize_t r = pread(fd, text, INI_MAX_SIZE + 1, 0);
+    if(r < 0)
+        err = strerror(errno);
+    else if(r > INI_MAX_SIZE)
+        err = iniStatusStr(INI_ERROR_SIZE);
+    else
+        *size = r;
+
+    close(fd);
+    return err;
+}
+
+static void importFile(size_t index, unsigned int worker, void *ctx)
+{
+    TEXT_JOB *job = ctx;
+    const char *path = job->files.paths[index];
+    char text[INI_MAX_SIZE + 1];
+    size_t size = 0;
+    NIN_CFG raw, cfg;
+    char errText[64];
+
+    // The target is the path without the suffix. Missing files get created, starting from an empty config.
+    char target[4096];
+    snprintf(target, sizeof(target), "%.*s", (int)(strlen(path) - strlen(INI_SUFFIX)), path);
+    const char *err = readTextFile(path, text, &size);
+    bool exists = false;
+    if(err == NULL)
+    {
+        exists = access(target, F_OK) == 0;
+        if(exists)
+        {
+            err = readConfigFile(target, &raw);
+            if(err == NULL)
+            {
+                NCFG_STATUS status = ncfgLoad(&cfg, &raw, sizeof(NIN_CFG));
+                if(status != NCFG_OK)
+                    err = ncfgStatusStr(status);
+            }
+        }
+        else
+        {
+            memset(&cfg, 0, sizeof(NIN_CFG));
+            cfg.Magicbytes = NCFG_MAGIC;
+            cfg.Version = NIN_CFG_VERSION;
+            cfg.Language = NIN_LAN_AUTO;
+            cfg.MemCardBlocks = 2;
+        }
+    }
+
+    if(err == NULL)
+    {
+        uint32_t line;
+        INI_STATUS status = iniImport(&cfg, text, size, &line);
+        if(status == INI_OK)
+        {
+            ncfgSerialize(&cfg, &cfg);
+            if(!exists || memcmp(&cfg, &raw, sizeof(NIN_CFG)) != 0)
+            {
+                atomic_fetch_add_explicit(&job->changed, 1, memory_order_relaxed);
+                if(!job->dryRun)
+                    err = writeFile(target, &cfg, sizeof(NIN_CFG));
+            }
+        }
+        else
+        {
+            snprintf(errText, sizeof(errText), "Line %u: %s", line, iniStatusStr(status));
+            err = errText;
+        }
+    }
+
+    if(err != NULL)
+    {
+        atomic_fetch_add_explicit(&job->failed, 1, memory_order_relaxed);
+        fprintf(stderr, "%s: %s\n", path, err);
+    }
+}
+
+static int runJob(TEXT_JOB *job, unsigned int threads, POOL_JOB run, const char *done)
+{
+    uint64_t start = nanoTime();
+    poolRun(job->files.count, threads, run, job);
+    double elapsed = (nanoTime() - start) / 1e9;
+
+    size_t failed = atomic_load(&job->failed);
+    fprintf(job->output != NULL && strcmp(job->output, "-") == 0 ? stderr : stdout,
+            "%zu files, %zu failed, %zu %s in %.3f s (%.0f files/s)\n",
+            job->files.count, failed, run == importFile ? atomic_load(&job->changed) : job->files.count - failed,
+            done, elapsed, job->files.count / elapsed);
+
+    return failed ? 2 : 0;
+}
+
+int cmdExport(int argc, char *argv[])
+{
+    TEXT_JOB job = { 0 };
+    unsigned int threads = 0;
+    int ret = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "o:l:j:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'o':
+                job.output = optarg;
+                break;
+            case 'l':
+                if(!pathListRead(&job.files, optarg))
+                    goto out;
+                break;
+            case 'j':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                exportUsage();
+                goto out;
+        }
+    }
+
+    for(int i = optind; i < argc; ++i)
+        if(!pathListCollect(&job.files, argv[i], ".bin"))
+            goto out;
+
+    if(job.files.count == 0 || (job.output != NULL && job.files.count != 1))
+    {
+        exportUsage();
+        goto out;
+    }
+
+    if(!iniInit())
+    {
+        fprintf(stderr, "No perfect hash for the option names!\n");
+        goto out;
+    }
+
+    ret = runJob(&job, threads, exportFile, "exported");
+
+out:
+    pathListFree(&job.files);
+    return ret;
+}
+
+int cmdImport(int argc, char *argv[])
+{
+    TEXT_JOB job = { 0 };
+    unsigned int threads = 0;
+    int ret = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "l:j:n")) != -1)
+    {
+        switch(opt)
+        {
+            case 'l':
+                if(!pathListRead(&job.files, optarg))
+                    goto out;
+                break;
+            case 'j':
+                threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                job.dryRun = true;
+                break;
+            default:
+                importUsage();
+                goto out;
+        }
+    }
+
+    for(int i = optind; i < argc; ++i)
+        if(!pathListCollect(&job.files, argv[i], INI_SUFFIX))
+            goto out;
+
+    if(job.files.count == 0)
+    {
+        importUsage();
+        goto out;
+    }
+
+    if(!iniInit())
+    {
+        fprintf(stderr, "No perfect hash for the option names!\n");
+        goto out;
+    }
+
+    ret = runJob(&job, threads, importFile, job.dryRun ? "would change" : "changed");
+
+out:
+    pathListFree(&job.files);
+    return ret;
+}
@@ -0,0 +1,395 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+// Fuzz target for everything nincfg.bin goes through before the UI shows it.
+// Built against libFuzzer (make fuzz FUZZER=1, needs clang) this is just LLVMFuzzerTestOneInput().
+// Otherwise main() runs it over files, directories or stdin, which is what AFL (with @@ or stdin)
+// and corpus replays under ASan/UBSan need, and times it with -b.
+// host/corpus holds nincfg.bin files as Nintendont writes them, one per version from 3 to 10 (GamePath, GameID,
+// one-hot video mode flags and the options of that version). Give it to the fuzzer next to the -s seeds, so
+// mutations start from real files and not only from what this harness generates.
+
+#include <migrate.h>
+#include <ncfg.h>
+#include <settings.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_INPUT_SIZE  (64 * 1024) // Anything bigger can't be a config
+#define CRASH_PATH      "crash-nincfg-fuzz.bin"
+
+// Unlike assert() this stays with -DNDEBUG, checking is all the harness does
+#define FUZZ_CHECK(cond)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if(!(cond))                                                             \
+            fuzzFail(__LINE__, #cond);                                          \
+    } while(0)
+
+static void fuzzFail(int line, const char *cond)
+{
+    fprintf(stderr, "fuzz.c:%d: %s failed\n", line, cond);
+    abort();
+}
+
+// What the UI does with a config: Validate, format (directly and from the pool) and edit every option
+static void checkSettings(const NIN_CFG *cfg)
+{
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+    {
+        // Exactly SETTING_VALUE_SIZE, so ASan catches formatters writing past it
+        char value[SETTING_VALUE_SIZE];
+        settingValid(cfg, i);
+        settingFormat(cfg, i, value);
+        FUZZ_CHECK(memchr(value, '\0', SETTING_VALUE_SIZE) != NULL);
+
+        size_t len;
+        const char *text = settingText(cfg, i, &len);
+        if(text != NULL)
+            FUZZ_CHECK(len == strlen(value) && memcmp(text, value, len) == 0);
+
+        for(int right = 0; right < 2; ++right)
+        {
+            NIN_CFG edited = *cfg;
+            settingEdit(&edited, i, right);
+            settingFormat(&edited, i, value);
+            FUZZ_CHECK(memchr(value, '\0', SETTING_VALUE_SIZE) != NULL);
+        }
+    }
+}
+
+static void checkConfig(const uint8_t *data, size_t size)
+{
+    NIN_CFG cfg;
+    MIGRATION migration;
+    if(migrationLoad(&cfg, data, size, &migration) != NCFG_OK)
+        return;
+
+    ncfgNormalize(&cfg);
+    checkSettings(&cfg);
+
+    NIN_CFG again = cfg;
+    ncfgNormalize(&again);
+    FUZZ_CHECK(memcmp(&again, &cfg, sizeof(NIN_CFG)) == 0);
+
+    // What gets saved has to load back into the same config
+    NIN_CFG raw;
+    ncfgSerialize(&cfg, &raw);
+    FUZZ_CHECK(ncfgLoad(&again, &raw, sizeof(NIN_CFG)) == NCFG_OK);
+    ncfgNormalize(&again);
+    FUZZ_CHECK(memcmp(&again, &cfg, sizeof(NIN_CFG)) == 0);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool initialized = false;
+    if(!initialized)
+    {
+        settingsInit();
+        initialized = true;
+    }
+
+    checkConfig(data, size);
+    return 0;
+}
+
+#ifndef NINCFG_LIBFUZZER
+typedef struct
+{
+    uint8_t *data;
+    size_t size;
+} INPUT;
+
+typedef struct
+{
+    INPUT *inputs;
+    size_t count;
+    size_t capacity;
+    size_t bytes;
+} CORPUS;
+
+static CORPUS corpus;
+static const INPUT *currentInput;
+
+// Both sanitizers abort() instead of exiting, so the input gets saved no matter what went wrong
+const char *__asan_default_options()
+{
+    return "abort_on_error=1";
+}
+
+const char *__ubsan_default_options()
+{
+    return "abort_on_error=1:print_stacktrace=1";
+}
+
+static void saveCrash(int sig)
+{
+    if(currentInput != NULL)
+    {
+        int fd = open(CRASH_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd != -1)
+        {
+            if(write(fd, currentInput->data, currentInput->size) == (ssize_t)currentInput->size)
+                write(STDERR_FILENO, "Input written to " CRASH_PATH "\n", sizeof("Input written to " CRASH_PATH "\n") - 1);
+
+            close(fd);
+        }
+    }
+
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void runInput(const INPUT *input)
+{
+    currentInput = input;
+    LLVMFuzzerTestOneInput(input->data, input->size);
+}
+
+static uint64_t nanoTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Every input gets its own allocation of exactly its size, so reading past it is caught
+static bool corpusAdd(const uint8_t *data, size_t size)
+{
+    if(corpus.count == corpus.capacity)
+    {
+        size_t capacity = corpus.capacity ? corpus.capacity * 2 : 256;
+        INPUT *inputs = realloc(corpus.inputs, sizeof(INPUT) * capacity);
+        if(inputs == NULL)
+            return false;
+
+        corpus.inputs = inputs;
+        corpus.capacity = capacity;
+    }
+
+    INPUT *input = corpus.inputs + corpus.count;
+    input->data = malloc(size ? size : 1);
+    if(input->data == NULL)
+        return false;
+
+    memcpy(input->data, data, size);
+    input->size = size;
+    corpus.bytes += size;
+    ++corpus.count;
+    return true;
+}
+
+static bool corpusRead(FILE *f, const char *path)
+{
+    static uint8_t buffer[MAX_INPUT_SIZE];
+    size_t size = fread(buffer, 1, MAX_INPUT_SIZE, f);
+    if(ferror(f))
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    return corpusAdd(buffer, size);
+}
+
+static int corpusEntry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    if(type != FTW_F || st->st_size > MAX_INPUT_SIZE)
+        return 0;
+
+    FILE *f = fopen(path, "rb");
+    if(f == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    bool ok = corpusRead(f, path);
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+static bool writeSeed(const char *dir, const char *name, const void *data, size_t size)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "wb");
+    if(f == NULL || fwrite(data, 1, size, f) != size)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        if(f != NULL)
+            fclose(f);
+        return false;
+    }
+
+    return fclose(f) == 0;
+}
+
+// The configs a real SD card has: The default one, every value of every option and every older version.
+// Anything else (like your own nincfg.bin) can simply be copied in.
+static bool writeSeeds(const char *dir)
+{
+    if(mkdir(dir, 0755) != 0 && errno != EEXIST)
+    {
+        fprintf(stderr, "%s: %s\n", dir, strerror(errno));
+        return false;
+    }
+
+    NIN_CFG cfg;
+    memset(&cfg, 0, sizeof(NIN_CFG));
+    cfg.Magicbytes = NCFG_MAGIC;
+    cfg.Version = NIN_CFG_VERSION;
+    cfg.Config = NIN_CFG_MEMCARDEMU;
+    cfg.VideoMode = NIN_VID_AUTO;
+    cfg.Language = NIN_LAN_AUTO;
+    cfg.MaxPads = NIN_CFG_MAXPAD;
+    cfg.MemCardBlocks = 2;
+    ncfgNormalize(&cfg);
+
+    NIN_CFG raw;
+    ncfgSerialize(&cfg, &raw);
+    if(!writeSeed(dir, "default.bin", &raw, sizeof(NIN_CFG)))
+        return false;
+
+    char name[64];
+    size_t seeds = 1;
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+    {
+        NIN_CFG edited = cfg;
+        for(int n = 0; n < SETTING_MAX_VALUES; ++n)
+        {
+            // Stop once it wraps around or sticks at the maximum
+            NIN_CFG previous = edited;
+            settingEdit(&edited, i, true);
+            if(settingEqual(&edited, &cfg, i) || settingEqual(&edited, &previous, i))
+                break;
+
+            ncfgSerialize(&edited, &raw);
+            snprintf(name, sizeof(name), "%s-%d.bin", settings[i].name, n);
+            if(!writeSeed(dir, name, &raw, sizeof(NIN_CFG)))
+                return false;
+
+            ++seeds;
+        }
+    }
+
+    MIGRATION migration;
+    ncfgSerialize(&cfg, &raw);
+    for(uint32_t v = MIGRATION_MIN_VERSION; v < NIN_CFG_VERSION; ++v)
+    {
+        if(!migrationBuild(&migration, NIN_CFG_VERSION, v))
+            continue;
+
+        uint8_t old[MIGRATION_MAX_SIZE];
+        migrationApply(&migration, &raw, old);
+        snprintf(name, sizeof(name), "version-%u.bin", v);
+        if(!writeSeed(dir, name, old, migration.toSize))
+            return false;
+
+        ++seeds;
+    }
+
+    printf("%zu seeds written to %s\n", seeds, dir);
+    return true;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-s seed dir] [-b rounds] [file or dir...]\n"
+                    "Runs the fuzz target once per file (stdin without any) and aborts on the first failure.\n"
+                    "  -s  Write a seed corpus to the directory first and add it to the inputs\n"
+                    "  -b  Run the whole corpus that many times and report execs/s\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *seedDir = NULL;
+    size_t rounds = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "s:b:")) != -1)
+    {
+        switch(opt)
+        {
+            case 's':
+                seedDir = optarg;
+                break;
+            case 'b':
+                rounds = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    signal(SIGABRT, saveCrash);
+    signal(SIGSEGV, saveCrash);
+
+    if(seedDir != NULL && (!writeSeeds(seedDir) || nftw(seedDir, corpusEntry, 64, FTW_PHYS) != 0))
+        return 1;
+
+    for(int i = optind; i < argc; ++i)
+    {
+        if(nftw(argv[i], corpusEntry, 64, FTW_PHYS) != 0)
+        {
+            fprintf(stderr, "%s: Can't read\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if(seedDir == NULL && optind == argc && !corpusRead(stdin, "stdin"))
+        return 1;
+
+    for(size_t i = 0; i < corpus.count; ++i)
+        runInput(corpus.inputs + i);
+
+    if(rounds)
+    {
+        uint64_t start = nanoTime();
+        for(size_t r = 0; r < rounds; ++r)
+            for(size_t i = 0; i < corpus.count; ++i)
+                runInput(corpus.inputs + i);
+        uint64_t elapsed = nanoTime() - start;
+
+        double total = (double)corpus.count * rounds;
+        printf("fuzz target: %zu inputs (%zu bytes) x %zu rounds\n", corpus.count, corpus.bytes, rounds);
+        printf("  %.3f s, %.1f us/exec, %.0f execs/s\n", elapsed / 1e9, elapsed / 1e3 / total, total / (elapsed / 1e9));
+    }
+    else
+        printf("%zu inputs OK\n", corpus.count);
+
+    for(size_t i = 0; i < corpus.count; ++i)
+        free(corpus.inputs[i].data);
+
+    free(corpus.inputs);
+    return 0;
+}
+#endif
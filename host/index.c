@@ -0,0 +1,247 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "tool.h"
+
+#include <games.h>
+#include <profiles.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void gamesUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool games [-i index] [-f] [-b runs] [-v] <device root>\n\n"
+                    "  -i  Game index to start from and update, like nincfg_games.bin on the SD card\n"
+                    "  -f  List every game directory, even if the index says nothing changed\n"
+                    "  -b  Time a cold scan and this many warm scans against its result\n"
+                    "  -v  Print the games\n\n"
+                    "Scans <device root>" GAMES_DIR " like the app does.\n");
+}
+
+static uint64_t statTime(const struct stat *st)
+{
+    return (uint64_t)st->st_mtim.tv_sec * 1000000000ull + st->st_mtim.tv_nsec;
+}
+
+static bool posixOpenDir(void *ctx, const char *path, uintptr_t *dir)
+{
+    DIR *d = opendir(path);
+    *dir = (uintptr_t)d;
+    return d != NULL;
+}
+
+static bool posixReadDir(void *ctx, uintptr_t dir, GAMES_DIR_ENTRY *entry)
+{
+    // The FSA directory entries come with a stat, so give the scanner the same here
+    struct dirent *de;
+    struct stat st;
+    do
+    {
+        de = readdir((DIR *)dir);
+        if(de == NULL)
+            return false;
+    } while(strlen(de->d_name) >= sizeof(entry->name) || fstatat(dirfd((DIR *)dir), de->d_name, &st, 0) != 0);
+
+    strcpy(entry->name, de->d_name);
+    entry->dir = S_ISDIR(st.st_mode);
+    entry->mtime = statTime(&st);
+    entry->size = st.st_size;
+    return true;
+}
+
+static void posixCloseDir(void *ctx, uintptr_t dir)
+{
+    closedir((DIR *)dir);
+}
+
+static bool posixStat(void *ctx, const char *path, uint64_t *mtime, uint64_t *size)
+{
+    struct stat st;
+    if(stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    *mtime = statTime(&st);
+    *size = st.st_size;
+    return true;
+}
+
+static bool posixRead(void *ctx, const char *path, uint32_t offset, void *buffer, uint32_t size)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    bool ret = pread(fd, buffer, size, offset) == (ssize_t)size;
+    close(fd);
+    return ret;
+}
+
+static const GAMES_FS posixFS = {
+    .openDir = posixOpenDir,
+    .readDir = posixReadDir,
+    .closeDir = posixCloseDir,
+    .stat = posixStat,
+    .read = posixRead,
+};
+
+// A missing index is an empty one, a broken index too but that gets reported
+static bool readIndex(const char *path, GAMES *games, void *buffer)
+{
+    games->count = 0;
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        if(errno == ENOENT)
+            return true;
+
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    ssize_t r = pread(fd, buffer, GAMES_FILE_MAX + 1, 0);
+    close(fd);
+    if(r < 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    if(!gamesLoad(games, buffer, r))
+        fprintf(stderr, "%s: Broken index, scanning everything\n", path);
+
+    return true;
+}
+
+static void printStats(const char *what, uint32_t count, const GAMES_STATS *stats, double elapsed)
+{
+    printf("%s: %u games, %u dirs listed, %u files stated, %u headers read, %u cached, %u skipped in %.3f ms\n",
+           what, count, stats->dirs, stats->stats, stats->reads, stats->cached, stats->skipped, elapsed * 1e3);
+}
+
+static void printGames(const GAMES *games)
+{
+    char id[9];
+    for(uint32_t i = 0; i < games->count; ++i)
+    {
+        const GAME *game = games->games + i;
+        profilesFormatID(game->gameID, id);
+        printf("%s%.2s disc %u  %-40s  %s\n", id, game->maker, game->disc + 1, game->title, game->path);
+    }
+}
+
+int cmdGames(int argc, char *argv[])
+{
+    const char *indexPath = NULL;
+    bool full = false;
+    bool verbose = false;
+    unsigned int runs = 0;
+    int ret = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "i:fb:v")) != -1)
+    {
+        switch(opt)
+        {
+            case 'i':
+                indexPath = optarg;
+                break;
+            case 'f':
+                full = true;
+                break;
+            case 'b':
+                runs = strtoul(optarg, NULL, 0);
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                gamesUsage();
+                return 1;
+        }
+    }
+
+    if(optind + 1 != argc)
+    {
+        gamesUsage();
+        return 1;
+    }
+
+    const char *root = argv[optind];
+    GAMES *cache = malloc(sizeof(GAMES));
+    GAMES *games = malloc(sizeof(GAMES));
+    uint8_t *buffer = malloc(GAMES_FILE_MAX + 1);
+    if(cache == NULL || games == NULL || buffer == NULL)
+    {
+        fprintf(stderr, "Out of memory\n");
+        goto out;
+    }
+
+    cache->count = 0;
+    if(indexPath != NULL && !readIndex(indexPath, cache, buffer))
+        goto out;
+
+    GAMES_STATS stats;
+    uint64_t start = nanoTime();
+    uint32_t count = gamesScan(games, cache, &posixFS, root, full, &stats);
+    printStats(cache->count ? "Scan" : "Cold scan", count, &stats, (nanoTime() - start) / 1e9);
+
+    // Warm scans run against the result of the first one, like the next launch of the app would
+    if(runs)
+    {
+        GAMES_STATS warmStats;
+        GAMES *warm = cache;
+        start = nanoTime();
+        for(unsigned int i = 0; i < runs; ++i)
+            gamesScan(warm, games, &posixFS, root, full, &warmStats);
+
+        printStats("Warm scan", warm->count, &warmStats, (nanoTime() - start) / 1e9 / runs);
+        if(warm->count != games->count || memcmp(warm->games, games->games, sizeof(GAME) * games->count) != 0)
+        {
+            fprintf(stderr, "Warm scan differs from the cold one!\n");
+            goto out;
+        }
+    }
+
+    if(verbose)
+        printGames(games);
+
+    if(indexPath != NULL)
+    {
+        const char *err = writeFile(indexPath, buffer, gamesSerialize(games, buffer));
+        if(err != NULL)
+        {
+            fprintf(stderr, "%s: %s\n", indexPath, err);
+            goto out;
+        }
+    }
+
+    ret = 0;
+
+out:
+    free(buffer);
+    free(games);
+    free(cache);
+    return ret;
+}
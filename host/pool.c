@@ -0,0 +1,142 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define CHUNK_SIZE 16
+
+typedef struct
+{
+    _Alignas(64) atomic_size_t next;
+    size_t end;
+} POOL_SLICE;
+
+typedef struct
+{
+    POOL_SLICE *slices;
+    unsigned int threads;
+    POOL_JOB job;
+    void *ctx;
+} POOL;
+
+typedef struct
+{
+    POOL *pool;
+    unsigned int worker;
+} POOL_WORKER;
+
+// Returns false once the slice is drained
+static inline bool runChunk(POOL *pool, POOL_SLICE *slice, unsigned int worker)
+{
+    size_t i = atomic_fetch_add_explicit(&slice->next, CHUNK_SIZE, memory_order_relaxed);
+    if(i >= slice->end)
+        return false;
+
+    size_t end = i + CHUNK_SIZE;
+    if(end > slice->end)
+        end = slice->end;
+
+    for(; i < end; ++i)
+        pool->job(i, worker, pool->ctx);
+
+    return true;
+}
+
+static void *workerThread(void *arg)
+{
+    POOL_WORKER *w = arg;
+    POOL *pool = w->pool;
+
+    while(runChunk(pool, pool->slices + w->worker, w->worker))
+        ;
+
+    // Steal from the others, starting with our neighbour so the thieves spread out
+    for(unsigned int i = 1; i < pool->threads; ++i)
+    {
+        POOL_SLICE *victim = pool->slices + ((w->worker + i) % pool->threads);
+        while(runChunk(pool, victim, w->worker))
+            ;
+    }
+
+    return NULL;
+}
+
+unsigned int poolDefaultThreads()
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? cpus : 1;
+}
+
+void poolRun(size_t count, unsigned int threads, POOL_JOB job, void *ctx)
+{
+    if(threads == 0)
+        threads = poolDefaultThreads();
+    if(threads > count)
+        threads = count ? count : 1;
+
+    POOL pool = {
+        .slices = aligned_alloc(64, sizeof(POOL_SLICE) * threads),
+        .threads = threads,
+        .job = job,
+        .ctx = ctx,
+    };
+    pthread_t *tids = malloc(sizeof(pthread_t) * threads);
+    POOL_WORKER *workers = malloc(sizeof(POOL_WORKER) * threads);
+    if(pool.slices == NULL || tids == NULL || workers == NULL)
+    {
+        // Not worth failing over, just do it all ourselves
+        for(size_t i = 0; i < count; ++i)
+            job(i, 0, ctx);
+
+        goto cleanup;
+    }
+
+    size_t per = count / threads;
+    size_t start = 0;
+    for(unsigned int i = 0; i < threads; ++i)
+    {
+        atomic_init(&pool.slices[i].next, start);
+        start += per + (i < count % threads);
+        pool.slices[i].end = start;
+        workers[i].pool = &pool;
+        workers[i].worker = i;
+    }
+
+    unsigned int started = 1;
+    for(; started < threads; ++started)
+        if(pthread_create(tids + started, NULL, workerThread, workers + started) != 0)
+            break;
+
+    // The calling thread is worker 0. Slices without a thread get stolen.
+    workerThread(workers);
+
+    for(unsigned int i = 1; i < started; ++i)
+        pthread_join(tids[i], NULL);
+
+cleanup:
+    free(pool.slices);
+    free(tids);
+    free(workers);
+}
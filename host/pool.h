@@ -0,0 +1,28 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+
+// Calls job(index, worker, ctx) for every index below count on threads worker threads.
+// Every worker owns a slice of the indices and steals chunks from the others once its own slice is done.
+typedef void (*POOL_JOB)(size_t index, unsigned int worker, void *ctx);
+
+void poolRun(size_t count, unsigned int threads, POOL_JOB job, void *ctx);
+unsigned int poolDefaultThreads();
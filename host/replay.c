@@ -0,0 +1,436 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "sim/sim.h"
+
+#include <ncfg.h>
+#include <settings.h>
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#define DEFAULT_PRESSES  1000
+#define DEFAULT_HOLD     50  // ms
+#define DEFAULT_INTERVAL 100 // ms
+
+int nincfgMain(); // src/main.c
+
+// "name=value" from the set and expect commands
+typedef struct
+{
+    int setting;
+    char value[SETTING_VALUE_SIZE];
+} EDIT;
+
+static char cfgPath[PATH_MAX]; // nincfg.bin on the simulated SD card
+static EDIT *expects;
+static size_t expectCount;
+static size_t failures;
+
+static const struct
+{
+    const char *name;
+    uint32_t button;
+} buttons[] = {
+    { "a", VPAD_BUTTON_A },
+    { "b", VPAD_BUTTON_B },
+    { "x", VPAD_BUTTON_X },
+    { "y", VPAD_BUTTON_Y },
+    { "up", VPAD_BUTTON_UP },
+    { "down", VPAD_BUTTON_DOWN },
+    { "left", VPAD_BUTTON_LEFT },
+    { "right", VPAD_BUTTON_RIGHT },
+    { "plus", VPAD_BUTTON_PLUS },
+    { "minus", VPAD_BUTTON_MINUS },
+    { "home", VPAD_BUTTON_HOME },
+    { "l", VPAD_BUTTON_L },
+    { "r", VPAD_BUTTON_R },
+    { "zl", VPAD_BUTTON_ZL },
+    { "zr", VPAD_BUTTON_ZR },
+};
+
+static uint32_t rngState = 0x4E494E43; // "NINC"
+
+static uint32_t rng()
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static uint32_t parseButtons(char *str)
+{
+    uint32_t ret = 0;
+    for(char *tok = strtok(str, "+"); tok != NULL; tok = strtok(NULL, "+"))
+    {
+        size_t i = 0;
+        while(i < sizeof(buttons) / sizeof(buttons[0]) && strcasecmp(tok, buttons[i].name) != 0)
+            ++i;
+        if(i == sizeof(buttons) / sizeof(buttons[0]))
+            return 0;
+
+        ret |= buttons[i].button;
+    }
+
+    return ret;
+}
+
+static bool parseEdit(const char *str, EDIT *edit)
+{
+    const char *value = strchr(str, '=');
+    if(value == NULL || value - str >= SETTING_VALUE_SIZE || strlen(value + 1) >= SETTING_VALUE_SIZE)
+        return false;
+
+    char name[SETTING_VALUE_SIZE];
+    memcpy(name, str, value - str);
+    name[value - str] = '\0';
+    strcpy(edit->value, value + 1);
+
+    NIN_CFG test = { 0 };
+    edit->setting = settingFind(name);
+    return edit->setting >= 0 && settingParse(&test, edit->setting, edit->value);
+}
+
+static bool readConfig(NIN_CFG *cfg)
+{
+    NIN_CFG raw;
+    int fd = open(cfgPath, O_RDONLY);
+    if(fd == -1)
+    {
+        perror(cfgPath);
+        return false;
+    }
+
+    ssize_t size = read(fd, &raw, sizeof(NIN_CFG));
+    close(fd);
+    NCFG_STATUS status = ncfgLoad(cfg, &raw, size < 0 ? 0 : size);
+    if(status != NCFG_OK)
+    {
+        fprintf(stderr, "%s: %s\n", cfgPath, ncfgStatusStr(status));
+        return false;
+    }
+
+    return true;
+}
+
+// Another program changing nincfg.bin while the app runs, the way nincfg-tool apply does it
+static void externalEdit(void *ctx)
+{
+    const EDIT *edit = ctx;
+    NIN_CFG cfg;
+    if(!readConfig(&cfg))
+    {
+        ++failures;
+        return;
+    }
+
+    ncfgNormalize(&cfg);
+    settingParse(&cfg, edit->setting, edit->value);
+    ncfgSerialize(&cfg, &cfg);
+
+    char tmp[PATH_MAX + 8];
+    snprintf(tmp, sizeof(tmp), "%s.other", cfgPath);
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd == -1 || write(fd, &cfg, sizeof(NIN_CFG)) != sizeof(NIN_CFG) || close(fd) != 0 || rename(tmp, cfgPath) != 0)
+    {
+        perror(tmp);
+        ++failures;
+    }
+}
+
+// Checks the expect commands against nincfg.bin as the app left it
+static void checkExpects()
+{
+    NIN_CFG cfg;
+    if(expectCount == 0 || !readConfig(&cfg))
+    {
+        failures += expectCount;
+        return;
+    }
+
+    for(size_t i = 0; i < expectCount; ++i)
+    {
+        // Parsing the value it already has doesn't change anything
+        NIN_CFG tmp = cfg;
+        settingParse(&tmp, expects[i].setting, expects[i].value);
+        if(memcmp(&tmp, &cfg, sizeof(NIN_CFG)) != 0)
+        {
+            char value[SETTING_VALUE_SIZE];
+            settingFormat(&cfg, expects[i].setting, value);
+            fprintf(stderr, "expected %s=%s, got %s\n", settings[expects[i].setting].name, expects[i].value, value);
+            ++failures;
+        }
+    }
+}
+
+// One command per line: Buttons joined by '+' (e.g. "down", "zl+a"), "wait <ms>" or "hold <ms>"
+// for the time following presses are held, "set <name>=<value>" to have another program change nincfg.bin
+// at this point and "expect <name>=<value>" to check it after the app exited. '#' starts a comment.
+static bool loadScript(const char *path, OSTime interval, OSTime *hold)
+{
+    FILE *f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if(f == NULL)
+    {
+        perror(path);
+        return false;
+    }
+
+    char line[256];
+    bool ret = true;
+    for(uint32_t n = 1; ret && fgets(line, sizeof(line), f) != NULL; ++n)
+    {
+        char *cmd = line;
+        char *end = strchr(cmd, '#');
+        if(end != NULL)
+            *end = '\0';
+
+        while(isspace((unsigned char)*cmd))
+            ++cmd;
+        end = cmd + strlen(cmd);
+        while(end > cmd && isspace((unsigned char)end[-1]))
+            *--end = '\0';
+        if(*cmd == '\0')
+            continue;
+
+        if(strncmp(cmd, "wait ", 5) == 0)
+            simWait(OSMillisecondsToTicks(strtoul(cmd + 5, NULL, 0)));
+        else if(strncmp(cmd, "hold ", 5) == 0)
+            *hold = OSMillisecondsToTicks(strtoul(cmd + 5, NULL, 0));
+        else if(strncmp(cmd, "set ", 4) == 0 || strncmp(cmd, "expect ", 7) == 0)
+        {
+            bool set = cmd[0] == 's';
+            EDIT *edit = malloc(sizeof(EDIT));
+            if(set && edit != NULL && parseEdit(cmd + 4, edit))
+                simEvent(externalEdit, edit);
+            else if(!set && edit != NULL && parseEdit(cmd + 7, edit))
+            {
+                EDIT *tmp = realloc(expects, (expectCount + 1) * sizeof(EDIT));
+                if(tmp != NULL)
+                {
+                    expects = tmp;
+                    expects[expectCount++] = *edit;
+                }
+
+                free(edit);
+            }
+            else
+            {
+                fprintf(stderr, "%s:%u: invalid edit\n", path, n);
+                free(edit);
+                ret = false;
+            }
+        }
+        else
+        {
+            uint32_t b = parseButtons(cmd);
+            if(b == 0)
+            {
+                fprintf(stderr, "%s:%u: unknown command\n", path, n);
+                ret = false;
+            }
+            else
+            {
+                simPress(b, *hold);
+                simWait(interval);
+            }
+        }
+    }
+
+    if(f != stdin)
+        fclose(f);
+
+    return ret;
+}
+
+// Random navigation and edits of the settings, then save and exit
+static void generateScript(size_t presses, OSTime interval, OSTime hold)
+{
+    static const uint32_t moves[] = { VPAD_BUTTON_UP, VPAD_BUTTON_DOWN, VPAD_BUTTON_LEFT, VPAD_BUTTON_RIGHT };
+    for(size_t i = 0; i < presses; ++i)
+    {
+        simPress(moves[rng() % 4], hold);
+        simWait(interval);
+    }
+
+    simPress(VPAD_BUTTON_PLUS, hold);
+}
+
+static bool writeDefaultConfig(const char *path)
+{
+    NIN_CFG cfg;
+    memset(&cfg, 0, sizeof(NIN_CFG));
+    cfg.Magicbytes = NCFG_MAGIC;
+    cfg.Version = NIN_CFG_VERSION;
+    cfg.Config = NIN_CFG_MEMCARDEMU;
+    cfg.VideoMode = NIN_VID_AUTO;
+    cfg.Language = NIN_LAN_AUTO;
+    cfg.MaxPads = NIN_CFG_MAXPAD;
+    cfg.MemCardBlocks = 2;
+    ncfgNormalize(&cfg);
+    ncfgSerialize(&cfg, &cfg);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd == -1)
+    {
+        perror(path);
+        return false;
+    }
+
+    bool ret = write(fd, &cfg, sizeof(NIN_CFG)) == sizeof(NIN_CFG);
+    close(fd);
+    return ret;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-s sdroot] [-n presses] [-i ms] [-t ms] [-d] [-q] [-h] [script]\n"
+            "Runs the unmodified UI against a simulated GamePad and SD card.\n"
+            "  -s  Directory to use as SD card (default: a temporary one with a fresh nincfg.bin)\n"
+            "  -n  Random presses when there's no script (default %u)\n"
+            "  -i  Time between presses in ms, 0 for as fast as the GamePad samples (default %u)\n"
+            "  -t  Time each button is held in ms (default %u)\n"
+            "  -d  Dump the text shown on the TV at exit\n"
+            "  -q  Don't print OSReport() messages\n"
+            "  -h  Show this help\n"
+            "Script lines are buttons joined by '+' (a, b, x, y, up, down, left, right, plus,\n"
+            "minus, home, l, r, zl, zr), \"wait <ms>\" or \"hold <ms>\". \"set <name>=<value>\" has\n"
+            "another program change nincfg.bin at that point, \"expect <name>=<value>\" checks it\n"
+            "once the app exited (exit code 2 if that fails).\n",
+            name, DEFAULT_PRESSES, DEFAULT_INTERVAL, DEFAULT_HOLD);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *sdRoot = NULL;
+    size_t presses = DEFAULT_PRESSES;
+    OSTime interval = OSMillisecondsToTicks(DEFAULT_INTERVAL);
+    OSTime hold = OSMillisecondsToTicks(DEFAULT_HOLD);
+    bool dump = false;
+    bool quiet = false;
+    int opt;
+    while((opt = getopt(argc, argv, "s:n:i:t:dqh")) != -1)
+    {
+        switch(opt)
+        {
+            case 's':
+                sdRoot = optarg;
+                break;
+            case 'n':
+                presses = strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                interval = OSMillisecondsToTicks(strtoul(optarg, NULL, 0));
+                break;
+            case 't':
+                hold = OSMillisecondsToTicks(strtoul(optarg, NULL, 0));
+                break;
+            case 'd':
+                dump = true;
+                break;
+            case 'q':
+                quiet = true;
+                break;
+            case 'h':
+                usage(argv[0]);
+                return 0;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if(argc - optind > 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char tmpRoot[] = "/tmp/nincfg-replay.XXXXXX";
+    if(sdRoot == NULL)
+    {
+        if(mkdtemp(tmpRoot) == NULL)
+        {
+            perror(tmpRoot);
+            return 1;
+        }
+
+        snprintf(cfgPath, sizeof(cfgPath), "%s/nincfg.bin", tmpRoot);
+        if(!writeDefaultConfig(cfgPath))
+        {
+            rmdir(tmpRoot);
+            return 1;
+        }
+
+        sdRoot = tmpRoot;
+    }
+    else
+        snprintf(cfgPath, sizeof(cfgPath), "%s/nincfg.bin", sdRoot);
+
+    simInit(sdRoot, quiet ? NULL : stderr);
+    if(optind < argc)
+    {
+        if(!loadScript(argv[optind], interval, &hold))
+            return 1;
+    }
+    else
+        generateScript(presses, interval, hold);
+
+    nincfgMain();
+    checkExpects();
+
+    const SIM_STATS *stats = simStats();
+    if(dump)
+    {
+        for(uint32_t i = 0; i < SIM_LINES; ++i)
+            printf("|%s\n", simLine(i));
+    }
+
+    printf("replay: %llu presses in %llu frames, %.1f s virtual time, %llu samples (%llu dropped)%s\n",
+           (unsigned long long)stats->presses, (unsigned long long)stats->frames, stats->elapsed / 1e9,
+           (unsigned long long)stats->samples, (unsigned long long)stats->dropped,
+           stats->exited ? "" : ", didn't exit");
+    if(stats->inputFrames)
+        printf("  input:  %llu frames, %.2f us avg, %.2f us max per frame, %.2f us per press\n",
+               (unsigned long long)stats->inputFrames, stats->inputTicks / 1e3 / stats->inputFrames,
+               stats->inputMax / 1e3, stats->inputTicks / 1e3 / stats->presses);
+    if(stats->draws)
+        printf("  redraw: %llu flips, %.1f KB flushed per flip\n",
+               (unsigned long long)stats->draws, stats->flushed / 1024.0 / stats->draws);
+
+    if(sdRoot == tmpRoot)
+    {
+        unlink(cfgPath);
+        rmdir(tmpRoot);
+    }
+
+    if(failures)
+    {
+        fprintf(stderr, "%zu checks failed!\n", failures);
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,400 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "tool.h"
+
+#include <migrate.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86
+#endif
+
+#define SCAN_WINDOW (256 * 1024 * 1024) // Mapped pages get dropped behind the scanner in steps of this
+#define SCAN_MAGIC_SIZE 4
+
+// NCFG_MAGIC as it's stored on disk
+static const uint8_t magicBytes[SCAN_MAGIC_SIZE] = { 0x01, 0x07, 0x0C, 0xF6 };
+
+// Returns the first magic starting in [p, end) or NULL. limit is the end of the data, a magic starting
+// right before end may reach behind it.
+typedef const uint8_t *(*FIND_FN)(const uint8_t *p, const uint8_t *end, const uint8_t *limit);
+
+typedef struct
+{
+    const char *name;
+    FIND_FN find;
+    bool (*supported)();
+} FINDER;
+
+typedef struct
+{
+    const char *outDir;
+    bool dryRun;
+    bool verbose;
+    MIGRATION migration;
+    size_t hits;
+    size_t valid;
+    size_t extracted;
+    size_t failed;
+} SCAN_JOB;
+
+static void scanUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool scan [-o dir] [-n] [-v] [-b] [-f finder] image...\n\n"
+                    "  -o  Where to extract the configs to (default: current directory)\n"
+                    "  -n  Dry run, report what would be extracted only\n"
+                    "  -v  Report hits which aren't valid configs, too\n"
+                    "  -b  Time all finders on the images instead\n"
+                    "  -f  Finder to use (default: the fastest the CPU supports)\n\n"
+                    "Searches SD card images, tar backups or block devices for nincfg.bin files. Configs\n"
+                    "which load like in the app get written as <image>@<offset>.bin, unchanged.\n");
+}
+
+static inline bool isMagic(const uint8_t *p)
+{
+    return memcmp(p, magicBytes, SCAN_MAGIC_SIZE) == 0;
+}
+
+// The baseline: One byte per step
+static const uint8_t *findScalar(const uint8_t *p, const uint8_t *end, const uint8_t *limit)
+{
+    for(; p < end && p + SCAN_MAGIC_SIZE <= limit; ++p)
+        if(p[0] == magicBytes[0] && isMagic(p))
+            return p;
+
+    return NULL;
+}
+
+static bool always()
+{
+    return true;
+}
+
+#ifdef SCAN_X86
+// Compares the first and the last magic byte for every lane at once, only lanes matching both get a full compare
+__attribute__((target("sse2"))) static const uint8_t *findSSE2(const uint8_t *p, const uint8_t *end,
+                                                                 const uint8_t *limit)
+{
+    const __m128i first = _mm_set1_epi8(magicBytes[0]);
+    const __m128i last = _mm_set1_epi8(magicBytes[SCAN_MAGIC_SIZE - 1]);
+    for(; p + 16 <= end && p + 16 + SCAN_MAGIC_SIZE - 1 <= limit; p += 16)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *)p);
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + SCAN_MAGIC_SIZE - 1));
+        uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        for(; mask != 0; mask &= mask - 1)
+            if(isMagic(p + __builtin_ctz(mask)))
+                return p + __builtin_ctz(mask);
+    }
+
+    return findScalar(p, end, limit);
+}
+
+// Same with 32 byte lanes, two of them per round so the loop overhead stays below the loads
+__attribute__((target("avx2"))) static const uint8_t *findAVX2(const uint8_t *p, const uint8_t *end,
+                                                                 const uint8_t *limit)
+{
+    const __m256i first = _mm256_set1_epi8(magicBytes[0]);
+    const __m256i last = _mm256_set1_epi8(magicBytes[SCAN_MAGIC_SIZE - 1]);
+    for(; p + 64 <= end && p + 64 + SCAN_MAGIC_SIZE - 1 <= limit; p += 64)
+    {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)p);
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)(p + SCAN_MAGIC_SIZE - 1));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(p + 32));
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(p + 32 + SCAN_MAGIC_SIZE - 1));
+        __m256i m0 = _mm256_and_si256(_mm256_cmpeq_epi8(a0, first), _mm256_cmpeq_epi8(b0, last));
+        __m256i m1 = _mm256_and_si256(_mm256_cmpeq_epi8(a1, first), _mm256_cmpeq_epi8(b1, last));
+        if(_mm256_testz_si256(_mm256_or_si256(m0, m1), _mm256_or_si256(m0, m1)))
+            continue;
+
+        uint64_t mask = (uint32_t)_mm256_movemask_epi8(m0) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(m1) << 32);
+        for(; mask != 0; mask &= mask - 1)
+            if(isMagic(p + __builtin_ctzll(mask)))
+                return p + __builtin_ctzll(mask);
+    }
+
+    return findSSE2(p, end, limit);
+}
+
+static bool hasSSE2()
+{
+    return __builtin_cpu_supports("sse2");
+}
+
+static bool hasAVX2()
+{
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+// Fastest last
+static const FINDER finders[] = {
+    { "scalar", findScalar, always },
+#ifdef SCAN_X86
+    { "sse2", findSSE2, hasSSE2 },
+    { "avx2", findAVX2, hasAVX2 },
+#endif
+};
+
+#define FINDER_COUNT (sizeof(finders) / sizeof(finders[0]))
+
+// Maps a whole image, which may be a block device
+static const uint8_t *mapImage(const char *path, size_t *size)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    const uint8_t *data = NULL;
+    off_t end = lseek(fd, 0, SEEK_END);
+    if(end < 0)
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    else if(end == 0)
+        fprintf(stderr, "%s: Empty file\n", path);
+    else
+    {
+        void *map = mmap(NULL, end, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(map == MAP_FAILED)
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        else
+        {
+            madvise(map, end, MADV_SEQUENTIAL);
+            data = map;
+            *size = end;
+        }
+    }
+
+    close(fd);
+    return data;
+}
+
+// Loads the config at hit like the app would. Hits which don't fit, have unknown versions and so on fail.
+static void checkHit(SCAN_JOB *job, const char *path, const uint8_t *hit, size_t offset, size_t left)
+{
+    // The version decides the size, but a hit at the very end may not even have one
+    NIN_CFG cfg;
+    uint32_t version = 0;
+    size_t size = 0;
+    if(left >= sizeof(uint32_t) * 2)
+    {
+        memcpy(&version, hit + sizeof(uint32_t), sizeof(uint32_t));
+        version = ncfgBE32(version);
+        size = migrationSize(version); // 0 for unknown versions
+    }
+
+    NCFG_STATUS status = left < sizeof(uint32_t) * 2 || size > left ? NCFG_ERROR_SIZE :
+                         size == 0 ? NCFG_ERROR_VERSION : migrationLoad(&cfg, hit, size, &job->migration);
+
+    ++job->hits;
+    if(status != NCFG_OK)
+    {
+        if(job->verbose)
+            printf("%s@%012zx: %s\n", path, offset, ncfgStatusStr(status));
+
+        return;
+    }
+
+    // Same as loading in the app, so report what it would change on the first save
+    NIN_CFG normalized = cfg;
+    ncfgNormalize(&normalized);
+    bool changes = memcmp(&normalized, &cfg, sizeof(NIN_CFG)) != 0;
+    ++job->valid;
+
+    const char *name = strrchr(path, '/');
+    name = name == NULL ? path : name + 1;
+    char out[4096];
+    snprintf(out, sizeof(out), "%s/%s@%012zx.bin", job->outDir, name, offset);
+    printf("%s@%012zx: version %u, %zu bytes%s -> %s\n", path, offset, version, size, changes ? ", gets normalized" : "", job->dryRun ? "(dry run)" : out);
+    if(job->dryRun)
+        return;
+
+    const char *err = writeFile(out, hit, size);
+    if(err != NULL)
+    {
+        fprintf(stderr, "%s: %s\n", out, err);
+        ++job->failed;
+    }
+    else
+        ++job->extracted;
+}
+
+static void scanImage(SCAN_JOB *job, const char *path, const uint8_t *data, size_t size, FIND_FN find)
+{
+    const uint8_t *end = data + size;
+    const uint8_t *dropped = data;
+    const uint8_t *p = data;
+    while(p < end)
+    {
+        // Find windows of SCAN_WINDOW so already scanned pages can leave the page tables in time
+        const uint8_t *windowEnd = end - p > SCAN_WINDOW ? p + SCAN_WINDOW : end;
+        const uint8_t *hit = find(p, windowEnd, end);
+        if(hit == NULL)
+        {
+            p = windowEnd;
+            if(p - dropped >= SCAN_WINDOW)
+            {
+                size_t length = (p - dropped) & ~(size_t)(sysconf(_SC_PAGESIZE) - 1);
+                madvise((void *)dropped, length, MADV_DONTNEED);
+                dropped += length;
+            }
+
+            continue;
+        }
+
+        checkHit(job, path, hit, hit - data, end - hit);
+        p = hit + 1;
+    }
+}
+
+static int benchFinders(char *paths[], int count)
+{
+    size_t hits[FINDER_COUNT] = { 0 };
+    for(uint32_t f = 0; f < FINDER_COUNT; ++f)
+    {
+        if(!finders[f].supported())
+        {
+            printf("%-8s not supported by this CPU\n", finders[f].name);
+            continue;
+        }
+
+        size_t bytes = 0;
+        uint64_t elapsed = 0;
+        for(int i = 0; i < count; ++i)
+        {
+            size_t size;
+            const uint8_t *data = mapImage(paths[i], &size);
+            if(data == NULL)
+                return 1;
+
+            // Touch every page untimed first, so all finders read from memory and not from the disk
+            const uint8_t *end = data + size;
+            volatile uint8_t sink = 0;
+            for(size_t o = 0; o < size; o += 4096)
+                sink ^= data[o];
+
+            uint64_t start = nanoTime();
+            for(const uint8_t *p = data; (p = finders[f].find(p, end, end)) != NULL; ++p)
+                ++hits[f];
+
+            elapsed += nanoTime() - start;
+            bytes += size;
+            munmap((void *)data, size);
+        }
+
+        printf("%-8s %zu hits in %.3f s (%.1f MB/s)\n", finders[f].name, hits[f], elapsed / 1e9,
+               bytes / (elapsed / 1e9) / (1024 * 1024));
+        if(hits[f] != hits[0])
+        {
+            fprintf(stderr, "%s found %zu hits but scalar %zu!\n", finders[f].name, hits[f], hits[0]);
+            return 2;
+        }
+    }
+
+    return 0;
+}
+
+int cmdScan(int argc, char *argv[])
+{
+    SCAN_JOB job = { .outDir = "." };
+    const FINDER *finder = NULL;
+    bool bench = false;
+    int opt;
+
+    while((opt = getopt(argc, argv, "o:nvbf:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'o':
+                job.outDir = optarg;
+                break;
+            case 'n':
+                job.dryRun = true;
+                break;
+            case 'v':
+                job.verbose = true;
+                break;
+            case 'b':
+                bench = true;
+                break;
+            case 'f':
+                for(uint32_t f = 0; f < FINDER_COUNT; ++f)
+                    if(strcmp(optarg, finders[f].name) == 0 && finders[f].supported())
+                        finder = finders + f;
+
+                if(finder == NULL)
+                {
+                    fprintf(stderr, "Unknown or unsupported finder: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                scanUsage();
+                return 1;
+        }
+    }
+
+    if(optind == argc)
+    {
+        scanUsage();
+        return 1;
+    }
+
+    if(bench)
+        return benchFinders(argv + optind, argc - optind);
+
+    for(uint32_t f = FINDER_COUNT; finder == NULL; --f)
+        if(finders[f - 1].supported())
+            finder = finders + f - 1;
+
+    size_t bytes = 0;
+    uint64_t start = nanoTime();
+    for(int i = optind; i < argc; ++i)
+    {
+        size_t size;
+        const uint8_t *data = mapImage(argv[i], &size);
+        if(data == NULL)
+        {
+            ++job.failed;
+            continue;
+        }
+
+        scanImage(&job, argv[i], data, size, finder->find);
+        munmap((void *)data, size);
+        bytes += size;
+    }
+
+    double elapsed = (nanoTime() - start) / 1e9;
+    printf("%zu bytes, %zu hits, %zu valid, %zu %s, %zu failed in %.3f s (%.1f MB/s, %s)\n", bytes, job.hits,
+           job.valid, job.dryRun ? job.valid : job.extracted, job.dryRun ? "would be extracted" : "extracted",
+           job.failed, elapsed, bytes / elapsed / (1024 * 1024), finder->name);
+
+    return job.failed ? 2 : 0;
+}
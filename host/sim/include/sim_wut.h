@@ -0,0 +1,321 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+// Stand-ins for the parts of wut, libmocha and the Wii U OS Nincfg uses, so src/main.c builds and runs
+// unmodified on Linux. The headers under coreinit/, vpad/ and so on only include this file.
+// The behaviour behind it (scripted input, captured screen, SD card in a host directory) is in sim.c.
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int32_t BOOL;
+#define TRUE  1
+#define FALSE 0
+
+// coreinit/time.h: One tick is one nanosecond here
+typedef int64_t OSTime;
+typedef int32_t OSTick;
+
+#define OSTimerClockSpeed           1000000000ll
+#define OSSecondsToTicks(val)       ((int64_t)(val) * OSTimerClockSpeed)
+#define OSMillisecondsToTicks(val)  ((int64_t)(val) * 1000000ll)
+#define OSMicrosecondsToTicks(val)  ((int64_t)(val) * 1000ll)
+#define OSNanosecondsToTicks(val)   ((int64_t)(val))
+#define OSTicksToSeconds(val)       ((uint64_t)(val) / OSTimerClockSpeed)
+#define OSTicksToMilliseconds(val)  ((uint64_t)(val) / 1000000ull)
+#define OSTicksToMicroseconds(val)  ((unsigned long long)(val) / 1000ull)
+
+OSTime OSGetSystemTime();
+OSTick OSGetTick();
+void OSSleepTicks(OSTime ticks);
+
+// coreinit/debug.h
+void OSReport(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+// coreinit/memory.h, coreinit/memdefaultheap.h
+void *OSBlockMove(void *dst, const void *src, uint32_t size, BOOL flush);
+void *OSBlockSet(void *dst, uint8_t val, uint32_t size);
+void *MEMAllocFromDefaultHeapEx(uint32_t size, int32_t alignment);
+void MEMFreeToDefaultHeap(void *ptr);
+
+// coreinit/thread.h, backed by pthreads. Priorities and affinities are ignored.
+typedef int (*OSThreadEntryPointFn)(int argc, const char **argv);
+
+typedef enum
+{
+    OS_THREAD_ATTRIB_AFFINITY_CPU0 = 1 << 0,
+    OS_THREAD_ATTRIB_AFFINITY_CPU1 = 1 << 1,
+    OS_THREAD_ATTRIB_AFFINITY_CPU2 = 1 << 2,
+    OS_THREAD_ATTRIB_AFFINITY_ANY  = 7,
+    OS_THREAD_ATTRIB_DETACHED      = 1 << 3,
+} OSThreadAttributes;
+
+typedef struct
+{
+    pthread_t handle;
+    OSThreadEntryPointFn entry;
+    int argc;
+    const char **argv;
+    int result;
+} OSThread;
+
+BOOL OSCreateThread(OSThread *thread, OSThreadEntryPointFn entry, int32_t argc, char *argv, void *stack, uint32_t stackSize,
+                    int32_t priority, OSThreadAttributes attributes);
+int32_t OSResumeThread(OSThread *thread);
+BOOL OSJoinThread(OSThread *thread, int *threadResult);
+void OSSetThreadName(OSThread *thread, const char *name);
+
+// coreinit/messagequeue.h
+typedef enum
+{
+    OS_MESSAGE_FLAGS_NONE           = 0,
+    OS_MESSAGE_FLAGS_BLOCKING       = 1 << 0,
+    OS_MESSAGE_FLAGS_HIGH_PRIORITY  = 1 << 1,
+} OSMessageFlags;
+
+typedef struct
+{
+    void *message;
+    uint32_t args[3];
+} OSMessage;
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    OSMessage *messages;
+    uint32_t size;
+    uint32_t first;
+    uint32_t used;
+    uint32_t waiting; // Threads blocked in OSReceiveMessage()
+    uint32_t woken;   // Of these, the ones a message is on its way to
+} OSMessageQueue;
+
+void OSInitMessageQueue(OSMessageQueue *queue, OSMessage *messages, int32_t size);
+BOOL OSSendMessage(OSMessageQueue *queue, OSMessage *message, OSMessageFlags flags);
+BOOL OSReceiveMessage(OSMessageQueue *queue, OSMessage *message, OSMessageFlags flags);
+
+// coreinit/title.h, coreinit/foreground.h, sysapp/launch.h
+uint64_t OSGetTitleID();
+void OSEnableHomeButtonMenu(BOOL enable);
+void OSSavesDone_ReadyToRelease();
+void SYSLaunchMenu();
+void SYSRelaunchTitle(uint32_t argc, char *argv[]);
+
+// coreinit/filesystem_fsa.h
+#define FS_MAX_PATH 0x27F
+
+typedef uint32_t FSAClientHandle;
+typedef int32_t FSAFileHandle;
+typedef int32_t FSADirectoryHandle;
+typedef uint32_t FSMode;
+typedef uint32_t FSAReadFlag;
+typedef uint32_t FSAWriteFlag;
+
+typedef enum
+{
+    FS_ERROR_OK                 = 0,
+    FS_ERROR_END_OF_DIR         = -0x30004,
+    FS_ERROR_END_OF_FILE        = -0x30005,
+    FS_ERROR_MEDIA_ERROR        = -0x30021,
+    FS_ERROR_ALREADY_EXISTS     = -0x30016,
+    FS_ERROR_NOT_FOUND          = -0x30017,
+    FS_ERROR_PERMISSION_ERROR   = -0x3001A,
+    FS_ERROR_INVALID_PARAM      = -0x30023,
+} FSError;
+
+typedef enum
+{
+    FS_OPEN_FLAG_NONE = 0,
+} FSOpenFileFlags;
+
+typedef enum
+{
+    FS_STAT_DIRECTORY = 0x80000000,
+} FSStatFlags;
+
+typedef struct
+{
+    uint32_t flags;
+    uint32_t mode;
+    uint32_t size;
+    uint64_t created;
+    uint64_t modified;
+} FSStat;
+
+typedef FSStat FSAStat;
+
+typedef struct
+{
+    FSStat info;
+    char name[256];
+} FSDirectoryEntry;
+
+typedef FSDirectoryEntry FSADirectoryEntry;
+
+FSError FSAInit();
+void FSAShutdown();
+FSAClientHandle FSAAddClient(void *attachAsyncData);
+FSError FSADelClient(FSAClientHandle client);
+const char *FSAGetStatusStr(FSError error);
+FSError FSAOpenFileEx(FSAClientHandle client, const char *path, const char *mode, FSMode createMode,
+                      FSOpenFileFlags openFlag, uint32_t preallocSize, FSAFileHandle *outHandle);
+FSError FSACloseFile(FSAClientHandle client, FSAFileHandle handle);
+FSError FSAReadFile(FSAClientHandle client, void *buffer, uint32_t size, uint32_t count, FSAFileHandle handle, FSAReadFlag flags);
+FSError FSAReadFileWithPos(FSAClientHandle client, void *buffer, uint32_t size, uint32_t count, uint32_t pos, FSAFileHandle handle,
+                           FSAReadFlag flags);
+FSError FSAWriteFile(FSAClientHandle client, void *buffer, uint32_t size, uint32_t count, FSAFileHandle handle, FSAWriteFlag flags);
+FSError FSAFlushFile(FSAClientHandle client, FSAFileHandle handle);
+FSError FSAFlushVolume(FSAClientHandle client, const char *path);
+FSError FSAGetStat(FSAClientHandle client, const char *path, FSAStat *stat);
+FSError FSAGetStatFile(FSAClientHandle client, FSAFileHandle handle, FSAStat *stat);
+FSError FSARemove(FSAClientHandle client, const char *path);
+FSError FSARename(FSAClientHandle client, const char *oldPath, const char *newPath);
+FSError FSAOpenDir(FSAClientHandle client, const char *path, FSADirectoryHandle *dirHandle);
+FSError FSAReadDir(FSAClientHandle client, FSADirectoryHandle handle, FSADirectoryEntry *entry);
+FSError FSACloseDir(FSAClientHandle client, FSADirectoryHandle handle);
+
+// proc_ui/procui.h
+typedef enum
+{
+    PROCUI_STATUS_IN_FOREGROUND,
+    PROCUI_STATUS_IN_BACKGROUND,
+    PROCUI_STATUS_RELEASE_FOREGROUND,
+    PROCUI_STATUS_EXITING,
+} ProcUIStatus;
+
+typedef enum
+{
+    PROCUI_CALLBACK_ACQUIRE,
+    PROCUI_CALLBACK_RELEASE,
+    PROCUI_CALLBACK_EXIT,
+    PROCUI_CALLBACK_NET_IO_START,
+    PROCUI_CALLBACK_NET_IO_STOP,
+    PROCUI_CALLBACK_HOME_BUTTON_DENIED,
+} ProcUICallbackType;
+
+typedef void (*ProcUISaveCallback)();
+typedef uint32_t (*ProcUICallback)(void *context);
+
+void ProcUIInit(ProcUISaveCallback saveCallback);
+void ProcUIRegisterCallback(ProcUICallbackType type, ProcUICallback callback, void *param, uint32_t priority);
+ProcUIStatus ProcUIProcessMessages(BOOL block);
+void ProcUIDrawDoneRelease();
+
+// vpad/input.h, same bits as on the console
+typedef enum
+{
+    VPAD_BUTTON_SYNC                = 0x00000001,
+    VPAD_BUTTON_HOME                = 0x00000002,
+    VPAD_BUTTON_MINUS               = 0x00000004,
+    VPAD_BUTTON_PLUS                = 0x00000008,
+    VPAD_BUTTON_R                   = 0x00000010,
+    VPAD_BUTTON_L                   = 0x00000020,
+    VPAD_BUTTON_ZR                  = 0x00000040,
+    VPAD_BUTTON_ZL                  = 0x00000080,
+    VPAD_BUTTON_DOWN                = 0x00000100,
+    VPAD_BUTTON_UP                  = 0x00000200,
+    VPAD_BUTTON_RIGHT               = 0x00000400,
+    VPAD_BUTTON_LEFT                = 0x00000800,
+    VPAD_BUTTON_Y                   = 0x00001000,
+    VPAD_BUTTON_X                   = 0x00002000,
+    VPAD_BUTTON_B                   = 0x00004000,
+    VPAD_BUTTON_A                   = 0x00008000,
+    VPAD_BUTTON_TV                  = 0x00010000,
+    VPAD_BUTTON_STICK_R             = 0x00020000,
+    VPAD_BUTTON_STICK_L             = 0x00040000,
+    VPAD_STICK_R_EMULATION_DOWN     = 0x00800000,
+    VPAD_STICK_R_EMULATION_UP       = 0x01000000,
+    VPAD_STICK_R_EMULATION_RIGHT    = 0x02000000,
+    VPAD_STICK_R_EMULATION_LEFT     = 0x04000000,
+    VPAD_STICK_L_EMULATION_DOWN     = 0x08000000,
+    VPAD_STICK_L_EMULATION_UP       = 0x10000000,
+    VPAD_STICK_L_EMULATION_RIGHT    = 0x20000000,
+    VPAD_STICK_L_EMULATION_LEFT     = 0x40000000,
+} VPADButtons;
+
+typedef enum
+{
+    VPAD_CHAN_0 = 0,
+} VPADChan;
+
+typedef enum
+{
+    VPAD_READ_SUCCESS           = 0,
+    VPAD_READ_NO_SAMPLES        = -1,
+    VPAD_READ_INVALID_CONTROLLER = -2,
+} VPADReadError;
+
+typedef struct
+{
+    uint32_t hold;
+    uint32_t trigger;
+    uint32_t release;
+} VPADStatus;
+
+int32_t VPADRead(VPADChan chan, VPADStatus *buffers, uint32_t count, VPADReadError *outError);
+
+// coreinit/screen.h: Framebuffers in plain memory with a made up font, see sim.c
+typedef enum
+{
+    SCREEN_TV  = 0,
+    SCREEN_DRC = 1,
+} OSScreenID;
+
+void OSScreenInit();
+void OSScreenShutdown();
+uint32_t OSScreenGetBufferSizeEx(OSScreenID screen);
+void OSScreenSetBufferEx(OSScreenID screen, void *addr);
+void OSScreenClearBufferEx(OSScreenID screen, uint32_t colour);
+void OSScreenFlipBuffersEx(OSScreenID screen);
+void OSScreenPutFontEx(OSScreenID screen, uint32_t column, uint32_t row, const char *buffer);
+void OSScreenPutPixelEx(OSScreenID screen, uint32_t x, uint32_t y, uint32_t colour);
+uint32_t OSScreenEnableEx(OSScreenID screen, BOOL enable);
+
+// coreinit/cache.h
+void DCFlushRange(void *addr, uint32_t size);
+
+// coreinit/memheap.h, coreinit/memfrmheap.h: MEM1 is a single frame heap with one recorded state
+typedef void *MEMHeapHandle;
+
+typedef enum
+{
+    MEM_BASE_HEAP_MEM1  = 0,
+    MEM_BASE_HEAP_MEM2  = 1,
+    MEM_BASE_HEAP_FG    = 8,
+} MEMBaseHeapType;
+
+MEMHeapHandle MEMGetBaseHeapHandle(MEMBaseHeapType type);
+BOOL MEMRecordStateForFrmHeap(MEMHeapHandle heap, uint32_t tag);
+BOOL MEMFreeByStateToFrmHeap(MEMHeapHandle heap, uint32_t tag);
+void *MEMAllocFromFrmHeapEx(MEMHeapHandle heap, uint32_t size, int alignment);
+
+// mocha/mocha.h
+typedef enum
+{
+    MOCHA_RESULT_SUCCESS = 0,
+    MOCHA_RESULT_UNKNOWN_ERROR = -0x100,
+} MochaUtilsStatus;
+
+MochaUtilsStatus Mocha_InitLibrary();
+MochaUtilsStatus Mocha_DeInitLibrary();
+MochaUtilsStatus Mocha_UnlockFSClientEx(FSAClientHandle client);
@@ -0,0 +1,1040 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "sim.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SIM_FILES     16
+#define SIM_SD_PATH   "/vol/external01"
+#define SIM_VPAD_SIZE 16 // Samples the VPAD ring buffer holds
+#define SIM_GLYPH_WIDTH  12
+#define SIM_GLYPH_HEIGHT 24
+#define SIM_FONT_COLOR   0xFFFFFFFF
+#define SIM_MEM1_SIZE    (16 * 1024 * 1024) // Enough for both screens
+#define SIM_MEM1_ALIGN   0x100
+
+typedef struct
+{
+    OSTime at;
+    uint32_t hold;
+} SAMPLE;
+
+typedef struct
+{
+    OSTime at;
+    void (*run)(void *ctx);
+    void *ctx;
+} EVENT;
+
+typedef struct
+{
+    uint32_t *buffer;
+    uint32_t width;
+    uint32_t height;
+    uint32_t pitch; // In pixels
+    uint32_t front;
+} SIM_SCREEN;
+
+static SIM_STATS stats;
+static const char *sdRoot = ".";
+static FILE *reportFile;
+
+static _Atomic OSTime offset; // Virtual minus real time, threads read it through OSGetSystemTime()
+static OSTime start;
+static atomic_int busyThreads; // Threads from OSCreateThread() which aren't waiting for a message
+
+static SAMPLE *queue;
+static size_t queueSize;
+static size_t queueCapacity;
+static size_t queueNext;
+static OSTime queueEnd; // When the next simPress() starts, relative to simInit()
+static EVENT *events;
+static size_t eventCount;
+static size_t eventNext;
+static uint32_t lastHold;
+
+static OSTime inputStart; // Real time, 0 while no frame with input is running
+
+static ProcUICallback homeButtonCallback;
+static void *homeButtonParam;
+static bool homePressed;
+
+static int files[SIM_FILES];
+static DIR *dirs[SIM_FILES];
+static pthread_mutex_t filesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static SIM_SCREEN screens[2] = {
+    { .width = 1280, .height = 720, .pitch = 1280 },
+    { .width = 854, .height = 480, .pitch = 896 },
+};
+
+static struct
+{
+    uint8_t *base;
+    size_t used;
+    size_t state;
+} mem1;
+
+static OSTime realTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (OSTime)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static void endInputFrame()
+{
+    if(!inputStart)
+        return;
+
+    OSTime time = realTime() - inputStart;
+    stats.inputTicks += time;
+    if(time > stats.inputMax)
+        stats.inputMax = time;
+
+    inputStart = 0;
+}
+
+void simInit(const char *root, FILE *report)
+{
+    sdRoot = root;
+    reportFile = report;
+    for(int i = 0; i < SIM_FILES; ++i)
+        files[i] = -1;
+
+    offset = 0;
+    start = OSGetSystemTime();
+}
+
+static bool queueSample(OSTime at, uint32_t hold)
+{
+    if(queueSize == queueCapacity)
+    {
+        size_t capacity = queueCapacity ? queueCapacity * 2 : 256;
+        SAMPLE *tmp = realloc(queue, capacity * sizeof(SAMPLE));
+        if(tmp == NULL)
+            return false;
+
+        queue = tmp;
+        queueCapacity = capacity;
+    }
+
+    queue[queueSize].at = at;
+    queue[queueSize++].hold = hold;
+    return true;
+}
+
+bool simPress(uint32_t buttons, OSTime holdTicks)
+{
+    if(holdTicks < SIM_SAMPLE_TICKS)
+        holdTicks = SIM_SAMPLE_TICKS;
+
+    if(!queueSample(queueEnd, buttons) || !queueSample(queueEnd + holdTicks, 0))
+        return false;
+
+    queueEnd += holdTicks + SIM_SAMPLE_TICKS;
+    return true;
+}
+
+void simWait(OSTime ticks)
+{
+    queueEnd += ticks;
+}
+
+bool simEvent(void (*event)(void *ctx), void *ctx)
+{
+    EVENT *tmp = realloc(events, (eventCount + 1) * sizeof(EVENT));
+    if(tmp == NULL)
+        return false;
+
+    events = tmp;
+    events[eventCount].at = queueEnd;
+    events[eventCount].run = event;
+    events[eventCount++].ctx = ctx;
+    return true;
+}
+
+const SIM_STATS *simStats()
+{
+    stats.elapsed = OSGetSystemTime() - start;
+    return &stats;
+}
+
+// coreinit
+
+OSTime OSGetSystemTime()
+{
+    return realTime() + offset;
+}
+
+OSTick OSGetTick()
+{
+    return (OSTick)OSGetSystemTime();
+}
+
+// Skipping time is only fine while no other thread works, else the clock has to run in real time
+void OSSleepTicks(OSTime ticks)
+{
+    endInputFrame();
+    if(busyThreads)
+    {
+        struct timespec ts = { .tv_sec = ticks / 1000000000ll, .tv_nsec = ticks % 1000000000ll };
+        nanosleep(&ts, NULL);
+    }
+    else
+        offset += ticks;
+}
+
+void OSReport(const char *fmt, ...)
+{
+    if(reportFile == NULL)
+        return;
+
+    va_list va;
+    va_start(va, fmt);
+    vfprintf(reportFile, fmt, va);
+    va_end(va);
+}
+
+void *OSBlockMove(void *dst, const void *src, uint32_t size, BOOL flush)
+{
+    return memmove(dst, src, size);
+}
+
+void *OSBlockSet(void *dst, uint8_t val, uint32_t size)
+{
+    return memset(dst, val, size);
+}
+
+void *MEMAllocFromDefaultHeapEx(uint32_t size, int32_t alignment)
+{
+    if(alignment < (int32_t)sizeof(void *))
+        alignment = sizeof(void *);
+
+    void *ptr;
+    return posix_memalign(&ptr, alignment, size) == 0 ? ptr : NULL;
+}
+
+void MEMFreeToDefaultHeap(void *ptr)
+{
+    free(ptr);
+}
+
+static void *threadMain(void *arg)
+{
+    OSThread *thread = arg;
+    thread->result = thread->entry(thread->argc, thread->argv);
+    --busyThreads;
+    return NULL;
+}
+
+BOOL OSCreateThread(OSThread *thread, OSThreadEntryPointFn entry, int32_t argc, char *argv, void *stack, uint32_t stackSize,
+                    int32_t priority, OSThreadAttributes attributes)
+{
+    thread->entry = entry;
+    thread->argc = argc;
+    thread->argv = (const char **)argv;
+    thread->result = 0;
+    return TRUE;
+}
+
+// Threads get created suspended on the console, so this is where the pthread starts
+int32_t OSResumeThread(OSThread *thread)
+{
+    ++busyThreads;
+    if(pthread_create(&thread->handle, NULL, threadMain, thread) == 0)
+        return 1;
+
+    --busyThreads;
+    return 0;
+}
+
+BOOL OSJoinThread(OSThread *thread, int *threadResult)
+{
+    if(pthread_join(thread->handle, NULL) != 0)
+        return FALSE;
+
+    if(threadResult != NULL)
+        *threadResult = thread->result;
+
+    return TRUE;
+}
+
+void OSSetThreadName(OSThread *thread, const char *name)
+{
+}
+
+void OSInitMessageQueue(OSMessageQueue *queue, OSMessage *messages, int32_t size)
+{
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+    queue->messages = messages;
+    queue->size = size;
+    queue->first = queue->used = 0;
+    queue->waiting = queue->woken = 0;
+}
+
+BOOL OSSendMessage(OSMessageQueue *queue, OSMessage *message, OSMessageFlags flags)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while(queue->used == queue->size)
+    {
+        if(!(flags & OS_MESSAGE_FLAGS_BLOCKING))
+        {
+            pthread_mutex_unlock(&queue->mutex);
+            return FALSE;
+        }
+
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    }
+
+    if(flags & OS_MESSAGE_FLAGS_HIGH_PRIORITY)
+    {
+        queue->first = (queue->first + queue->size - 1) % queue->size;
+        queue->messages[queue->first] = *message;
+    }
+    else
+        queue->messages[(queue->first + queue->used) % queue->size] = *message;
+
+    // The receiver counts as busy from now on, not only once it got scheduled. Else the
+    // sender could skip ahead in time before the receiver even started working.
+    if(queue->waiting > queue->woken)
+    {
+        ++queue->woken;
+        ++busyThreads;
+    }
+
+    ++queue->used;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+    return TRUE;
+}
+
+BOOL OSReceiveMessage(OSMessageQueue *queue, OSMessage *message, OSMessageFlags flags)
+{
+    pthread_mutex_lock(&queue->mutex);
+    if(queue->used == 0 && (flags & OS_MESSAGE_FLAGS_BLOCKING))
+    {
+        // Only worker threads block here, the UI thread polls
+        ++queue->waiting;
+        --busyThreads;
+        while(queue->used == 0)
+            pthread_cond_wait(&queue->cond, &queue->mutex);
+
+        --queue->waiting;
+        if(queue->woken)
+            --queue->woken;
+        else
+            ++busyThreads;
+    }
+    else if(queue->used == 0)
+    {
+        pthread_mutex_unlock(&queue->mutex);
+        return FALSE;
+    }
+
+    *message = queue->messages[queue->first];
+    queue->first = (queue->first + 1) % queue->size;
+    --queue->used;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+    return TRUE;
+}
+
+uint64_t OSGetTitleID()
+{
+    return 0x0005000013374842; // HBL
+}
+
+void OSEnableHomeButtonMenu(BOOL enable)
+{
+}
+
+void OSSavesDone_ReadyToRelease()
+{
+}
+
+void SYSLaunchMenu()
+{
+    stats.exited = true;
+}
+
+void SYSRelaunchTitle(uint32_t argc, char *argv[])
+{
+    stats.exited = true;
+}
+
+// FSA, /vol/external01 is the only mounted volume
+
+static FSError fsError(int err)
+{
+    switch(err)
+    {
+        case ENOENT:
+        case ENOTDIR:
+            return FS_ERROR_NOT_FOUND;
+        case EEXIST:
+            return FS_ERROR_ALREADY_EXISTS;
+        case EACCES:
+        case EPERM:
+        case EROFS:
+            return FS_ERROR_PERMISSION_ERROR;
+        case EINVAL:
+        case EBADF:
+            return FS_ERROR_INVALID_PARAM;
+        default:
+            return FS_ERROR_MEDIA_ERROR;
+    }
+}
+
+static bool mapPath(const char *path, char *out)
+{
+    size_t len = strlen(SIM_SD_PATH);
+    if(strncmp(path, SIM_SD_PATH, len) != 0 || (path[len] != '/' && path[len] != '\0'))
+        return false;
+
+    return snprintf(out, PATH_MAX, "%s%s", sdRoot, path + len) < PATH_MAX;
+}
+
+static int getFile(FSAFileHandle handle)
+{
+    return handle > 0 && handle <= SIM_FILES ? files[handle - 1] : -1;
+}
+
+static void toStat(const struct stat *st, FSAStat *stat)
+{
+    memset(stat, 0, sizeof(FSAStat));
+    stat->flags = S_ISDIR(st->st_mode) ? FS_STAT_DIRECTORY : 0;
+    stat->mode = st->st_mode & 0777;
+    stat->size = st->st_size;
+    stat->created = (uint64_t)st->st_ctim.tv_sec * 1000000 + st->st_ctim.tv_nsec / 1000;
+    stat->modified = (uint64_t)st->st_mtim.tv_sec * 1000000 + st->st_mtim.tv_nsec / 1000;
+}
+
+FSError FSAInit()
+{
+    return FS_ERROR_OK;
+}
+
+void FSAShutdown()
+{
+}
+
+FSAClientHandle FSAAddClient(void *attachAsyncData)
+{
+    return 1;
+}
+
+FSError FSADelClient(FSAClientHandle client)
+{
+    for(int i = 0; i < SIM_FILES; ++i)
+    {
+        if(files[i] != -1)
+        {
+            close(files[i]);
+            files[i] = -1;
+        }
+
+        if(dirs[i] != NULL)
+        {
+            closedir(dirs[i]);
+            dirs[i] = NULL;
+        }
+    }
+
+    return FS_ERROR_OK;
+}
+
+const char *FSAGetStatusStr(FSError error)
+{
+    switch(error)
+    {
+        case FS_ERROR_OK:
+            return "FS_ERROR_OK";
+        case FS_ERROR_END_OF_DIR:
+            return "FS_ERROR_END_OF_DIR";
+        case FS_ERROR_END_OF_FILE:
+            return "FS_ERROR_END_OF_FILE";
+        case FS_ERROR_MEDIA_ERROR:
+            return "FS_ERROR_MEDIA_ERROR";
+        case FS_ERROR_ALREADY_EXISTS:
+            return "FS_ERROR_ALREADY_EXISTS";
+        case FS_ERROR_NOT_FOUND:
+            return "FS_ERROR_NOT_FOUND";
+        case FS_ERROR_PERMISSION_ERROR:
+            return "FS_ERROR_PERMISSION_ERROR";
+        case FS_ERROR_INVALID_PARAM:
+            return "FS_ERROR_INVALID_PARAM";
+        default:
+            return "FS_ERROR_UNKNOWN";
+    }
+}
+
+FSError FSAOpenFileEx(FSAClientHandle client, const char *path, const char *mode, FSMode createMode,
+                      FSOpenFileFlags openFlag, uint32_t preallocSize, FSAFileHandle *outHandle)
+{
+    char host[PATH_MAX];
+    if(!mapPath(path, host))
+        return FS_ERROR_NOT_FOUND;
+
+    int flags;
+    switch(mode[0])
+    {
+        case 'r':
+            flags = mode[1] == '+' ? O_RDWR : O_RDONLY;
+            break;
+        case 'w':
+            flags = (mode[1] == '+' ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+            break;
+        case 'a':
+            flags = (mode[1] == '+' ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND;
+            break;
+        default:
+            return FS_ERROR_INVALID_PARAM;
+    }
+
+    int fd = open(host, flags, 0644);
+    if(fd == -1)
+        return fsError(errno);
+
+    pthread_mutex_lock(&filesMutex);
+    int slot = 0;
+    while(slot < SIM_FILES && files[slot] != -1)
+        ++slot;
+    if(slot < SIM_FILES)
+        files[slot] = fd;
+    pthread_mutex_unlock(&filesMutex);
+
+    if(slot == SIM_FILES)
+    {
+        close(fd);
+        return FS_ERROR_MEDIA_ERROR;
+    }
+
+    *outHandle = slot + 1;
+    return FS_ERROR_OK;
+}
+
+FSError FSACloseFile(FSAClientHandle client, FSAFileHandle handle)
+{
+    pthread_mutex_lock(&filesMutex);
+    int fd = getFile(handle);
+    if(fd != -1)
+        files[handle - 1] = -1;
+    pthread_mutex_unlock(&filesMutex);
+
+    if(fd == -1)
+        return FS_ERROR_INVALID_PARAM;
+
+    return close(fd) == 0 ? FS_ERROR_OK : fsError(errno);
+}
+
+// Like on the console these return the number of complete elements transferred
+FSError FSAReadFile(FSAClientHandle client, void *buffer, uint32_t size, uint32_t count, FSAFileHandle handle, FSAReadFlag flags)
+{
+    int fd = getFile(handle);
+    if(fd == -1 || size == 0)
+        return FS_ERROR_INVALID_PARAM;
+
+    size_t total = (size_t)size * count;
+    size_t done = 0;
+    while(done < total)
+    {
+        ssize_t r = read(fd, (uint8_t *)buffer + done, total - done);
+        if(r < 0)
+            return fsError(errno);
+        if(r == 0)
+            break;
+
+        done += r;
+    }
+
+    return (FSError)(done / size);
+}
+
+FSError FSAReadFileWithPos(FSAClientHandle client, void *buffer, uint32_t size, uint32_t count, uint32_t pos, FSAFileHandle handle,
+                           FSAReadFlag flags)
+{
+    int fd = getFile(handle);
+    if(fd == -1 || size == 0)
+        return FS_ERROR_INVALID_PARAM;
+
+    size_t total = (size_t)size * count;
+    size_t done = 0;
+    while(done < total)
+    {
+        ssize_t r = pread(fd, (uint8_t *)buffer + done, total - done, (off_t)pos + done);
+        if(r < 0)
+            return fsError(errno);
+        if(r == 0)
+            break;
+
+        done += r;
+    }
+
+    return (FSError)(done / size);
+}
+
+FSError FSAWriteFile(FSAClientHandle client, void *buffer, uint32_t size, uint32_t count, FSAFileHandle handle, FSAWriteFlag flags)
+{
+    int fd = getFile(handle);
+    if(fd == -1 || size == 0)
+        return FS_ERROR_INVALID_PARAM;
+
+    size_t total = (size_t)size * count;
+    size_t done = 0;
+    while(done < total)
+    {
+        ssize_t w = write(fd, (const uint8_t *)buffer + done, total - done);
+        if(w < 0)
+            return fsError(errno);
+
+        done += w;
+    }
+
+    return (FSError)count;
+}
+
+FSError FSAFlushFile(FSAClientHandle client, FSAFileHandle handle)
+{
+    int fd = getFile(handle);
+    if(fd == -1)
+        return FS_ERROR_INVALID_PARAM;
+
+    return fdatasync(fd) == 0 ? FS_ERROR_OK : fsError(errno);
+}
+
+FSError FSAFlushVolume(FSAClientHandle client, const char *path)
+{
+    char host[PATH_MAX];
+    return mapPath(path, host) ? FS_ERROR_OK : FS_ERROR_NOT_FOUND;
+}
+
+FSError FSAGetStat(FSAClientHandle client, const char *path, FSAStat *stat)
+{
+    char host[PATH_MAX];
+    struct stat st;
+    if(!mapPath(path, host))
+        return FS_ERROR_NOT_FOUND;
+    if(lstat(host, &st) != 0)
+        return fsError(errno);
+
+    toStat(&st, stat);
+    return FS_ERROR_OK;
+}
+
+FSError FSAGetStatFile(FSAClientHandle client, FSAFileHandle handle, FSAStat *stat)
+{
+    struct stat st;
+    int fd = getFile(handle);
+    if(fd == -1)
+        return FS_ERROR_INVALID_PARAM;
+    if(fstat(fd, &st) != 0)
+        return fsError(errno);
+
+    toStat(&st, stat);
+    return FS_ERROR_OK;
+}
+
+FSError FSARemove(FSAClientHandle client, const char *path)
+{
+    char host[PATH_MAX];
+    if(!mapPath(path, host))
+        return FS_ERROR_NOT_FOUND;
+
+    return remove(host) == 0 ? FS_ERROR_OK : fsError(errno);
+}
+
+FSError FSARename(FSAClientHandle client, const char *oldPath, const char *newPath)
+{
+    char oldHost[PATH_MAX];
+    char newHost[PATH_MAX];
+    if(!mapPath(oldPath, oldHost) || !mapPath(newPath, newHost))
+        return FS_ERROR_NOT_FOUND;
+
+    return rename(oldHost, newHost) == 0 ? FS_ERROR_OK : fsError(errno);
+}
+
+FSError FSAOpenDir(FSAClientHandle client, const char *path, FSADirectoryHandle *dirHandle)
+{
+    char host[PATH_MAX];
+    if(!mapPath(path, host))
+        return FS_ERROR_NOT_FOUND;
+
+    DIR *dir = opendir(host);
+    if(dir == NULL)
+        return fsError(errno);
+
+    pthread_mutex_lock(&filesMutex);
+    int slot = 0;
+    while(slot < SIM_FILES && dirs[slot] != NULL)
+        ++slot;
+    if(slot < SIM_FILES)
+        dirs[slot] = dir;
+    pthread_mutex_unlock(&filesMutex);
+
+    if(slot == SIM_FILES)
+    {
+        closedir(dir);
+        return FS_ERROR_MEDIA_ERROR;
+    }
+
+    *dirHandle = slot + 1;
+    return FS_ERROR_OK;
+}
+
+// Like the console this skips . and .. and fills in the stat of each entry
+FSError FSAReadDir(FSAClientHandle client, FSADirectoryHandle handle, FSADirectoryEntry *entry)
+{
+    DIR *dir = handle > 0 && handle <= SIM_FILES ? dirs[handle - 1] : NULL;
+    if(dir == NULL)
+        return FS_ERROR_INVALID_PARAM;
+
+    struct dirent *de;
+    struct stat st;
+    do
+    {
+        errno = 0;
+        de = readdir(dir);
+        if(de == NULL)
+            return errno ? fsError(errno) : FS_ERROR_END_OF_DIR;
+    } while(strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0 || strlen(de->d_name) >= sizeof(entry->name) ||
+            fstatat(dirfd(dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0);
+
+    toStat(&st, &entry->info);
+    strcpy(entry->name, de->d_name);
+    return FS_ERROR_OK;
+}
+
+FSError FSACloseDir(FSAClientHandle client, FSADirectoryHandle handle)
+{
+    pthread_mutex_lock(&filesMutex);
+    DIR *dir = handle > 0 && handle <= SIM_FILES ? dirs[handle - 1] : NULL;
+    if(dir != NULL)
+        dirs[handle - 1] = NULL;
+    pthread_mutex_unlock(&filesMutex);
+
+    if(dir == NULL)
+        return FS_ERROR_INVALID_PARAM;
+
+    return closedir(dir) == 0 ? FS_ERROR_OK : fsError(errno);
+}
+
+// ProcUI: Always in foreground, exiting once the app asked to leave or the script ran out
+
+void ProcUIInit(ProcUISaveCallback saveCallback)
+{
+}
+
+void ProcUIRegisterCallback(ProcUICallbackType type, ProcUICallback callback, void *param, uint32_t priority)
+{
+    if(type == PROCUI_CALLBACK_HOME_BUTTON_DENIED)
+    {
+        homeButtonCallback = callback;
+        homeButtonParam = param;
+    }
+}
+
+ProcUIStatus ProcUIProcessMessages(BOOL block)
+{
+    endInputFrame();
+    ++stats.frames;
+
+    if(homePressed)
+    {
+        homePressed = false;
+        if(homeButtonCallback != NULL)
+            homeButtonCallback(homeButtonParam);
+    }
+
+    if(stats.exited)
+        return PROCUI_STATUS_EXITING;
+
+    OSTime now = OSGetSystemTime() - start;
+    while(eventNext < eventCount && events[eventNext].at <= now)
+    {
+        events[eventNext].run(events[eventNext].ctx);
+        ++eventNext;
+    }
+
+    // Also covers apps which stopped reading the GamePad, like the error screen. queueEnd is past the last press,
+    // event and simWait(), so a script ending in a wait runs that long.
+    if(now > queueEnd + SIM_LINGER_TICKS)
+    {
+        stats.exited = true;
+        return PROCUI_STATUS_EXITING;
+    }
+
+    return PROCUI_STATUS_IN_FOREGROUND;
+}
+
+void ProcUIDrawDoneRelease()
+{
+}
+
+// VPAD: Hands out the samples which are due, newest first. Without new samples this reports
+// VPAD_READ_NO_SAMPLES instead of repeating the last one.
+
+int32_t VPADRead(VPADChan chan, VPADStatus *buffers, uint32_t count, VPADReadError *outError)
+{
+    OSTime now = OSGetSystemTime() - start;
+    size_t end = queueNext;
+    while(end < queueSize && queue[end].at <= now)
+        ++end;
+
+    if(end == queueNext)
+    {
+        *outError = VPAD_READ_NO_SAMPLES;
+        return 0;
+    }
+
+    if(count > SIM_VPAD_SIZE)
+        count = SIM_VPAD_SIZE;
+
+    // Just like the real buffer this one only keeps the newest samples
+    if(end - queueNext > count)
+    {
+        stats.dropped += end - queueNext - count;
+        while(end - queueNext > count)
+            lastHold = queue[queueNext++].hold;
+    }
+
+    uint32_t presses = 0;
+    int32_t samples = end - queueNext;
+    for(int32_t i = samples - 1; i >= 0; --i, ++queueNext)
+    {
+        uint32_t hold = queue[queueNext].hold;
+        buffers[i].hold = hold;
+        buffers[i].trigger = hold & ~lastHold;
+        buffers[i].release = lastHold & ~hold;
+        if(buffers[i].trigger)
+            ++presses;
+        if(buffers[i].trigger & VPAD_BUTTON_HOME)
+            homePressed = true;
+
+        lastHold = hold;
+    }
+
+    stats.samples += samples;
+    if(presses)
+    {
+        stats.presses += presses;
+        ++stats.inputFrames;
+        if(!inputStart)
+            inputStart = realTime();
+    }
+
+    *outError = VPAD_READ_SUCCESS;
+    return samples;
+}
+
+// OSScreen: Double buffered frames in plain memory. The font has the OSScreen cell size, but every glyph
+// is a fixed random pattern, so simLine() can tell them apart when reading the TV back.
+
+static uint16_t glyphRow(char c, uint32_t y)
+{
+    if(c == ' ' || y < 2 || y >= SIM_GLYPH_HEIGHT - 2)
+        return 0;
+
+    uint32_t h = (uint8_t)c * 0x9E3779B1u ^ y * 0x85EBCA6Bu;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    return (h & 0x3FF) << 1 | 1;
+}
+
+static uint32_t *backFrame(OSScreenID id)
+{
+    SIM_SCREEN *scr = screens + id;
+    return scr->buffer + (scr->front ^ 1) * scr->pitch * scr->height;
+}
+
+void OSScreenInit()
+{
+}
+
+void OSScreenShutdown()
+{
+}
+
+uint32_t OSScreenGetBufferSizeEx(OSScreenID id)
+{
+    SIM_SCREEN *scr = screens + id;
+    return scr->pitch * scr->height * sizeof(uint32_t) * 2;
+}
+
+void OSScreenSetBufferEx(OSScreenID id, void *addr)
+{
+    screens[id].buffer = addr;
+    screens[id].front = 0;
+}
+
+void OSScreenClearBufferEx(OSScreenID id, uint32_t colour)
+{
+    uint32_t *frame = backFrame(id);
+    for(uint32_t i = 0; i < screens[id].pitch * screens[id].height; ++i)
+        frame[i] = colour;
+}
+
+void OSScreenFlipBuffersEx(OSScreenID id)
+{
+    screens[id].front ^= 1;
+    if(id == SCREEN_TV)
+        ++stats.draws;
+}
+
+void OSScreenPutFontEx(OSScreenID id, uint32_t column, uint32_t row, const char *buffer)
+{
+    SIM_SCREEN *scr = screens + id;
+    uint32_t *frame = backFrame(id);
+    for(uint32_t x0 = column * SIM_GLYPH_WIDTH; *buffer != '\0' && x0 + SIM_GLYPH_WIDTH <= scr->width; ++buffer, x0 += SIM_GLYPH_WIDTH)
+    {
+        for(uint32_t y = 0; y < SIM_GLYPH_HEIGHT && row * SIM_GLYPH_HEIGHT + y < scr->height; ++y)
+        {
+            uint16_t bits = glyphRow(*buffer, y);
+            uint32_t *line = frame + (row * SIM_GLYPH_HEIGHT + y) * scr->pitch + x0;
+            for(uint32_t x = 0; x < SIM_GLYPH_WIDTH; ++x)
+                if((bits >> x) & 1)
+                    line[x] = SIM_FONT_COLOR;
+        }
+    }
+}
+
+void OSScreenPutPixelEx(OSScreenID id, uint32_t x, uint32_t y, uint32_t colour)
+{
+    SIM_SCREEN *scr = screens + id;
+    if(x < scr->width && y < scr->height)
+        backFrame(id)[y * scr->pitch + x] = colour;
+}
+
+uint32_t OSScreenEnableEx(OSScreenID id, BOOL enable)
+{
+    return 0;
+}
+
+void DCFlushRange(void *addr, uint32_t size)
+{
+    stats.flushed += size;
+}
+
+const char *simLine(uint32_t line)
+{
+    static char text[SIM_LINE_LENGTH];
+    SIM_SCREEN *scr = screens + SCREEN_TV;
+    if(scr->buffer == NULL || line >= scr->height / SIM_GLYPH_HEIGHT)
+        return "";
+
+    const uint32_t *frame = scr->buffer + scr->front * scr->pitch * scr->height;
+    uint32_t columns = scr->width / SIM_GLYPH_WIDTH;
+    if(columns >= SIM_LINE_LENGTH)
+        columns = SIM_LINE_LENGTH - 1;
+
+    uint32_t len = 0;
+    for(uint32_t column = 0; column < columns; ++column)
+    {
+        uint16_t rows[SIM_GLYPH_HEIGHT];
+        for(uint32_t y = 0; y < SIM_GLYPH_HEIGHT; ++y)
+        {
+            const uint32_t *pixels = frame + (line * SIM_GLYPH_HEIGHT + y) * scr->pitch + column * SIM_GLYPH_WIDTH;
+            rows[y] = 0;
+            for(uint32_t x = 0; x < SIM_GLYPH_WIDTH; ++x)
+                if(pixels[x] == SIM_FONT_COLOR)
+                    rows[y] |= 1 << x;
+        }
+
+        char c = '?';
+        for(char g = ' '; g <= '~'; ++g)
+        {
+            uint32_t y = 0;
+            while(y < SIM_GLYPH_HEIGHT && glyphRow(g, y) == rows[y])
+                ++y;
+            if(y == SIM_GLYPH_HEIGHT)
+            {
+                c = g;
+                break;
+            }
+        }
+
+        text[column] = c;
+        if(c != ' ')
+            len = column + 1;
+    }
+
+    text[len] = '\0';
+    return text;
+}
+
+// MEM1 is a frame heap
+
+MEMHeapHandle MEMGetBaseHeapHandle(MEMBaseHeapType type)
+{
+    return &mem1;
+}
+
+BOOL MEMRecordStateForFrmHeap(MEMHeapHandle heap, uint32_t tag)
+{
+    mem1.state = mem1.used;
+    return TRUE;
+}
+
+BOOL MEMFreeByStateToFrmHeap(MEMHeapHandle heap, uint32_t tag)
+{
+    mem1.used = mem1.state;
+    return TRUE;
+}
+
+void *MEMAllocFromFrmHeapEx(MEMHeapHandle heap, uint32_t size, int alignment)
+{
+    if(mem1.base == NULL && (mem1.base = aligned_alloc(SIM_MEM1_ALIGN, SIM_MEM1_SIZE)) == NULL)
+        return NULL;
+
+    size_t pos = (mem1.used + alignment - 1) & ~(size_t)(alignment - 1);
+    if(pos + size > SIM_MEM1_SIZE)
+        return NULL;
+
+    mem1.used = pos + size;
+    return mem1.base + pos;
+}
+
+// libmocha
+
+MochaUtilsStatus Mocha_InitLibrary()
+{
+    return MOCHA_RESULT_SUCCESS;
+}
+
+MochaUtilsStatus Mocha_DeInitLibrary()
+{
+    return MOCHA_RESULT_SUCCESS;
+}
+
+MochaUtilsStatus Mocha_UnlockFSClientEx(FSAClientHandle client)
+{
+    return MOCHA_RESULT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+// Driver side of the simulator: Scripts input for src/main.c and collects what it did.
+// Everything runs on a virtual clock. OSSleepTicks() advances it instead of sleeping, so a replay
+// only takes as long as the code under test needs.
+
+#include <sim_wut.h>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define SIM_SAMPLE_TICKS OSMillisecondsToTicks(4) // The GamePad gets sampled at 250 Hz
+#define SIM_LINGER_TICKS OSSecondsToTicks(1)      // Time after the last sample till ProcUI reports exiting
+#define SIM_LINES        16
+#define SIM_LINE_LENGTH  128
+
+typedef struct
+{
+    uint64_t frames;      // ProcUIProcessMessages() calls
+    uint64_t samples;     // VPAD samples read by the app
+    uint64_t dropped;     // VPAD samples which fell out of the buffer before they got read
+    uint64_t presses;     // Samples holding buttons which haven't been held before
+    uint64_t inputFrames; // Frames which read at least one press
+    OSTime inputTicks;    // Real time from VPADRead() returning presses to the end of the frame
+    OSTime inputMax;
+    uint64_t draws;       // OSScreenFlipBuffersEx() calls for the TV
+    uint64_t flushed;     // Bytes passed to DCFlushRange(), so framebuffer memory the app touched
+    OSTime elapsed;       // Virtual time since simInit()
+    bool exited;          // SYSLaunchMenu() or SYSRelaunchTitle() got called
+} SIM_STATS;
+
+// sdRoot is the host directory /vol/external01 maps to. OSReport() goes to report, NULL discards it.
+void simInit(const char *sdRoot, FILE *report);
+// Queues a press of buttons (VPAD_BUTTON_*) for holdTicks, followed by the release
+bool simPress(uint32_t buttons, OSTime holdTicks);
+// Delays the next press
+void simWait(OSTime ticks);
+// Calls event(ctx) from ProcUIProcessMessages() once the virtual clock reaches the time the next simPress() would
+// start at. Stands in for other programs writing to the SD card while the app runs.
+bool simEvent(void (*event)(void *ctx), void *ctx);
+const SIM_STATS *simStats();
+// Reads the text back from what's currently shown on the TV, top to bottom
+const char *simLine(uint32_t line);
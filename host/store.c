@@ -0,0 +1,243 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "tool.h"
+
+#include <profiles.h>
+#include <settings.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+typedef struct
+{
+    void *data;
+    size_t size;
+} MAPPING;
+
+static void profilesUsage()
+{
+    fprintf(stderr, "Usage: nincfg-tool profiles <store> list\n"
+                    "       nincfg-tool profiles <store> get <game id> <nincfg.bin>\n"
+                    "       nincfg-tool profiles <store> put <game id> <nincfg.bin>\n"
+                    "       nincfg-tool profiles <store> remove <game id>\n\n"
+                    "Game IDs are 4 characters (GALE) or 8 hex digits. put creates the store if needed.\n");
+}
+
+// Maps the store read only. A missing store is fine if allowMissing is set and results in data == NULL.
+static bool mapStore(const char *path, MAPPING *map, bool allowMissing)
+{
+    map->data = NULL;
+    map->size = 0;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+    {
+        if(errno == ENOENT && allowMissing)
+            return true;
+
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    bool ret = false;
+    if(fstat(fd, &st) != 0)
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    else
+    {
+        map->size = st.st_size;
+        map->data = map->size ? mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        if(map->data == MAP_FAILED)
+        {
+            map->data = NULL;
+            fprintf(stderr, "%s: %s\n", path, map->size ? strerror(errno) : "Empty file");
+        }
+        else if(!profilesCheck(map->data, map->size))
+            fprintf(stderr, "%s: Not a profile store\n", path);
+        else
+            ret = true;
+    }
+
+    close(fd);
+    if(!ret && map->data != NULL)
+    {
+        munmap(map->data, map->size);
+        map->data = NULL;
+    }
+
+    return ret;
+}
+
+static void unmapStore(MAPPING *map)
+{
+    if(map->data != NULL)
+        munmap(map->data, map->size);
+}
+
+// Writes to a temporary file first, so a failed write never destroys the old store
+static bool writeStore(const char *path, const void *data, size_t size)
+{
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *f = fopen(tmp, "wb");
+    if(f == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", tmp, strerror(errno));
+        return false;
+    }
+
+    bool ret = fwrite(data, 1, size, f) == size;
+    ret = fclose(f) == 0 && ret;
+    if(ret)
+        ret = rename(tmp, path) == 0;
+
+    if(!ret)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        unlink(tmp);
+    }
+
+    return ret;
+}
+
+static int listProfiles(const MAPPING *map)
+{
+    char id[9];
+    char value[SETTING_VALUE_SIZE];
+    uint32_t count = profilesCount(map->data);
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        NIN_CFG cfg;
+        const NIN_CFG *record = profilesRecord(map->data, i);
+        profilesFormatID(profilesGameID(map->data, i), id);
+        NCFG_STATUS status = record == NULL ? NCFG_ERROR_SIZE : ncfgLoad(&cfg, record, sizeof(NIN_CFG));
+        if(status != NCFG_OK)
+        {
+            printf("%s: %s\n", id, ncfgStatusStr(status));
+            continue;
+        }
+
+        ncfgNormalize(&cfg);
+        printf("%s:", id);
+        for(uint32_t s = 0; s < SETTINGS_COUNT; ++s)
+        {
+            settingFormat(&cfg, s, value);
+            printf(" %s=%s", settings[s].name, value);
+        }
+
+        putchar('\n');
+    }
+
+    return 0;
+}
+
+int cmdProfiles(int argc, char *argv[])
+{
+    if(argc < 3)
+    {
+        profilesUsage();
+        return 1;
+    }
+
+    const char *path = argv[1];
+    const char *action = argv[2];
+    uint32_t gameID = 0;
+    if(strcmp(action, "list") != 0 && (argc < 4 || !profilesParseID(argv[3], &gameID)))
+    {
+        profilesUsage();
+        return 1;
+    }
+
+    MAPPING map;
+    if(!mapStore(path, &map, strcmp(action, "put") == 0))
+        return 1;
+
+    int ret = 1;
+    if(strcmp(action, "list") == 0)
+        ret = listProfiles(&map);
+    else if(strcmp(action, "get") == 0 && argc == 5)
+    {
+        int32_t i = profilesFind(map.data, gameID);
+        const NIN_CFG *record = i < 0 ? NULL : profilesRecord(map.data, i);
+        if(record == NULL)
+            fprintf(stderr, "%s: No profile for %s\n", path, argv[3]);
+        else
+        {
+            // Materialize like the app does: No autoboot, so no game ID in nincfg.bin
+            NIN_CFG raw = *record;
+            raw.GameID = 0;
+            FILE *f = fopen(argv[4], "wb");
+            if(f == NULL || fwrite(&raw, sizeof(NIN_CFG), 1, f) != 1)
+                fprintf(stderr, "%s: %s\n", argv[4], strerror(errno));
+            else
+                ret = 0;
+
+            if(f != NULL && fclose(f) != 0)
+                ret = 1;
+        }
+    }
+    else if(strcmp(action, "put") == 0 && argc == 5)
+    {
+        NIN_CFG raw, cfg;
+        const char *err = readConfigFile(argv[4], &raw);
+        if(err == NULL)
+        {
+            NCFG_STATUS status = ncfgLoad(&cfg, &raw, sizeof(NIN_CFG));
+            if(status != NCFG_OK)
+                err = ncfgStatusStr(status);
+        }
+
+        void *out = malloc(profilesStoreSize((map.data ? profilesCount(map.data) : 0) + 1));
+        if(err != NULL)
+            fprintf(stderr, "%s: %s\n", argv[4], err);
+        else if(out != NULL)
+        {
+            raw.GameID = ncfgBE32(gameID);
+            size_t size = profilesPut(map.data, out, gameID, &raw);
+            ret = writeStore(path, out, size) ? 0 : 1;
+        }
+
+        free(out);
+    }
+    else if(strcmp(action, "remove") == 0 && argc == 4)
+    {
+        void *out = malloc(profilesStoreSize(profilesCount(map.data)));
+        if(profilesFind(map.data, gameID) < 0)
+            fprintf(stderr, "%s: No profile for %s\n", path, argv[3]);
+        else if(out != NULL)
+        {
+            size_t size = profilesRemove(map.data, out, gameID);
+            ret = writeStore(path, out, size) ? 0 : 1;
+        }
+
+        free(out);
+    }
+    else
+        profilesUsage();
+
+    unmapStore(&map);
+    return ret;
+}
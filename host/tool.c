@@ -0,0 +1,266 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include "tool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct
+{
+    const char *name;
+    int (*run)(int argc, char *argv[]);
+    const char *help;
+} COMMAND;
+
+static const COMMAND commands[] = {
+    { "apply", cmdApply, "Normalize nincfg.bin files and apply setting edits in parallel" },
+    { "profiles", cmdProfiles, "List, get, put or remove profiles in a profile store" },
+    { "migrate", cmdMigrate, "Convert nincfg.bin files between Nintendont versions" },
+    { "diff", cmdDiff, "Create patches with the changes between nincfg.bin files" },
+    { "patch", cmdPatch, "Apply a patch to nincfg.bin files in parallel" },
+    { "export", cmdExport, "Write nincfg.bin files as text" },
+    { "import", cmdImport, "Create or update nincfg.bin files from text" },
+    { "games", cmdGames, "Scan a device for games and update the game index" },
+    { "scan", cmdScan, "Find and extract nincfg.bin files in SD card images and backups" },
+};
+
+static PATH_LIST *collectList;
+static const char *collectSuffix;
+
+uint64_t nanoTime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static bool pathListAdd(PATH_LIST *list, const char *path)
+{
+    if(list->count == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+        char **paths = realloc(list->paths, sizeof(char *) * capacity);
+        if(paths == NULL)
+            return false;
+
+        list->paths = paths;
+        list->capacity = capacity;
+    }
+
+    list->paths[list->count] = strdup(path);
+    if(list->paths[list->count] == NULL)
+        return false;
+
+    ++list->count;
+    return true;
+}
+
+static int collectEntry(const char *path, const struct stat *st, int type, struct FTW *ftw)
+{
+    if(type != FTW_F)
+        return 0;
+
+    size_t len = strlen(path);
+    size_t suffixLen = strlen(collectSuffix);
+    if(len < suffixLen || strcmp(path + len - suffixLen, collectSuffix) != 0)
+        return 0;
+
+    return pathListAdd(collectList, path) ? 0 : -1;
+}
+
+bool pathListCollect(PATH_LIST *list, const char *path, const char *suffix)
+{
+    struct stat st;
+    if(stat(path, &st) != 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    if(!S_ISDIR(st.st_mode))
+        return pathListAdd(list, path);
+
+    collectList = list;
+    collectSuffix = suffix;
+    return nftw(path, collectEntry, 64, FTW_PHYS) == 0;
+}
+
+bool pathListRead(PATH_LIST *list, const char *listFile)
+{
+    FILE *f = strcmp(listFile, "-") == 0 ? stdin : fopen(listFile, "r");
+    if(f == NULL)
+    {
+        fprintf(stderr, "%s: %s\n", listFile, strerror(errno));
+        return false;
+    }
+
+    char line[4096];
+    bool ret = true;
+    while(ret && fgets(line, sizeof(line), f) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if(line[0] != '\0')
+            ret = pathListAdd(list, line);
+    }
+
+    if(f != stdin)
+        fclose(f);
+
+    return ret;
+}
+
+void pathListFree(PATH_LIST *list)
+{
+    for(size_t i = 0; i < list->count; ++i)
+        free(list->paths[i]);
+
+    free(list->paths);
+    list->paths = NULL;
+    list->count = list->capacity = 0;
+}
+
+const char *readConfigFile(const char *path, NIN_CFG *raw)
+{
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return strerror(errno);
+
+    // Check the size first so oversized files never get read
+    struct stat st;
+    const char *err = NULL;
+    if(fstat(fd, &st) != 0)
+        err = strerror(errno);
+    else if(st.st_size != sizeof(NIN_CFG))
+        err = ncfgStatusStr(NCFG_ERROR_SIZE);
+    else
+    {
+        ssize_t r = pread(fd, raw, sizeof(NIN_CFG), 0);
+        if(r < 0)
+            err = strerror(errno);
+        else if(r != sizeof(NIN_CFG))
+            err = ncfgStatusStr(NCFG_ERROR_SIZE);
+    }
+
+    close(fd);
+    return err;
+}
+
+// Writes into path.tmp, syncs it and renames it over path, so a crash leaves either the old or the new file but
+// never a torn one. path has to exist already, the new file gets its permissions.
+const char *writeConfigFile(const char *path, const NIN_CFG *raw)
+{
+    struct stat st;
+    if(stat(path, &st) != 0)
+        return strerror(errno);
+
+    char tmp[PATH_MAX];
+    if((size_t)snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= sizeof(tmp))
+        return strerror(ENAMETOOLONG);
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, st.st_mode & 07777);
+    if(fd < 0)
+        return strerror(errno);
+
+    const char *err = NULL;
+    ssize_t r = pwrite(fd, raw, sizeof(NIN_CFG), 0);
+    if(r < 0)
+        err = strerror(errno);
+    else if(r != sizeof(NIN_CFG))
+        err = "Short write";
+    else if(fsync(fd) != 0)
+        err = strerror(errno);
+
+    if(close(fd) != 0 && err == NULL)
+        err = strerror(errno);
+    if(err == NULL && rename(tmp, path) != 0)
+        err = strerror(errno);
+
+    if(err != NULL)
+    {
+        unlink(tmp);
+        return err;
+    }
+
+    // Make the rename itself durable
+    char dir[PATH_MAX];
+    const char *slash = strrchr(path, '/');
+    if(slash == NULL)
+        strcpy(dir, ".");
+    else
+        snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path);
+
+    fd = open(dir, O_RDONLY | O_DIRECTORY);
+    if(fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+
+    return NULL;
+}
+
+const char *writeFile(const char *path, const void *data, size_t size)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(fd < 0)
+        return strerror(errno);
+
+    const char *err = NULL;
+    ssize_t r = pwrite(fd, data, size, 0);
+    if(r < 0)
+        err = strerror(errno);
+    else if(r != size)
+        err = "Short write";
+
+    if(close(fd) != 0 && err == NULL)
+        err = strerror(errno);
+
+    return err;
+}
+
+static void usage(const char *self)
+{
+    fprintf(stderr, "Usage: %s <command> [options]\n\nCommands:\n", self);
+    for(size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); ++i)
+        fprintf(stderr, "  %-10s %s\n", commands[i].name, commands[i].help);
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 2)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    for(size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); ++i)
+        if(strcmp(argv[1], commands[i].name) == 0)
+            return commands[i].run(argc - 1, argv + 1);
+
+    usage(argv[0]);
+    return 1;
+}
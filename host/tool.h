@@ -0,0 +1,57 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <ncfg.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    char **paths;
+    size_t count;
+    size_t capacity;
+} PATH_LIST;
+
+// Adds path if it's a file or all files ending in suffix below it if it's a directory
+bool pathListCollect(PATH_LIST *list, const char *path, const char *suffix);
+// Adds one path per line of listFile ("-" for stdin)
+bool pathListRead(PATH_LIST *list, const char *listFile);
+void pathListFree(PATH_LIST *list);
+
+// Reads a nincfg.bin into raw (on-disk format, not validated). Returns NULL or an error string.
+const char *readConfigFile(const char *path, NIN_CFG *raw);
+// Replaces the existing nincfg.bin at path with raw through a synced temporary file, see tool.c
+const char *writeConfigFile(const char *path, const NIN_CFG *raw);
+// Unlike writeConfigFile() this creates path if needed
+const char *writeFile(const char *path, const void *data, size_t size);
+
+uint64_t nanoTime();
+
+int cmdApply(int argc, char *argv[]);
+int cmdProfiles(int argc, char *argv[]);
+int cmdMigrate(int argc, char *argv[]);
+int cmdDiff(int argc, char *argv[]);
+int cmdPatch(int argc, char *argv[]);
+int cmdExport(int argc, char *argv[]);
+int cmdImport(int argc, char *argv[]);
+int cmdGames(int argc, char *argv[]);
+int cmdScan(int argc, char *argv[]);
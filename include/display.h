@@ -0,0 +1,36 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <screen.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Draws a SCREEN to the TV and the GamePad through OSScreen, replacing WHBLogConsole.
+// The framebuffers live in MEM1 and get reallocated whenever the app comes back to the foreground.
+// displayInit() can run on any core, displayAttach() has to follow on the core of the main thread.
+bool displayInit();
+void displayAttach();
+void displayShutdown();
+// Colors are RGBA8888
+void displaySetColor(uint32_t background);
+// True if the framebuffers got lost (e.g. by going to the background) and need a redraw
+bool displayStale();
+void displayDraw(const SCREEN *screen);
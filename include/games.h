@@ -0,0 +1,130 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <ncfg.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Index of the games below GAMES_DIR, so the UI knows them without opening a single disc image.
+// The file is a GAMES_FILE_HEADER followed by count entries of
+//
+// GAMES_FILE_ENTRY
+// title                   titleLength bytes, no terminator
+// path                    pathLength bytes, no terminator
+//
+// sorted by path. All integers are big endian, like in nincfg.bin.
+
+#define GAMES_MAGIC         0x4E434749 // "NCGI"
+#define GAMES_VERSION       2
+#define GAMES_DIR           "/games"
+#define GAMES_MAX           1024
+#define GAMES_TITLE_SIZE    64
+#define GAMES_PATH_SIZE     sizeof(((NIN_CFG *)0)->GamePath)
+#define GAMES_NAME_SIZE     256
+#define GAMES_HEADER_SIZE   0x60 // The part of the disc header which gets read
+
+typedef struct
+{
+    uint32_t gameID; // The first four characters of the disc ID, like NIN_CFG.GameID
+    char maker[2];
+    uint8_t disc;
+    // The game file as it was when the header got read. If it's still the same, the header is, too.
+    uint64_t mtime;
+    uint64_t size;
+    // The game directory as it was when it got listed, 0 for games right in GAMES_DIR
+    uint64_t dirMtime;
+    char title[GAMES_TITLE_SIZE];
+    char path[GAMES_PATH_SIZE]; // Relative to the device root, like NIN_CFG.GamePath
+} GAME;
+
+typedef struct
+{
+    uint32_t count;
+    GAME games[GAMES_MAX];
+} GAMES;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} GAMES_FILE_HEADER;
+
+typedef struct
+{
+    uint32_t gameID;
+    char maker[2];
+    uint8_t disc;
+    uint8_t titleLength;
+    uint8_t pathLength;
+    uint8_t reserved[3];
+    uint32_t mtime[2]; // High word first
+    uint32_t size[2];
+    uint32_t dirMtime[2];
+} GAMES_FILE_ENTRY;
+
+#define GAMES_FILE_MAX (sizeof(GAMES_FILE_HEADER) + GAMES_MAX * (sizeof(GAMES_FILE_ENTRY) + GAMES_TITLE_SIZE + GAMES_PATH_SIZE))
+
+typedef struct
+{
+    char name[GAMES_NAME_SIZE];
+    bool dir;
+    uint64_t mtime;
+    uint64_t size;
+} GAMES_DIR_ENTRY;
+
+// What the scanner needs from the file system. Paths are absolute (device + GAMES_DIR + ...).
+typedef struct
+{
+    bool (*openDir)(void *ctx, const char *path, uintptr_t *dir);
+    // Returns false at the end of the directory
+    bool (*readDir)(void *ctx, uintptr_t dir, GAMES_DIR_ENTRY *entry);
+    void (*closeDir)(void *ctx, uintptr_t dir);
+    bool (*stat)(void *ctx, const char *path, uint64_t *mtime, uint64_t *size);
+    // Reads size bytes at offset
+    bool (*read)(void *ctx, const char *path, uint32_t offset, void *buffer, uint32_t size);
+    void *ctx;
+} GAMES_FS;
+
+typedef struct
+{
+    uint32_t dirs;    // Directories listed
+    uint32_t stats;   // Files stated to check the cache
+    uint32_t reads;   // Disc headers read
+    uint32_t cached;  // Games taken from the cache
+    uint32_t skipped; // Files which didn't look like a GameCube disc
+} GAMES_STATS;
+
+// Scans device GAMES_DIR for Nintendont games: GAMES_DIR/<name>/game.iso (or .gcm, .ciso, disc2.iso,
+// sys/boot.bin for extracted games) and disc images right in GAMES_DIR. Games whose file has the same path,
+// mtime and size as in cache (which may be NULL) are taken from there without reading the disc header.
+// Game directories which only hold cached games and still have the mtime they had when listed get stated
+// instead of listed unless full is set, so a warm scan of an unchanged card reads GAMES_DIR and nothing else. Returns the number of games.
+uint32_t gamesScan(GAMES *games, const GAMES *cache, const GAMES_FS *fs, const char *device, bool full,
+                   GAMES_STATS *stats);
+// Returns the index of the game with gameID (the first disc if there are more) or -1
+int32_t gamesFind(const GAMES *games, uint32_t gameID);
+// Writes games to out, which needs GAMES_FILE_MAX bytes. Returns the size.
+size_t gamesSerialize(const GAMES *games, void *out);
+// Returns false for broken files, games is empty then
+bool gamesLoad(GAMES *games, const void *data, size_t size);
@@ -0,0 +1,48 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <ncfg.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define INI_MAX_SIZE 4096 // Room for an export of any NIN_CFG, bigger files get rejected
+
+typedef enum
+{
+    INI_OK = 0,
+    INI_ERROR_SIZE,
+    INI_ERROR_SYNTAX,
+    INI_ERROR_KEY,
+    INI_ERROR_VALUE,
+    INI_ERROR_VERSION,
+} INI_STATUS;
+
+// Builds the key table, call once before anything else. Keys are the names from CommonConfigStrings.h where
+// Nintendont has one and the NIN_CFG field names for the rest. Returns false if no perfect hash was found.
+bool iniInit();
+// Writes every field of cfg (host byte order) as "Key = Value" lines to out, including the flags
+// ncfgNormalize() clears. Returns the length without the terminator, which is at most INI_MAX_SIZE - 1.
+size_t iniExport(const NIN_CFG *cfg, char *out);
+// Sets the fields named in data (size bytes, no terminator needed) in cfg, keeping all others.
+// Single pass over data, which isn't copied or modified. line gets the line number of errors.
+INI_STATUS iniImport(NIN_CFG *cfg, const char *data, size_t size, uint32_t *line);
+const char *iniStatusStr(INI_STATUS status);
@@ -0,0 +1,53 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <ncfg.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define MIGRATION_MIN_VERSION   2
+#define MIGRATION_MAX_SIZE      sizeof(NIN_CFG)
+
+// A migration between any two versions, composed from the single version steps in migrate.c.
+// Applying it is one pass over the bytes plus two masks, no matter how many steps it spans.
+typedef struct
+{
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromSize;
+    uint32_t toSize;
+    // For every byte of the output: the input byte it comes from or -1 for value[i]
+    int16_t source[MIGRATION_MAX_SIZE];
+    uint8_t value[MIGRATION_MAX_SIZE];
+    // Flags to keep in Config / VideoMode
+    uint32_t configMask;
+    uint32_t videoMask;
+} MIGRATION;
+
+// Returns the file size of a nincfg.bin of version or 0 for unknown versions
+size_t migrationSize(uint32_t version);
+// Returns false if there is no way between the two versions
+bool migrationBuild(MIGRATION *migration, uint32_t from, uint32_t to);
+// in and out are raw (nincfg.bin format) and may be the same. out needs migration->toSize bytes.
+void migrationApply(const MIGRATION *migration, const void *in, void *out);
+// ncfgLoad() which converts other versions to NIN_CFG_VERSION on the way. data must not be cfg.
+NCFG_STATUS migrationLoad(NIN_CFG *cfg, const void *data, size_t size, MIGRATION *migration);
@@ -0,0 +1,96 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <CommonConfig.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NCFG_MAGIC 0x01070CF6
+
+// The on-disk layout of NIN_CFG, byte order handling gets generated from this. WORD fields are 32 bit
+// integers stored big endian, BYTES fields get copied as they are. Keep it in sync with CommonConfig.h,
+// ncfg.c refuses to compile if a field is missing or a WORD isn't an aligned 32 bit field.
+#define NCFG_LAYOUT(WORD, BYTES) \
+    WORD(Magicbytes)             \
+    WORD(Version)                \
+    WORD(Config)                 \
+    WORD(VideoMode)              \
+    WORD(Language)               \
+    BYTES(GamePath)              \
+    BYTES(CheatPath)             \
+    WORD(MaxPads)                \
+    WORD(GameID)                 \
+    BYTES(MemCardBlocks)         \
+    BYTES(VideoScale)            \
+    BYTES(VideoOffset)           \
+    BYTES(NetworkProfile)        \
+    WORD(WiiUGamepadSlot)
+
+// Converts between host byte order and the big endian used on disk
+static inline uint32_t ncfgBE32(uint32_t x)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap32(x);
+#else
+    return x;
+#endif
+}
+
+// The force flags in VideoMode are one-hot (NIN_VID_FORCE_PAL50 to NIN_VID_FORCE_MPAL), this turns them into
+// an index into VideoModeStrings. -1 if no or more than one flag is set.
+static inline int32_t ncfgForceIndex(uint32_t videoMode)
+{
+    videoMode &= NIN_VID_FORCE_MASK;
+    if(videoMode == 0 || (videoMode & (videoMode - 1)))
+        return -1;
+
+    return __builtin_ctz(videoMode);
+}
+
+typedef enum
+{
+    NCFG_OK = 0,
+    NCFG_ERROR_SIZE,
+    NCFG_ERROR_MAGIC,
+    NCFG_ERROR_VERSION,
+} NCFG_STATUS;
+
+// Copies a raw nincfg.bin (as stored on the SD card) into cfg, converting it to host byte order.
+// data and cfg may point to the same memory. cfg is left untouched on NCFG_ERROR_SIZE.
+NCFG_STATUS ncfgLoad(NIN_CFG *cfg, const void *data, size_t size);
+// Applies everything the Wii U can't use or the UI doesn't show, see ncfgNormalize() in ncfg.c
+void ncfgNormalize(NIN_CFG *cfg);
+// Reverts UI only transformations and converts cfg back into the on-disk format. out may be cfg.
+void ncfgSerialize(const NIN_CFG *cfg, NIN_CFG *out);
+const char *ncfgStatusStr(NCFG_STATUS status);
+// Reverses the bytes of every WORD in NCFG_LAYOUT, no matter the host byte order
+void ncfgByteSwap(NIN_CFG *cfg);
+
+// Converts count configs between on-disk and host byte order in place, vectorized where the CPU allows.
+// For batch jobs which don't need the checks of ncfgLoad(). Big endian hosts have nothing to do.
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+void ncfgSwapBatch(NIN_CFG *cfgs, size_t count);
+#else
+static inline void ncfgSwapBatch(NIN_CFG *cfgs, size_t count)
+{
+}
+#endif
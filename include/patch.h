@@ -0,0 +1,92 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <ncfg.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PATCH_MAGIC       0x4E434650 // "NCFP"
+
+// Field ids are written to patch files, so only ever append to this
+typedef enum
+{
+    PATCH_FIELD_CONFIG = 0,
+    PATCH_FIELD_VIDEO_MODE,
+    PATCH_FIELD_LANGUAGE,
+    PATCH_FIELD_GAME_PATH,
+    PATCH_FIELD_CHEAT_PATH,
+    PATCH_FIELD_MAX_PADS,
+    PATCH_FIELD_GAME_ID,
+    PATCH_FIELD_MEMCARD_BLOCKS,
+    PATCH_FIELD_VIDEO_SCALE,
+    PATCH_FIELD_VIDEO_OFFSET,
+    PATCH_FIELD_NETWORK_PROFILE,
+    PATCH_FIELD_GAMEPAD_SLOT,
+    PATCH_FIELD_COUNT,
+} PATCH_FIELD;
+
+// One entry per word of every field: 64 for each of the paths, one for everything else
+#define PATCH_PATH_WORDS  ((sizeof(((NIN_CFG *)0)->GamePath) + 3) / 4)
+#define PATCH_MAX_ENTRIES (PATCH_FIELD_COUNT - 2 + 2 * PATCH_PATH_WORDS)
+
+// Sets the bits in mask to value. Fields which aren't 32 bits wide get split into words of up to four bytes,
+// stored as a big endian number (so the one byte VideoScale 104 is just 0x68 and "abc" is 0x00616263).
+typedef struct
+{
+    uint8_t field;
+    uint8_t word;
+    uint16_t reserved;
+    uint32_t mask;
+    uint32_t value;
+} PATCH_ENTRY;
+
+// A patch file is this struct cut after entries[count], big endian like nincfg.bin
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version; // The NIN_CFG_VERSION the field layout belongs to
+    uint32_t count;
+    PATCH_ENTRY entries[PATCH_MAX_ENTRIES];
+} PATCH;
+
+typedef enum
+{
+    PATCH_OK = 0,
+    PATCH_ERROR_SIZE,
+    PATCH_ERROR_MAGIC,
+    PATCH_ERROR_VERSION,
+    PATCH_ERROR_ENTRY,
+} PATCH_STATUS;
+
+// Fills patch with what it takes to turn from into to (both in host byte order). Flags get patched
+// one by one so bits the patch doesn't care about survive, anything else as a whole. Returns the entry count.
+uint32_t patchDiff(PATCH *patch, const NIN_CFG *from, const NIN_CFG *to);
+// Applies patch to cfg (host byte order) in a single pass over the entries
+void patchApply(const PATCH *patch, NIN_CFG *cfg);
+// Size of patch as a file
+size_t patchSize(const PATCH *patch);
+// Copies a patch file into patch, converting and validating it. data and patch may point to the same memory.
+PATCH_STATUS patchLoad(PATCH *patch, const void *data, size_t size);
+// Converts patch into the file format. out may be patch.
+void patchSerialize(const PATCH *patch, PATCH *out);
+const char *patchFieldName(uint32_t field);
+const char *patchStatusStr(PATCH_STATUS status);
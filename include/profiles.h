@@ -0,0 +1,77 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <ncfg.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A profile store holds many NIN_CFGs, keyed by game ID. It's meant to be used directly from
+// memory (a read buffer on the console, mmap() on the host) without any parsing:
+//
+// PROFILES_HEADER
+// PROFILES_ENTRY[count]   sorted by gameID, 0 is a valid ID
+// padding                 up to PROFILES_ALIGN
+// NIN_CFG records         PROFILES_RECORD_SIZE apart, in nincfg.bin format
+//
+// All integers are big endian, like in nincfg.bin.
+
+#define PROFILES_MAGIC          0x4E435046 // "NCPF"
+#define PROFILES_VERSION        1
+#define PROFILES_ALIGN          0x40
+#define PROFILES_RECORD_SIZE    ((sizeof(NIN_CFG) + PROFILES_ALIGN - 1) & ~(PROFILES_ALIGN - 1))
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t recordSize;
+    uint32_t recordsOffset;
+    uint32_t reserved[3];
+} PROFILES_HEADER;
+
+typedef struct
+{
+    uint32_t gameID;
+    uint32_t record;
+} PROFILES_ENTRY;
+
+// Checks the header and that everything it points to is inside of size
+bool profilesCheck(const void *store, size_t size);
+uint32_t profilesCount(const void *store);
+// i is the position in the sorted index, not the record number
+uint32_t profilesGameID(const void *store, uint32_t i);
+NIN_CFG *profilesRecord(const void *store, uint32_t i);
+// Binary search for gameID. Returns the position in the index or -1
+int32_t profilesFind(const void *store, uint32_t gameID);
+
+size_t profilesStoreSize(uint32_t count);
+// Writes store with raw (nincfg.bin format) added or replaced as gameID to out, which needs to hold
+// profilesStoreSize(profilesCount(store) + 1) bytes. store may be NULL. Returns the size of out.
+size_t profilesPut(const void *store, void *out, uint32_t gameID, const NIN_CFG *raw);
+// Writes store without gameID to out. Returns the size of out.
+size_t profilesRemove(const void *store, void *out, uint32_t gameID);
+
+// "GALE" for printable IDs, hex otherwise. out needs 9 bytes.
+void profilesFormatID(uint32_t gameID, char *out);
+// Parses what profilesFormatID() produces
+bool profilesParseID(const char *str, uint32_t *gameID);
@@ -0,0 +1,46 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <ncfg.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Provisioning scripts set options without the UI, one "name = value" per line with the names and values
+// nincfg-tool apply takes (so the setting names from settings.c and the values as the UI shows them).
+// Empty lines and lines starting with # get skipped.
+
+#define PROVISION_MAX_SIZE 4096
+#define PROVISION_MAX_LINE 128
+
+typedef enum
+{
+    PROVISION_OK = 0,
+    PROVISION_ERROR_SIZE,
+    PROVISION_ERROR_SYNTAX,
+    PROVISION_ERROR_SETTING,
+    PROVISION_ERROR_VALUE,
+} PROVISION_STATUS;
+
+// Applies the script in data (size bytes, no terminator needed) to cfg (host byte order) with settingParse(), so
+// each edit has the same side effects as in the UI. cfg only changes if every line is fine, else line gets the
+// number of the first bad one. edits gets the number of lines applied.
+PROVISION_STATUS provisionApply(NIN_CFG *cfg, const char *data, size_t size, uint32_t *line, uint32_t *edits);
+const char *provisionStatusStr(PROVISION_STATUS status);
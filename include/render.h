@@ -0,0 +1,60 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <screen.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define RENDER_GLYPH_WIDTH  12 // Character cell of the OSScreen font
+#define RENDER_GLYPH_HEIGHT 24
+#define RENDER_FIRST_GLYPH  ' '
+#define RENDER_GLYPHS       ('~' - RENDER_FIRST_GLYPH + 1)
+#define RENDER_REPAINT      (1u << 31) // renderScreen() cleared the whole frame
+
+// One bit per pixel copy of the font, bit x is column x of the glyph
+typedef struct
+{
+    uint16_t rows[RENDER_GLYPHS][RENDER_GLYPH_HEIGHT];
+} RENDER_ATLAS;
+
+// One frame of a framebuffer (RGBA8888) and the text which is in it
+typedef struct
+{
+    uint32_t *pixels;
+    uint32_t pitch; // In pixels
+    uint32_t width;
+    uint32_t height;
+    bool valid;
+    uint32_t background;
+    char cells[SCREEN_LINES][SCREEN_LINE_LENGTH];
+    // First and last column renderScreen() changed in each row it returned
+    uint8_t first[SCREEN_LINES];
+    uint8_t last[SCREEN_LINES];
+} RENDER_FRAME;
+
+// Builds the atlas from all glyphs drawn side by side, starting with RENDER_FIRST_GLYPH in the top left corner.
+// Every pixel not in the background color counts as set.
+void renderCaptureAtlas(RENDER_ATLAS *atlas, const uint32_t *pixels, uint32_t pitch, uint32_t background);
+// Forgets what's in the frame, so the next renderScreen() repaints it completely
+void renderInvalidate(RENDER_FRAME *frame);
+// Brings frame up to date with screen, only touching the cells which differ. Returns the text rows changed
+// as a bitmask (plus RENDER_REPAINT if all pixels changed), so the caller knows what to flush.
+uint32_t renderScreen(RENDER_FRAME *frame, const RENDER_ATLAS *atlas, const SCREEN *screen, uint32_t background, uint32_t foreground);
@@ -0,0 +1,45 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCREEN_LINES        16
+#define SCREEN_LINE_LENGTH  80
+
+// Retained model of the text on screen. Rows only get marked dirty when their text really changes,
+// so the UI can (re)set whatever rows it thinks might have changed and the renderer only has to
+// touch the dirty ones.
+typedef struct
+{
+    char lines[SCREEN_LINES][SCREEN_LINE_LENGTH];
+    uint32_t dirty; // One bit per row
+} SCREEN;
+
+void screenClear(SCREEN *screen);
+void screenSetLine(SCREEN *screen, uint32_t row, const char *text);
+void screenPrintf(SCREEN *screen, uint32_t row, const char *format, ...) __attribute__((format(printf, 3, 4)));
+// Moves all rows up by one, leaving the last one empty
+void screenScroll(SCREEN *screen);
+
+static inline bool screenDirty(const SCREEN *screen, uint32_t row)
+{
+    return screen->dirty & (1u << row);
+}
@@ -0,0 +1,100 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <CommonConfig.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SETTINGS_COUNT      13
+#define SETTINGS_MERGE_OTHER (1u << SETTINGS_COUNT) // See settingsMerge()
+#define SETTING_VALUE_SIZE  32
+#define SETTING_MAX_VALUES  64 // No option has more values than this
+#define SETTING_POOL_SIZE   160 // Values of all options together, see settingsInit()
+
+typedef struct SETTING SETTING;
+
+// One row per option shown in the UI. Editing, rendering and validating are all driven by this,
+// so adding a Nintendont option means adding a row to settings[] in settings.c
+struct SETTING
+{
+    // Used by the host tools, e.g. "video_scale=104"
+    const char *name;
+    const char *label;
+    const char *info;
+    // The NIN_CFG field this edits, filled by the FIELD() macro
+    uint16_t offset;
+    uint8_t size;
+    bool sign;
+    // Bits inside Config for flags, range and step for numbers
+    uint32_t mask;
+    int32_t min;
+    int32_t max;
+    int32_t step;
+    void (*edit)(const SETTING *setting, NIN_CFG *cfg, bool right);
+    bool (*valid)(const SETTING *setting, const NIN_CFG *cfg);
+    // Writes at most SETTING_VALUE_SIZE bytes (including the terminator) to out
+    void (*format)(const SETTING *setting, const NIN_CFG *cfg, char *out);
+    // Position of the current value among all values format() can write or -1 for ones which aren't
+    // cached (like "Invalid"). Returns the number of positions if cfg is NULL.
+    int32_t (*slot)(const SETTING *setting, const NIN_CFG *cfg);
+};
+
+extern const SETTING settings[SETTINGS_COUNT];
+
+static inline void settingEdit(NIN_CFG *cfg, uint32_t index, bool right)
+{
+    const SETTING *setting = settings + index;
+    setting->edit(setting, cfg, right);
+}
+
+static inline bool settingValid(const NIN_CFG *cfg, uint32_t index)
+{
+    const SETTING *setting = settings + index;
+    return setting->valid(setting, cfg);
+}
+
+static inline void settingFormat(const NIN_CFG *cfg, uint32_t index, char *out)
+{
+    const SETTING *setting = settings + index;
+    setting->format(setting, cfg, out);
+}
+
+// Formats every value of every option once into a string pool, so settingText() doesn't have to
+void settingsInit();
+// Returns what settingFormat() would write from the pool and its length in len.
+// Returns NULL for values settingsInit() didn't cache, use settingFormat() for these.
+const char *settingText(const NIN_CFG *cfg, uint32_t index, size_t *len);
+
+// Returns the index of the setting called name or -1
+int settingFind(const char *name);
+// Sets the option to the value printed as value (case insensitive). Parts in parentheses can be left out if that
+// still leaves only one value ("16MB" but not "Force" for "Force (Deflicker) NTSC"). Returns false if there is no
+// such value.
+bool settingParse(NIN_CFG *cfg, uint32_t index, const char *value);
+// True if the option has the same value in a and b
+bool settingEqual(const NIN_CFG *a, const NIN_CFG *b, uint32_t index);
+// Three-way merge: cfg and theirs both started out as base. Options only theirs changed get their value, on
+// conflicts cfg wins. What no option covers gets merged the same way: unknown Config and VideoMode bits each on
+// their own, GamePath, GameID and the other fields as a whole. Returns what got taken from theirs and the
+// conflicts as bitmasks: bit i is settings[i], SETTINGS_MERGE_OTHER all the rest. Run ncfgNormalize() on cfg
+// afterwards.
+uint32_t settingsMerge(NIN_CFG *cfg, const NIN_CFG *base, const NIN_CFG *theirs, uint32_t *conflicts);
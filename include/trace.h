@@ -0,0 +1,90 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Per frame timings of the UI loop. Each stage of a frame adds the ticks since the previous traceMark() to its
+// counter and traceCommit() moves the frame into a ring of the last TRACE_FRAMES frames. Nothing in there
+// allocates, formats or locks: The UI thread is the only writer and publishes frames by bumping head, so a
+// reader only has to load head before copying (see traceCopy()).
+// Ticks are whatever the caller passes as now, ticksPerSecond converts them for the output.
+
+#define TRACE_FRAMES     1024 // Power of two
+#define TRACE_CSV_SIZE   ((TRACE_FRAMES + 1) * 160)
+#define TRACE_STATS_SIZE 1024
+
+typedef enum
+{
+    TRACE_PROCUI,  // ProcUIProcessMessages()
+    TRACE_INPUT,   // Draining the VPAD buffer
+    TRACE_UPDATE,  // Handling the presses, editing and formatting rows, checking nincfg.bin for changes
+    TRACE_SAVE,    // Polling the save thread
+    TRACE_DRAW,    // Getting the screen out
+    TRACE_SLEEP,   // Waiting for the next frame
+    TRACE_STAGES,
+} TRACE_STAGE;
+
+typedef struct
+{
+    uint64_t start;
+    uint32_t ticks[TRACE_STAGES];
+    uint32_t presses;
+} TRACE_FRAME;
+
+typedef struct
+{
+    TRACE_FRAME frames[TRACE_FRAMES];
+    uint32_t head; // Frames committed so far, frames[head % TRACE_FRAMES] is the next one to write
+    TRACE_FRAME current;
+    uint64_t last;
+    uint64_t ticksPerSecond;
+} TRACE;
+
+extern const char *const traceStageNames[TRACE_STAGES];
+
+void traceInit(TRACE *trace, uint64_t ticksPerSecond, uint64_t now);
+
+static inline void traceMark(TRACE *trace, TRACE_STAGE stage, uint64_t now)
+{
+    uint64_t ticks = now - trace->last;
+    trace->current.ticks[stage] += ticks > UINT32_MAX ? UINT32_MAX : (uint32_t)ticks;
+    trace->last = now;
+}
+
+static inline void traceCommit(TRACE *trace, uint32_t presses)
+{
+    uint32_t head = trace->head;
+    TRACE_FRAME *frame = trace->frames + (head & (TRACE_FRAMES - 1));
+    *frame = trace->current;
+    frame->presses = presses;
+    __atomic_store_n(&trace->head, head + 1, __ATOMIC_RELEASE);
+
+    for(uint32_t i = 0; i < TRACE_STAGES; ++i)
+        trace->current.ticks[i] = 0;
+    trace->current.start = trace->last;
+}
+
+// Copies the frames in the ring to out, oldest first. Returns how many.
+uint32_t traceCopy(const TRACE *trace, TRACE_FRAME *out);
+// One line per frame, times in nanoseconds. Return the length written (at most size - 1).
+size_t traceWriteCsv(const TRACE_FRAME *frames, uint32_t count, uint64_t ticksPerSecond, char *out, size_t size);
+// p50, p99, maximum and mean in microseconds of every stage and of whole frames
+size_t traceWriteStats(const TRACE_FRAME *frames, uint32_t count, uint64_t ticksPerSecond, char *out, size_t size);
@@ -0,0 +1,267 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <display.h>
+#include <render.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <coreinit/cache.h>
+#include <coreinit/debug.h>
+#include <coreinit/memfrmheap.h>
+#include <coreinit/memheap.h>
+#include <coreinit/screen.h>
+#include <proc_ui/procui.h>
+
+#define COLOR_TEXT      0xFFFFFFFF
+#define FRAME_HEAP_TAG  0x4E434647 // "NCFG"
+#define MARK_COLOR      0x4E494E43 // "NINC"
+
+typedef struct
+{
+    OSScreenID id;
+    uint32_t width;
+    uint32_t height;
+    uint32_t size;
+    uint32_t *buffer;
+    RENDER_FRAME frames[2];
+    uint32_t back; // The frame OSScreen draws to right now
+} DISPLAY;
+
+static DISPLAY displays[2] = {
+    { .id = SCREEN_TV, .width = 1280, .height = 720 },
+    { .id = SCREEN_DRC, .width = 854, .height = 480 },
+};
+
+static RENDER_ATLAS atlas;
+static bool atlasReady = false;
+static bool ready = false;
+static bool stale = true;
+static uint32_t background = 0x000000FF;
+
+// OSScreenGetBufferSizeEx() covers both frames of a screen back to back, each height rows of pitch pixels.
+// Which of them is the back frame after OSScreenSetBufferEx() isn't documented, a pixel at (0, 1) tells and
+// also shows the pitch is right. Returns false if it's in neither place.
+static bool setupLayout(DISPLAY *display)
+{
+    uint32_t half = display->size / sizeof(uint32_t) / 2;
+    uint32_t pitch = half / display->height;
+    if(pitch < display->width)
+    {
+        OSReport("Nincfg: screen %u buffer too small (%u bytes)\n", display->id, display->size);
+        return false;
+    }
+
+    OSScreenClearBufferEx(display->id, 0);
+    OSScreenPutPixelEx(display->id, 0, 1, MARK_COLOR);
+    uint32_t origin;
+    if(display->buffer[pitch] == MARK_COLOR)
+        origin = 0;
+    else if(display->buffer[half + pitch] == MARK_COLOR)
+        origin = half;
+    else
+    {
+        OSReport("Nincfg: screen %u doesn't have a pitch of %u pixels\n", display->id, pitch);
+        return false;
+    }
+
+    for(int i = 0; i < 2; ++i)
+    {
+        RENDER_FRAME *frame = display->frames + i;
+        frame->pixels = display->buffer + (origin + i * half) % (half * 2);
+        frame->pitch = pitch;
+        frame->width = display->width;
+        frame->height = display->height;
+        renderInvalidate(frame);
+    }
+
+    display->back = 0;
+    return true;
+}
+
+// The atlas has cells of RENDER_GLYPH_WIDTH x RENDER_GLYPH_HEIGHT. A glyph put at column 1, row 1 has to end up
+// in exactly that cell, else the OSScreen font isn't the one the atlas is made for.
+static bool checkGlyphCell(const RENDER_FRAME *frame)
+{
+    OSScreenClearBufferEx(SCREEN_TV, 0);
+    OSScreenPutFontEx(SCREEN_TV, 1, 1, "#");
+
+    bool inside = false;
+    for(uint32_t y = 0; y < RENDER_GLYPH_HEIGHT * 3; ++y)
+    {
+        const uint32_t *line = frame->pixels + y * frame->pitch;
+        for(uint32_t x = 0; x < RENDER_GLYPH_WIDTH * 3; ++x)
+        {
+            if(line[x] == 0)
+                continue;
+
+            if(x / RENDER_GLYPH_WIDTH != 1 || y / RENDER_GLYPH_HEIGHT != 1)
+                return false;
+
+            inside = true;
+        }
+    }
+
+    return inside;
+}
+
+// Draws all glyphs into the TV back frame and copies them into the atlas. Returns false if the font doesn't fit.
+static bool captureAtlas()
+{
+    char glyphs[RENDER_GLYPHS + 1];
+    for(uint32_t i = 0; i < RENDER_GLYPHS; ++i)
+        glyphs[i] = RENDER_FIRST_GLYPH + i;
+    glyphs[RENDER_GLYPHS] = '\0';
+
+    RENDER_FRAME *frame = displays[0].frames + displays[0].back;
+    if(!checkGlyphCell(frame))
+    {
+        OSReport("Nincfg: OSScreen font doesn't fit %ux%u cells\n", RENDER_GLYPH_WIDTH, RENDER_GLYPH_HEIGHT);
+        return false;
+    }
+
+    OSScreenClearBufferEx(SCREEN_TV, 0);
+    OSScreenPutFontEx(SCREEN_TV, 0, 0, glyphs);
+    renderCaptureAtlas(&atlas, frame->pixels, frame->pitch, 0);
+    atlasReady = true;
+    return true;
+}
+
+static uint32_t acquireCallback(void *context)
+{
+    MEMHeapHandle heap = MEMGetBaseHeapHandle(MEM_BASE_HEAP_MEM1);
+    MEMRecordStateForFrmHeap(heap, FRAME_HEAP_TAG);
+
+    ready = true;
+    for(int i = 0; i < 2; ++i)
+    {
+        DISPLAY *display = displays + i;
+        display->buffer = MEMAllocFromFrmHeapEx(heap, display->size, 0x100);
+        if(display->buffer == NULL)
+        {
+            ready = false;
+            break;
+        }
+
+        OSScreenSetBufferEx(display->id, display->buffer);
+        if(!setupLayout(display))
+        {
+            ready = false;
+            break;
+        }
+    }
+
+    if(ready && !atlasReady)
+        ready = captureAtlas();
+
+    stale = true;
+    return 0;
+}
+
+static uint32_t releaseCallback(void *context)
+{
+    ready = false;
+    MEMFreeByStateToFrmHeap(MEMGetBaseHeapHandle(MEM_BASE_HEAP_MEM1), FRAME_HEAP_TAG);
+    return 0;
+}
+
+bool displayInit()
+{
+    OSScreenInit();
+    for(int i = 0; i < 2; ++i)
+        displays[i].size = OSScreenGetBufferSizeEx(displays[i].id);
+
+    acquireCallback(NULL);
+    if(!ready)
+        return false;
+
+    OSScreenEnableEx(SCREEN_TV, true);
+    OSScreenEnableEx(SCREEN_DRC, true);
+    return true;
+}
+
+// ProcUI calls callbacks on the core they got registered from
+void displayAttach()
+{
+    ProcUIRegisterCallback(PROCUI_CALLBACK_ACQUIRE, acquireCallback, NULL, 100);
+    ProcUIRegisterCallback(PROCUI_CALLBACK_RELEASE, releaseCallback, NULL, 100);
+}
+
+void displayShutdown()
+{
+    if(ready)
+        releaseCallback(NULL);
+
+    OSScreenShutdown();
+}
+
+void displaySetColor(uint32_t color)
+{
+    background = color;
+}
+
+bool displayStale()
+{
+    return stale;
+}
+
+// Renders into the back frame of each screen, flushes the rows which changed and flips.
+// The frame drawn now was last up to date two flips ago, renderScreen() catches up on both.
+void displayDraw(const SCREEN *screen)
+{
+    if(!ready)
+        return;
+
+    for(int i = 0; i < 2; ++i)
+    {
+        DISPLAY *display = displays + i;
+        RENDER_FRAME *frame = display->frames + display->back;
+        uint32_t changed = renderScreen(frame, &atlas, screen, background, COLOR_TEXT);
+        if(!changed)
+            continue;
+
+        if(changed & RENDER_REPAINT)
+            DCFlushRange(frame->pixels, frame->pitch * frame->height * sizeof(uint32_t));
+        else
+        {
+            // Only the changed cells of each row, line by line
+            for(uint32_t row = 0; row < SCREEN_LINES; ++row)
+            {
+                if(!(changed & (1u << row)))
+                    continue;
+
+                uint32_t x = frame->first[row] * RENDER_GLYPH_WIDTH;
+                uint32_t w = (frame->last[row] + 1) * RENDER_GLYPH_WIDTH;
+                if(w > frame->width)
+                    w = frame->width;
+                w -= x;
+
+                uint32_t *line = frame->pixels + row * RENDER_GLYPH_HEIGHT * frame->pitch + x;
+                for(uint32_t y = 0; y < RENDER_GLYPH_HEIGHT && row * RENDER_GLYPH_HEIGHT + y < frame->height; ++y, line += frame->pitch)
+                    DCFlushRange(line, w * sizeof(uint32_t));
+            }
+        }
+
+        OSScreenFlipBuffersEx(display->id);
+        display->back ^= 1;
+    }
+
+    stale = false;
+}
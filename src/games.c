@@ -0,0 +1,410 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <games.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define GC_MAGIC        0xC2339F3D
+#define GC_MAGIC_OFFSET 0x1C
+#define GC_TITLE_OFFSET 0x20
+#define CISO_MAGIC      0x4349534F // "CISO"
+#define CISO_HEADER     0x8000     // CISO block map, the disc follows
+
+// Files Nintendont boots from a game directory, disc 1 first
+static const char *const gameFiles[] = {
+    "game.iso",
+    "game.ciso",
+    "game.gcm",
+    "disc2.iso",
+    "disc2.ciso",
+};
+
+typedef struct
+{
+    GAMES *games;
+    const GAMES *cache;
+    const GAMES_FS *fs;
+    const char *device;
+    GAMES_STATS *stats;
+} SCAN;
+
+static inline uint32_t readBE32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static bool hasExtension(const char *name)
+{
+    const char *dot = strrchr(name, '.');
+    return dot != NULL && (strcasecmp(dot, ".iso") == 0 || strcasecmp(dot, ".gcm") == 0 ||
+                           strcasecmp(dot, ".ciso") == 0);
+}
+
+// Returns the index of the first cached game with a path >= path
+static uint32_t cacheLowerBound(const GAMES *cache, const char *path)
+{
+    uint32_t low = 0;
+    uint32_t high = cache->count;
+    while(low < high)
+    {
+        uint32_t mid = low + ((high - low) >> 1);
+        if(strcmp(cache->games[mid].path, path) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return low;
+}
+
+static const GAME *cacheFind(const SCAN *scan, const char *path, uint64_t mtime, uint64_t size)
+{
+    if(scan->cache == NULL)
+        return NULL;
+
+    uint32_t i = cacheLowerBound(scan->cache, path);
+    if(i == scan->cache->count)
+        return NULL;
+
+    const GAME *game = scan->cache->games + i;
+    return strcmp(game->path, path) == 0 && game->mtime == mtime && game->size == size ? game : NULL;
+}
+
+static bool fullPath(const SCAN *scan, const char *path, char *out)
+{
+    return (size_t)snprintf(out, GAMES_NAME_SIZE * 2, "%s%s", scan->device, path) < GAMES_NAME_SIZE * 2;
+}
+
+static bool readHeader(const SCAN *scan, const char *path, GAME *game)
+{
+    char full[GAMES_NAME_SIZE * 2];
+    if(!fullPath(scan, path, full))
+        return false;
+
+    uint8_t header[GAMES_HEADER_SIZE];
+    ++scan->stats->reads;
+    if(!scan->fs->read(scan->fs->ctx, full, 0, header, sizeof(header)))
+        return false;
+
+    if(readBE32(header) == CISO_MAGIC)
+    {
+        ++scan->stats->reads;
+        if(!scan->fs->read(scan->fs->ctx, full, CISO_HEADER, header, sizeof(header)))
+            return false;
+    }
+
+    if(readBE32(header + GC_MAGIC_OFFSET) != GC_MAGIC)
+        return false;
+
+    game->gameID = readBE32(header);
+    memcpy(game->maker, header + 4, sizeof(game->maker));
+    game->disc = header[6];
+
+    uint32_t i = 0;
+    for(; i < GAMES_TITLE_SIZE - 1 && header[GC_TITLE_OFFSET + i] != '\0'; ++i)
+    {
+        char c = header[GC_TITLE_OFFSET + i];
+        game->title[i] = c >= ' ' && c <= '~' ? c : '?';
+    }
+
+    game->title[i] = '\0';
+    return true;
+}
+
+// Takes path from the cache or reads its header, mtime and size are what the file has now, dirMtime what its
+// directory has
+static void addGame(const SCAN *scan, const char *path, uint64_t mtime, uint64_t size, uint64_t dirMtime)
+{
+    GAMES *games = scan->games;
+    if(games->count == GAMES_MAX || strlen(path) >= GAMES_PATH_SIZE)
+        return;
+
+    GAME *game = games->games + games->count;
+    const GAME *cached = cacheFind(scan, path, mtime, size);
+    if(cached != NULL)
+    {
+        *game = *cached;
+        ++scan->stats->cached;
+    }
+    else
+    {
+        if(!readHeader(scan, path, game))
+        {
+            ++scan->stats->skipped;
+            return;
+        }
+
+        game->mtime = mtime;
+        game->size = size;
+        strcpy(game->path, path);
+    }
+
+    game->dirMtime = dirMtime;
+    ++games->count;
+}
+
+static bool statGame(const SCAN *scan, const char *path, uint64_t *mtime, uint64_t *size)
+{
+    char full[GAMES_NAME_SIZE * 2];
+    ++scan->stats->stats;
+    return fullPath(scan, path, full) && scan->fs->stat(scan->fs->ctx, full, mtime, size);
+}
+
+// Takes all cached games in dir if neither dir (by its mtime) nor any of them changed, which needs a stat per game
+// but no listing. A game file added to dir changes its mtime.
+static bool reuseDir(const SCAN *scan, const char *dir, uint64_t dirMtime)
+{
+    const GAMES *cache = scan->cache;
+    if(cache == NULL)
+        return false;
+
+    size_t length = strlen(dir);
+    uint32_t first = cacheLowerBound(cache, dir);
+    uint32_t last = first;
+    while(last < cache->count && strncmp(cache->games[last].path, dir, length) == 0)
+        ++last;
+
+    if(first == last || scan->games->count + last - first > GAMES_MAX)
+        return false;
+
+    for(uint32_t i = first; i < last; ++i)
+    {
+        uint64_t mtime, size;
+        if(cache->games[i].dirMtime != dirMtime || !statGame(scan, cache->games[i].path, &mtime, &size) ||
+           mtime != cache->games[i].mtime || size != cache->games[i].size)
+            return false;
+    }
+
+    memcpy(scan->games->games + scan->games->count, cache->games + first, sizeof(GAME) * (last - first));
+    scan->games->count += last - first;
+    scan->stats->cached += last - first;
+    return true;
+}
+
+static void scanGameDir(const SCAN *scan, const char *name, uint64_t dirMtime, bool full)
+{
+    // dir ends with a slash so reuseDir() doesn't match GAMES_DIR/<name>2
+    char dir[GAMES_PATH_SIZE];
+    if((size_t)snprintf(dir, sizeof(dir), GAMES_DIR "/%s/", name) >= sizeof(dir))
+        return;
+
+    if(!full && reuseDir(scan, dir, dirMtime))
+        return;
+
+    char path[GAMES_NAME_SIZE * 2];
+    if(!fullPath(scan, dir, path))
+        return;
+
+    uintptr_t handle;
+    if(!scan->fs->openDir(scan->fs->ctx, path, &handle))
+        return;
+
+    ++scan->stats->dirs;
+    // Remember what's there first so disc 1 always comes before disc 2
+    uint64_t mtimes[sizeof(gameFiles) / sizeof(gameFiles[0])];
+    uint64_t sizes[sizeof(gameFiles) / sizeof(gameFiles[0])];
+    bool found[sizeof(gameFiles) / sizeof(gameFiles[0])] = { false };
+    bool extracted = false;
+    GAMES_DIR_ENTRY entry;
+    while(scan->fs->readDir(scan->fs->ctx, handle, &entry))
+    {
+        if(entry.dir)
+        {
+            extracted |= strcasecmp(entry.name, "sys") == 0;
+            continue;
+        }
+
+        for(uint32_t i = 0; i < sizeof(gameFiles) / sizeof(gameFiles[0]); ++i)
+        {
+            if(strcasecmp(entry.name, gameFiles[i]) == 0)
+            {
+                found[i] = true;
+                mtimes[i] = entry.mtime;
+                sizes[i] = entry.size;
+                break;
+            }
+        }
+    }
+
+    scan->fs->closeDir(scan->fs->ctx, handle);
+    for(uint32_t i = 0; i < sizeof(gameFiles) / sizeof(gameFiles[0]); ++i)
+    {
+        if(found[i] && (size_t)snprintf(path, sizeof(path), "%s%s", dir, gameFiles[i]) < GAMES_PATH_SIZE)
+            addGame(scan, path, mtimes[i], sizes[i], dirMtime);
+    }
+
+    // Extracted games are booted from the directory, boot.bin has the same header as a disc
+    uint64_t mtime, size;
+    if(extracted && (size_t)snprintf(path, sizeof(path), "%ssys/boot.bin", dir) < GAMES_PATH_SIZE &&
+       statGame(scan, path, &mtime, &size))
+        addGame(scan, path, mtime, size, dirMtime);
+}
+
+static int comparePaths(const void *a, const void *b)
+{
+    return strcmp(((const GAME *)a)->path, ((const GAME *)b)->path);
+}
+
+uint32_t gamesScan(GAMES *games, const GAMES *cache, const GAMES_FS *fs, const char *device, bool full,
+                   GAMES_STATS *stats)
+{
+    GAMES_STATS dummy;
+    SCAN scan = {
+        .games = games,
+        .cache = cache,
+        .fs = fs,
+        .device = device,
+        .stats = stats == NULL ? &dummy : stats,
+    };
+    memset(scan.stats, 0, sizeof(GAMES_STATS));
+    games->count = 0;
+
+    char path[GAMES_NAME_SIZE * 2];
+    uintptr_t handle;
+    if(!fullPath(&scan, GAMES_DIR, path) || !fs->openDir(fs->ctx, path, &handle))
+        return 0;
+
+    ++scan.stats->dirs;
+    GAMES_DIR_ENTRY entry;
+    while(fs->readDir(fs->ctx, handle, &entry))
+    {
+        if(entry.name[0] == '.')
+            continue;
+
+        if(entry.dir)
+            scanGameDir(&scan, entry.name, entry.mtime, full);
+        else if(hasExtension(entry.name) &&
+                (size_t)snprintf(path, sizeof(path), GAMES_DIR "/%s", entry.name) < GAMES_PATH_SIZE)
+            addGame(&scan, path, entry.mtime, entry.size, 0);
+    }
+
+    fs->closeDir(fs->ctx, handle);
+    qsort(games->games, games->count, sizeof(GAME), comparePaths);
+    return games->count;
+}
+
+int32_t gamesFind(const GAMES *games, uint32_t gameID)
+{
+    int32_t found = -1;
+    for(uint32_t i = 0; i < games->count; ++i)
+    {
+        if(games->games[i].gameID == gameID)
+        {
+            if(games->games[i].disc == 0)
+                return i;
+
+            if(found < 0)
+                found = i;
+        }
+    }
+
+    return found;
+}
+
+size_t gamesSerialize(const GAMES *games, void *out)
+{
+    GAMES_FILE_HEADER header = {
+        .magic = ncfgBE32(GAMES_MAGIC),
+        .version = ncfgBE32(GAMES_VERSION),
+        .count = ncfgBE32(games->count),
+    };
+    uint8_t *p = (uint8_t *)out;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+
+    for(uint32_t i = 0; i < games->count; ++i)
+    {
+        const GAME *game = games->games + i;
+        GAMES_FILE_ENTRY entry = {
+            .gameID = ncfgBE32(game->gameID),
+            .maker = { game->maker[0], game->maker[1] },
+            .disc = game->disc,
+            .titleLength = strlen(game->title),
+            .pathLength = strlen(game->path),
+            .mtime = { ncfgBE32(game->mtime >> 32), ncfgBE32(game->mtime) },
+            .size = { ncfgBE32(game->size >> 32), ncfgBE32(game->size) },
+            .dirMtime = { ncfgBE32(game->dirMtime >> 32), ncfgBE32(game->dirMtime) },
+        };
+
+        // Entries aren't aligned, so everything goes through memcpy()
+        memcpy(p, &entry, sizeof(entry));
+        p += sizeof(entry);
+        memcpy(p, game->title, entry.titleLength);
+        p += entry.titleLength;
+        memcpy(p, game->path, entry.pathLength);
+        p += entry.pathLength;
+    }
+
+    return p - (uint8_t *)out;
+}
+
+bool gamesLoad(GAMES *games, const void *data, size_t size)
+{
+    games->count = 0;
+    GAMES_FILE_HEADER header;
+    if(size < sizeof(header))
+        return false;
+
+    memcpy(&header, data, sizeof(header));
+    uint32_t count = ncfgBE32(header.count);
+    if(ncfgBE32(header.magic) != GAMES_MAGIC || ncfgBE32(header.version) != GAMES_VERSION || count > GAMES_MAX)
+        return false;
+
+    const uint8_t *p = (const uint8_t *)data + sizeof(header);
+    const uint8_t *end = (const uint8_t *)data + size;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        GAMES_FILE_ENTRY entry;
+        if((size_t)(end - p) < sizeof(entry))
+            return false;
+
+        memcpy(&entry, p, sizeof(entry));
+        p += sizeof(entry);
+        if(entry.titleLength >= GAMES_TITLE_SIZE || entry.pathLength >= GAMES_PATH_SIZE ||
+           (size_t)(end - p) < (size_t)entry.titleLength + entry.pathLength)
+            return false;
+
+        GAME *game = games->games + i;
+        game->gameID = ncfgBE32(entry.gameID);
+        memcpy(game->maker, entry.maker, sizeof(game->maker));
+        game->disc = entry.disc;
+        game->mtime = ((uint64_t)ncfgBE32(entry.mtime[0]) << 32) | ncfgBE32(entry.mtime[1]);
+        game->size = ((uint64_t)ncfgBE32(entry.size[0]) << 32) | ncfgBE32(entry.size[1]);
+        game->dirMtime = ((uint64_t)ncfgBE32(entry.dirMtime[0]) << 32) | ncfgBE32(entry.dirMtime[1]);
+        memcpy(game->title, p, entry.titleLength);
+        game->title[entry.titleLength] = '\0';
+        p += entry.titleLength;
+        memcpy(game->path, p, entry.pathLength);
+        game->path[entry.pathLength] = '\0';
+        p += entry.pathLength;
+
+        // The cache lookups binary search by path
+        if(i > 0 && strcmp(games->games[i - 1].path, game->path) >= 0)
+            return false;
+    }
+
+    if(p != end)
+        return false;
+
+    games->count = count;
+    return true;
+}
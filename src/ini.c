@@ -0,0 +1,463 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <ini.h>
+#include <CommonConfigStrings.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define FIELD(x)                                    \
+    .offset = offsetof(NIN_CFG, x),                 \
+    .size = sizeof(((NIN_CFG *)0)->x),              \
+    .sign = ((__typeof__(((NIN_CFG *)0)->x))-1 < 0)
+
+#define STRING(x)                                   \
+    .offset = offsetof(NIN_CFG, x),                 \
+    .size = sizeof(((NIN_CFG *)0)->x)
+
+#define OPTION(x)   (NIN_CFG_BIT_LAST + x) // The settings following the Config flags in OptionStrings
+#define COUNT(x)    (sizeof(x) / sizeof(x[0]))
+#define HASH_BITS   7
+#define HASH_SIZE   (1 << HASH_BITS)
+#define MAX_SEEDS   0x100000
+#define KEY_COUNT   (NIN_CFG_BIT_LAST + COUNT(fieldKeys))
+
+typedef enum
+{
+    KEY_VERSION,
+    KEY_FLAG,       // mask is the Config bit
+    KEY_NUMBER,
+    KEY_HEX,        // Only the bits in mask, the others belong to other keys
+    KEY_LANGUAGE,
+    KEY_VIDEO,
+    KEY_VIDEO_MODE,
+    KEY_STRING,
+} INI_KEY_TYPE;
+
+typedef struct
+{
+    const char *name;
+    int16_t option; // Index into OptionStrings to take the name from or 0
+    uint8_t type;
+    uint8_t length;
+    uint16_t offset;
+    uint16_t size;
+    bool sign;
+    uint32_t mask;
+} INI_KEY;
+
+// Everything besides the Config flags, which get inserted after Version. This is the order of the export.
+static const INI_KEY fieldKeys[] = {
+    { "Version", .type = KEY_VERSION, FIELD(Version) },
+    { "ConfigFlags", .type = KEY_HEX, FIELD(Config), .mask = ~((1u << NIN_CFG_BIT_LAST) - 1) },
+    { .option = OPTION(0), .type = KEY_NUMBER, FIELD(MaxPads) },
+    { .option = OPTION(1), .type = KEY_LANGUAGE, FIELD(Language) },
+    { .option = OPTION(2), .type = KEY_VIDEO, FIELD(VideoMode) },
+    { .option = OPTION(3), .type = KEY_VIDEO_MODE, FIELD(VideoMode) },
+    { "VideoFlags", .type = KEY_HEX, FIELD(VideoMode), .mask = ~(NIN_VID_MASK | NIN_VID_FORCE_MASK) },
+    { .option = OPTION(4), .type = KEY_NUMBER, FIELD(MemCardBlocks) },
+    { "VideoScale", .type = KEY_NUMBER, FIELD(VideoScale) },
+    { "VideoOffset", .type = KEY_NUMBER, FIELD(VideoOffset) },
+    { "NetworkProfile", .type = KEY_NUMBER, FIELD(NetworkProfile) },
+    { "WiiUGamepadSlot", .type = KEY_NUMBER, FIELD(WiiUGamepadSlot) },
+    { "GameID", .type = KEY_HEX, FIELD(GameID), .mask = 0xFFFFFFFF },
+    { "GamePath", .type = KEY_STRING, STRING(GamePath) },
+    { "CheatPath", .type = KEY_STRING, STRING(CheatPath) },
+};
+
+static INI_KEY keys[KEY_COUNT];
+// Perfect hash of the key names: table[hash] is the index in keys + 1 or 0
+static uint8_t table[HASH_SIZE];
+static uint32_t seed = 0;
+
+// FNV-1a over the lower case name. Other characters get mixed up, too, but the final compare catches that.
+static inline uint32_t hashStep(uint32_t hash, char c)
+{
+    return (hash ^ (uint8_t)(c | 0x20)) * 0x01000193;
+}
+
+static inline uint32_t hashSlot(uint32_t hash)
+{
+    return hash >> (32 - HASH_BITS);
+}
+
+static uint32_t hashName(const char *name, uint32_t s)
+{
+    uint32_t hash = s;
+    while(*name != '\0')
+        hash = hashStep(hash, *name++);
+
+    return hashSlot(hash);
+}
+
+bool iniInit()
+{
+    if(seed != 0)
+        return true;
+
+    uint32_t count = 0;
+    keys[count++] = fieldKeys[0];
+    for(uint32_t bit = 0; bit < NIN_CFG_BIT_LAST; ++bit)
+        keys[count++] = (INI_KEY){ .name = OptionStrings[bit], .type = KEY_FLAG, FIELD(Config), .mask = 1u << bit };
+    for(uint32_t i = 1; i < COUNT(fieldKeys); ++i)
+    {
+        keys[count] = fieldKeys[i];
+        if(keys[count].option)
+            keys[count].name = OptionStrings[keys[count].option];
+
+        ++count;
+    }
+
+    for(uint32_t i = 0; i < KEY_COUNT; ++i)
+        keys[i].length = strlen(keys[i].name);
+
+    // Try seeds until every key gets a slot of its own. Expect a few hundred tries with the load factor here.
+    for(uint32_t s = 1; s < MAX_SEEDS; ++s)
+    {
+        memset(table, 0, HASH_SIZE);
+        uint32_t i = 0;
+        for(; i < KEY_COUNT; ++i)
+        {
+            uint32_t slot = hashName(keys[i].name, s);
+            if(table[slot])
+                break;
+
+            table[slot] = i + 1;
+        }
+
+        if(i == KEY_COUNT)
+        {
+            seed = s;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static inline char lower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+// strncasecmp() goes through the locale, which is slower than the parsing around it
+static bool matches(const char *name, const char *value, size_t len)
+{
+    for(size_t i = 0; i < len; ++i)
+        if(name[i] == '\0' || lower(name[i]) != lower(value[i]))
+            return false;
+
+    return name[len] == '\0';
+}
+
+static inline uint32_t *field32(NIN_CFG *cfg, const INI_KEY *key)
+{
+    return (uint32_t *)((uint8_t *)cfg + key->offset);
+}
+
+static int64_t getNumber(const NIN_CFG *cfg, const INI_KEY *key)
+{
+    const uint8_t *field = (const uint8_t *)cfg + key->offset;
+    if(key->size == 1)
+        return key->sign ? *(const int8_t *)field : *field;
+
+    return key->sign ? *(const int32_t *)field : *(const uint32_t *)field;
+}
+
+static int32_t findName(const char *const *names, uint32_t count, const char *value, size_t len)
+{
+    for(uint32_t i = 0; i < count; ++i)
+        if(names[i][0] != '\0' && matches(names[i], value, len))
+            return i;
+
+    return -1;
+}
+
+static inline int copyName(const char *name, char *out)
+{
+    size_t len = strlen(name);
+    memcpy(out, name, len);
+    return len;
+}
+
+static int formatValue(const INI_KEY *key, const NIN_CFG *cfg, char *out, size_t size)
+{
+    uint32_t value = key->size == sizeof(uint32_t) ? *field32((NIN_CFG *)cfg, key) : 0;
+    switch(key->type)
+    {
+        case KEY_VERSION:
+            return snprintf(out, size, "%u", value);
+        case KEY_FLAG:
+            return copyName((value & key->mask) ? "On" : "Off", out);
+        case KEY_NUMBER:
+            return snprintf(out, size, "%lld", (long long)getNumber(cfg, key));
+        case KEY_HEX:
+            return snprintf(out, size, "0x%08X", value & key->mask);
+        case KEY_LANGUAGE:
+            if(value == (uint32_t)NIN_LAN_AUTO)
+                return copyName(LanguageStrings[NIN_LAN_LAST], out);
+            if(value < NIN_LAN_LAST)
+                return copyName(LanguageStrings[value], out);
+            return snprintf(out, size, "%u", value);
+        case KEY_VIDEO:
+            value = (value & NIN_VID_MASK) >> 16;
+            if(value < COUNT(VideoStrings) && VideoStrings[value][0] != '\0')
+                return copyName(VideoStrings[value], out);
+            return snprintf(out, size, "%u", value);
+        case KEY_VIDEO_MODE:
+        {
+            int32_t force = ncfgForceIndex(value);
+            if(force >= 0)
+                return copyName(VideoModeStrings[force], out);
+            return snprintf(out, size, "%u", value & NIN_VID_FORCE_MASK);
+        }
+        case KEY_STRING:
+        {
+            const char *str = (const char *)cfg + key->offset;
+            return snprintf(out, size, "%.*s", (int)strnlen(str, key->size), str);
+        }
+    }
+
+    return 0;
+}
+
+size_t iniExport(const NIN_CFG *cfg, char *out)
+{
+    size_t len = 0;
+    for(uint32_t i = 0; i < KEY_COUNT; ++i)
+    {
+        memcpy(out + len, keys[i].name, keys[i].length);
+        len += keys[i].length;
+        memcpy(out + len, " = ", 3);
+        len += 3;
+        len += formatValue(keys + i, cfg, out + len, INI_MAX_SIZE - len);
+        out[len++] = '\n';
+    }
+
+    return len;
+}
+
+// Decimal or 0x prefixed hex with an optional sign, nothing else
+static bool parseNumber(const char *value, size_t len, int64_t *out)
+{
+    const char *end = value + len;
+    bool negative = value < end && *value == '-';
+    if(negative)
+        ++value;
+
+    uint32_t base = 10;
+    if(end - value > 2 && value[0] == '0' && (value[1] | 0x20) == 'x')
+    {
+        base = 16;
+        value += 2;
+    }
+
+    if(value == end)
+        return false;
+
+    int64_t number = 0;
+    for(; value < end; ++value)
+    {
+        uint32_t digit;
+        if(*value >= '0' && *value <= '9')
+            digit = *value - '0';
+        else if(base == 16 && (*value | 0x20) >= 'a' && (*value | 0x20) <= 'f')
+            digit = (*value | 0x20) - 'a' + 10;
+        else
+            return false;
+
+        number = number * base + digit;
+        if(number > UINT32_MAX)
+            return false;
+    }
+
+    *out = negative ? -number : number;
+    return true;
+}
+
+static INI_STATUS parseValue(const INI_KEY *key, NIN_CFG *cfg, const char *value, size_t len)
+{
+    uint32_t *field = field32(cfg, key);
+    int64_t number;
+    int32_t index;
+    switch(key->type)
+    {
+        case KEY_VERSION:
+            if(!parseNumber(value, len, &number))
+                return INI_ERROR_VALUE;
+            if(number != NIN_CFG_VERSION)
+                return INI_ERROR_VERSION;
+            *field = number;
+            return INI_OK;
+        case KEY_FLAG:
+            if(matches("On", value, len))
+                cfg->Config |= key->mask;
+            else if(matches("Off", value, len))
+                cfg->Config &= ~key->mask;
+            else
+                return INI_ERROR_VALUE;
+            return INI_OK;
+        case KEY_NUMBER:
+            if(!parseNumber(value, len, &number))
+                return INI_ERROR_VALUE;
+            if(key->size == 1)
+            {
+                if(key->sign ? (number < INT8_MIN || number > INT8_MAX) : (number < 0 || number > UINT8_MAX))
+                    return INI_ERROR_VALUE;
+                *(uint8_t *)field = number;
+            }
+            else
+            {
+                if(number < INT32_MIN)
+                    return INI_ERROR_VALUE;
+                *field = number;
+            }
+            return INI_OK;
+        case KEY_HEX:
+            if(!parseNumber(value, len, &number) || number < 0 || (number & ~(int64_t)key->mask) != 0)
+                return INI_ERROR_VALUE;
+            *field = (*field & ~key->mask) | number;
+            return INI_OK;
+        case KEY_LANGUAGE:
+            index = findName(LanguageStrings, COUNT(LanguageStrings), value, len);
+            if(index == NIN_LAN_LAST)
+                number = NIN_LAN_AUTO;
+            else if(index >= 0)
+                number = index;
+            else if(!parseNumber(value, len, &number) || number < INT32_MIN)
+                return INI_ERROR_VALUE;
+            *field = number;
+            return INI_OK;
+        case KEY_VIDEO:
+            index = findName(VideoStrings, COUNT(VideoStrings), value, len);
+            if(index >= 0)
+                number = index;
+            else if(!parseNumber(value, len, &number) || number < 0 || number > (NIN_VID_MASK >> 16))
+                return INI_ERROR_VALUE;
+            *field = (*field & ~NIN_VID_MASK) | (uint32_t)number << 16;
+            return INI_OK;
+        case KEY_VIDEO_MODE:
+            index = findName(VideoModeStrings, COUNT(VideoModeStrings), value, len);
+            if(index >= 0)
+                number = 1 << index;
+            else if(!parseNumber(value, len, &number) || number < 0 || number > NIN_VID_FORCE_MASK)
+                return INI_ERROR_VALUE;
+            *field = (*field & ~NIN_VID_FORCE_MASK) | number;
+            return INI_OK;
+        case KEY_STRING:
+            if(len >= key->size)
+                return INI_ERROR_VALUE;
+            memcpy(field, value, len);
+            memset((char *)field + len, 0, key->size - len);
+            return INI_OK;
+    }
+
+    return INI_ERROR_KEY;
+}
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+INI_STATUS iniImport(NIN_CFG *cfg, const char *data, size_t size, uint32_t *line)
+{
+    const char *p = data;
+    const char *end = data + size;
+    *line = 0;
+    while(p < end)
+    {
+        ++*line;
+        while(p < end && isBlank(*p))
+            ++p;
+
+        // Empty lines, comments and section headers
+        if(p == end || *p == '\n' || *p == ';' || *p == '#' || *p == '[')
+        {
+            p = memchr(p, '\n', end - p);
+            if(p == NULL)
+                break;
+
+            ++p;
+            continue;
+        }
+
+        // The key gets hashed while searching for the '=', without the blanks in front of it
+        const char *key = p;
+        const char *keyEnd = p;
+        uint32_t hash = seed;
+        uint32_t keyHash = seed;
+        for(; p < end && *p != '=' && *p != '\n'; ++p)
+        {
+            hash = hashStep(hash, *p);
+            if(!isBlank(*p))
+            {
+                keyHash = hash;
+                keyEnd = p + 1;
+            }
+        }
+
+        if(p == end || *p != '=')
+            return INI_ERROR_SYNTAX;
+
+        for(++p; p < end && isBlank(*p); ++p)
+            ;
+
+        const char *value = p;
+        const char *valueEnd = p;
+        for(; p < end && *p != '\n'; ++p)
+            if(!isBlank(*p))
+                valueEnd = p + 1;
+
+        if(p < end)
+            ++p;
+
+        uint32_t slot = table[hashSlot(keyHash)];
+        size_t keyLen = keyEnd - key;
+        if(slot == 0 || keys[slot - 1].length != keyLen || !matches(keys[slot - 1].name, key, keyLen))
+            return INI_ERROR_KEY;
+
+        INI_STATUS status = parseValue(keys + slot - 1, cfg, value, valueEnd - value);
+        if(status != INI_OK)
+            return status;
+    }
+
+    return INI_OK;
+}
+
+const char *iniStatusStr(INI_STATUS status)
+{
+    switch(status)
+    {
+        case INI_OK:
+            return "OK";
+        case INI_ERROR_SIZE:
+            return "Too big";
+        case INI_ERROR_SYNTAX:
+            return "Syntax error";
+        case INI_ERROR_KEY:
+            return "Unknown key";
+        case INI_ERROR_VALUE:
+            return "Invalid value";
+        case INI_ERROR_VERSION:
+            return "Wrong version";
+    }
+
+    return "Unknown error";
+}
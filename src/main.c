@@ -17,25 +17,36 @@
  ***************************************************************************/
 
 #include <CommonConfig.h>
-#include <CommonConfigStrings.h>
-
+#include <display.h>
+#include <games.h>
+#include <migrate.h>
+#include <ncfg.h>
+#include <patch.h>
+#include <profiles.h>
+#include <provision.h>
+#include <screen.h>
+#include <settings.h>
+#include <trace.h>
+
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <coreinit/debug.h>
 #include <coreinit/filesystem_fsa.h>
 #include <coreinit/foreground.h>
 #include <coreinit/memdefaultheap.h>
 #include <coreinit/memory.h>
+#include <coreinit/messagequeue.h>
 #include <coreinit/thread.h>
+#include <coreinit/time.h>
 #include <coreinit/title.h>
 #include <proc_ui/procui.h>
 #include <sysapp/launch.h>
 #include <vpad/input.h>
-#include <whb/log.h>
-#include <whb/log_console.h>
 #include <mocha/mocha.h>
 
 #define COLOR_BACKGROUND 0x000033FF
@@ -43,86 +54,189 @@
 
 #define FS_ALIGN(x)      ((x + 0x3F) & ~(0x3F))
 #define WRITE_BUFSIZE    (1024 * 1024) // 1 MB
-#define MAX_LINES        16
-#define NINCFG_PATH      "/vol/external01/nincfg.bin"
+#define MAX_LINES        SCREEN_LINES
+#define SD_PATH          "/vol/external01"
+#define NINCFG_PATH      SD_PATH "/nincfg.bin"
+#define PROFILES_PATH    SD_PATH "/nincfg_profiles.bin"
+#define PATCH_PATH       SD_PATH "/nincfg_patch.bin"
+#define GAMES_INDEX_PATH SD_PATH "/nincfg_games.bin"
+#define PROVISION_PATH   SD_PATH "/nincfg_provision.txt"
+#define PROVISION_LOG    SD_PATH "/nincfg_provision.log"
+#define PROVISION_DONE   SD_PATH "/nincfg_provision.done"
+#define TRACE_PATH       SD_PATH "/nincfg_trace.csv"
+#define TRACE_STATS_PATH SD_PATH "/nincfg_trace_stats.csv"
+#define TMP_SUFFIX       ".tmp"
+
+#define PROFILE_LINES    (MAX_LINES - 4)
+#define PROFILE_DEFAULT  -1
+#define PROFILE_EXIT     -2
+
+#define VPAD_SAMPLES     16 // Size of the VPAD sample buffer
+#define FRAME_TICKS      OSNanosecondsToTicks(16666667)
+#define IDLE_TICKS       OSMillisecondsToTicks(50) // Needs to stay below what fits into VPAD_SAMPLES
+#define IDLE_AFTER       OSSecondsToTicks(5)
+#define RELOAD_POLL      OSSecondsToTicks(1) // How often nincfg.bin gets checked for changes made by others
+#define LATENCY_REPORT   32
+#define TRACE_CHORD      (VPAD_BUTTON_ZL | VPAD_BUTTON_ZR | VPAD_BUTTON_X) // Hold ZL + ZR and press X to dump the trace
+
+#define SAVE_STACK_SIZE  0x4000
+#define TASK_STACK_SIZE  0x4000
+#define SAVE_QUEUE_SIZE  8
+#define SAVE_NINCFG      0
+#define SAVE_PROFILES    1
+#define SAVE_TRACE       2
+#define SAVE_TRACE_STATS 3
+
+#define LABEL_WIDTH      24
+#define VALUE_COLUMN     (3 + LABEL_WIDTH + 1) // "-> ", the label and "<"
+
+#define ROW_INFO         (SETTINGS_COUNT + 1)
+#define ROW_HELP         (SETTINGS_COUNT + 2)
 
 static FSAClientHandle fsaClient;
-static int mcpHandle;
 
-static FSAFileHandle fileHandle;
 static uint8_t *writeBuffer;
 static size_t writeBufferFill = 0;
 
-static size_t arg0;
-static size_t arg1;
 static bool error = false;
 
-static char sizeStr[64];
-
-static const char *infoTexts[13] = {
-    "Emulate memory card (you want this to be \"Single\")",
-    "Size of the emulated memory card",
-    "Force 16:9 widescreen for 4:3 games",
-    "Force progressive for inerlaced games",
-    "Allows to read faster than a GCN disc drive",
-    "Move the C stick to insert coins",
-    "Rumble the wiimote with classic or pro controller",
-    "Skip loading the IPL",
-    "Game language (only for PAL)",
-    "The video mode the game renders",
-    "Video scaling. Set to \"Auto\" or \"104\"",
-    "The offset. You want this to be 0",
-    "The controller the gamepad replaces",
-};
+static void *profileStore = NULL;
+static size_t profileStoreSize;
 
-static const char *languages[7] = {
-    "English",
-    "German",
-    "French",
-    "Spanish",
-    "Italian",
-    "Dutch",
-    "Auto",
-};
+// One byte more than a NIN_CFG (plus FS_ALIGN padding), so a single read also tells if the file is too big
+typedef struct
+{
+    NIN_CFG cfg;
+    uint8_t overflow[0x40];
+} __attribute__((aligned(0x40))) CFG_BUFFER;
+
+static CFG_BUFFER cfgBuffer;
+static CFG_BUFFER reloadBuffer; // For nincfg.bin after others changed it, see pollConfig()
+
+// The files as they have been on the SD card when loading, to skip writing unchanged data
+static NIN_CFG loadedCfg;
+static NIN_CFG loadedProfile;
+
+// To notice others writing to nincfg.bin while the UI is open: Size and time of the file as loaded, and the
+// config the UI started from to merge their changes with the edits made since
+static FSStat loadedStat;
+static NIN_CFG baseCfg;
+static OSTime lastPoll;
 
-static char *getVidMode(uint32_t vidMode)
+static MIGRATION migration;
+static PATCH patch;
+
+// Games on the SD card, so profiles can be created for them and show titles (see games.h)
+static GAMES *games = NULL;
+static uint8_t gameHeader[FS_ALIGN(GAMES_HEADER_SIZE)] __attribute__((aligned(0x40)));
+
+// Saves run on their own thread, so the UI stays responsive while the SD card is busy.
+// The worker takes SAVE_JOBs from saveQueue and hands them back through doneQueue.
+typedef struct
+{
+    const char *path;
+    const void *data;
+    size_t size;
+    FSError result;
+} SAVE_JOB;
+
+static OSThread saveThread __attribute__((aligned(8)));
+static uint8_t saveStack[SAVE_STACK_SIZE] __attribute__((aligned(16)));
+static OSMessageQueue saveQueue;
+static OSMessage saveMessages[SAVE_QUEUE_SIZE];
+static OSMessageQueue doneQueue;
+static OSMessage doneMessages[SAVE_QUEUE_SIZE];
+static bool saveThreadRunning = false;
+
+static SAVE_JOB saveJobs[4]; // SAVE_NINCFG, SAVE_PROFILES, SAVE_TRACE and SAVE_TRACE_STATS
+static uint32_t savesPending = 0;
+static OSTime saveStart;
+static NIN_CFG saveCfg __attribute__((aligned(0x40))); // Serialized copy of the config for the worker
+
+static SCREEN screen;
+// The parts of the settings rows which never change, see initSettingRows()
+static char settingRows[SETTINGS_COUNT][SCREEN_LINE_LENGTH];
+
+// Startup stages which don't depend on each other run side by side on the three cores, see main().
+// The main thread stays on core 1 and joins the tasks once it needs their results.
+typedef struct
 {
-    uint32_t vidMask = vidMode;
-    vidMask >>= 16;
+    OSThread thread __attribute__((aligned(8)));
+    uint8_t stack[TASK_STACK_SIZE] __attribute__((aligned(16)));
+    bool running;
+    int result;
+} STARTUP_TASK;
+
+static STARTUP_TASK mochaTask;   // Mocha_InitLibrary() on core 0 while core 1 sets up FSA
+static STARTUP_TASK consoleTask; // displayInit() on core 2 while core 1 loads the config
+static bool consoleStarted = false;
+static bool consoleReady = false;
+
+static struct
+{
+    OSTime start;
+    OSTime consoleStart;
+    OSTime console;
+    OSTime fsa;
+    OSTime mocha;
+    OSTime prepare;
+    OSTime open;
+    OSTime read;
+    OSTime validate;
+    OSTime frame;
+} startupTimes;
+
+// Where the time of each frame of mainLoop() goes, see trace.h. TRACE_CHORD writes it out.
+static TRACE trace;
+static TRACE_FRAME traceFrames[TRACE_FRAMES];
+static char traceCsv[TRACE_CSV_SIZE];
+static char traceStats[TRACE_STATS_SIZE];
+static bool traceSaving = false;
+
+static OSTime nextFrame;
+static OSTime lastInput;
+static struct
+{
+    OSTime total;
+    OSTime max;
+    uint32_t count;
+} latency;
 
-    if(vidMask & (NIN_VID_INDEX_FORCE | NIN_VID_INDEX_FORCE_DF))
-        snprintf(sizeStr, 31, "%s %s", VideoStrings[vidMask], VideoModeStrings[vidMode & NIN_VID_FORCE_MASK]);
-    else
-        snprintf(sizeStr, 31, "%s", VideoStrings[vidMask]);
+// Draws if something changed or the framebuffers got lost
+static void drawScreen()
+{
+    if(!screen.dirty && !displayStale())
+        return;
 
-    return sizeStr;
+    displayDraw(&screen);
+    screen.dirty = 0;
+
+    if(startupTimes.frame == 0)
+    {
+        startupTimes.frame = OSGetSystemTime();
+        OSReport("Nincfg: first frame %llu us after start (console %llu us on core 2)\n",
+                 OSTicksToMicroseconds(startupTimes.frame - startupTimes.start),
+                 OSTicksToMicroseconds(startupTimes.console - startupTimes.consoleStart));
+    }
 }
 
-static void clearScreen()
+// Messages scroll up from the bottom of the screen like on a console
+static void logPrint(const char *text)
 {
-    for(int i = 0; i < MAX_LINES; ++i)
-        WHBLogPrint("");
+    screenScroll(&screen);
+    screenSetLine(&screen, MAX_LINES - 1, text);
 }
 
-static char *getSizeStr(uint32_t size)
+static void logPrintf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void logPrintf(const char *format, ...)
 {
-    const char *suffix;
-    if(size >= 1024)
-    {
-        size >>= 10;
-        if(size >= 1024)
-        {
-            size >>= 10;
-            suffix = "MB";
-        }
-        else
-            suffix = "KB";
-    }
-    else
-        suffix = "B";
+    char line[SCREEN_LINE_LENGTH];
+    va_list va;
+    va_start(va, format);
+    vsnprintf(line, SCREEN_LINE_LENGTH, format, va);
+    va_end(va);
 
-    snprintf(sizeStr, 63, "%u%s", size, suffix);
-    return sizeStr;
+    logPrint(line);
 }
 
 static size_t readFile(const char *path, void **buffer)
@@ -145,37 +259,209 @@ static size_t readFile(const char *path, void **buffer)
                     return stat.size;
                 }
 
-                WHBLogPrintf("Error reading %s: %s", path, FSAGetStatusStr(err));
+                logPrintf("Error reading %s: %s", path, FSAGetStatusStr(err));
                 MEMFreeToDefaultHeap(*buffer);
             }
             else
-                WHBLogPrint("EOM!");
+                logPrint("EOM!");
         }
         else
-            WHBLogPrintf("Error getting stats for %s: %s", path, FSAGetStatusStr(err));
+            logPrintf("Error getting stats for %s: %s", path, FSAGetStatusStr(err));
 
         FSACloseFile(fsaClient, handle);
     }
     else
-        WHBLogPrintf("Error opening %s: %s", path, FSAGetStatusStr(err));
+        logPrintf("Error opening %s: %s", path, FSAGetStatusStr(err));
 
     *buffer = NULL;
     return 0;
 }
 
-static FSError writeFile(const char *path, void *buffer, size_t size)
+// Reads path into buffer without touching the heap: One open, one stat, one read, one close. The stat goes to
+// stat, to notice later changes. If opened isn't NULL, it gets the time the open and stat were done. Returns the
+// number of bytes read, which is sizeof(NIN_CFG) + 1 for files which are too big, or an error.
+static int32_t readConfig(const char *path, CFG_BUFFER *buffer, FSStat *stat, OSTime *opened)
 {
     FSAFileHandle handle;
-    FSError err = FSAOpenFileEx(fsaClient, path, "w", 0x660, FS_OPEN_FLAG_NONE, 0, &handle);
+    FSError err = FSAOpenFileEx(fsaClient, path, "r", 0x000, FS_OPEN_FLAG_NONE, 0, &handle);
+    if(err != FS_ERROR_OK)
+        return err;
+
+    err = FSAGetStatFile(fsaClient, handle, stat);
+    if(opened != NULL)
+        *opened = OSGetSystemTime();
+    int32_t read = err == FS_ERROR_OK ? FSAReadFile(fsaClient, buffer, 1, sizeof(NIN_CFG) + 1, handle, 0) : err;
+    FSACloseFile(fsaClient, handle);
+    return read;
+}
+
+// readConfig() into cfgBuffer for the startup. There's deliberately no cache of the loaded and normalized config:
+// migrationLoad() and ncfgNormalize() take about 40 ns, hashing the file to validate a cache alone takes longer
+// and reading one is another file open.
+static size_t loadConfig(const char *path)
+{
+    startupTimes.prepare = startupTimes.open = OSGetSystemTime();
+    int32_t read = readConfig(path, &cfgBuffer, &loadedStat, &startupTimes.open);
+    startupTimes.read = OSGetSystemTime();
+    if(read < 0)
+    {
+        logPrintf("Error reading %s: %s", path, FSAGetStatusStr((FSError)read));
+        return 0;
+    }
+
+    return read;
+}
+
+// After saving NINCFG_PATH ourselves: Remember its new stat, so pollConfig() doesn't take our own write for
+// someone else's
+static void savedConfig()
+{
+    if(FSAGetStat(fsaClient, NINCFG_PATH, &loadedStat) != FS_ERROR_OK)
+        OSReport("Nincfg: can't stat %s after saving\n", NINCFG_PATH);
+}
+
+static void reportStartup()
+{
+    OSReport("Nincfg: startup %llu us (FSA %llu, Mocha %llu, prepare %llu, open + stat %llu, read %llu, validate %llu)\n",
+             OSTicksToMicroseconds(startupTimes.validate - startupTimes.start),
+             OSTicksToMicroseconds(startupTimes.fsa - startupTimes.start),
+             OSTicksToMicroseconds(startupTimes.mocha - startupTimes.fsa),
+             OSTicksToMicroseconds(startupTimes.prepare - startupTimes.mocha),
+             OSTicksToMicroseconds(startupTimes.open - startupTimes.prepare),
+             OSTicksToMicroseconds(startupTimes.read - startupTimes.open),
+             OSTicksToMicroseconds(startupTimes.validate - startupTimes.read));
+}
+
+static bool fileExists(const char *path)
+{
+    FSStat stat;
+    return FSAGetStat(fsaClient, path, &stat) == FS_ERROR_OK;
+}
+
+// Finishes a saveFile() which got interrupted after deleting the old file
+static void recoverFile(const char *path)
+{
+    char tmp[FS_MAX_PATH];
+    snprintf(tmp, FS_MAX_PATH, "%s" TMP_SUFFIX, path);
+    if(!fileExists(path) && fileExists(tmp))
+        FSARename(fsaClient, tmp, path);
+}
+
+// Stages size bytes of data through writeBuffer into path.tmp, flushes it and only then replaces path with it,
+// so a power loss leaves either the old or the new file (see recoverFile()).
+static FSError saveFile(const char *path, const void *data, size_t size)
+{
+    OSTime start = OSGetSystemTime();
+    char tmp[FS_MAX_PATH];
+    snprintf(tmp, FS_MAX_PATH, "%s" TMP_SUFFIX, path);
+
+    FSAFileHandle handle;
+    FSError err = FSAOpenFileEx(fsaClient, tmp, "w", 0x660, FS_OPEN_FLAG_NONE, 0, &handle);
+    if(err != FS_ERROR_OK)
+        goto report;
+
+    for(size_t pos = 0; pos < size; pos += writeBufferFill)
+    {
+        writeBufferFill = size - pos > WRITE_BUFSIZE ? WRITE_BUFSIZE : size - pos;
+        OSBlockMove(writeBuffer, (const uint8_t *)data + pos, writeBufferFill, false);
+        int32_t written = FSAWriteFile(fsaClient, writeBuffer, writeBufferFill, 1, handle, 0);
+        if(written != 1)
+        {
+            err = written < 0 ? (FSError)written : FS_ERROR_MEDIA_ERROR;
+            break;
+        }
+    }
+
+    writeBufferFill = 0;
     if(err == FS_ERROR_OK)
+        err = FSAFlushFile(fsaClient, handle);
+
+    FSACloseFile(fsaClient, handle);
+    if(err != FS_ERROR_OK)
     {
-        err = FSAWriteFile(fsaClient, buffer, size, 1, handle, 0);
-        FSACloseFile(fsaClient, handle);
+        FSARemove(fsaClient, tmp);
+        goto report;
     }
 
+    err = FSARemove(fsaClient, path);
+    if(err == FS_ERROR_OK || err == FS_ERROR_NOT_FOUND)
+        err = FSARename(fsaClient, tmp, path);
+    if(err == FS_ERROR_OK)
+        err = FSAFlushVolume(fsaClient, SD_PATH);
+
+report:
+    if(err == FS_ERROR_OK)
+        OSReport("Nincfg: saved %s (%zu bytes) in %llu us\n", path, size, OSTicksToMicroseconds(OSGetSystemTime() - start));
+    else
+        OSReport("Nincfg: error saving %s: %s\n", path, FSAGetStatusStr(err));
+
     return err;
 }
 
+static int saveThreadMain(int argc, const char **argv)
+{
+    OSMessage msg;
+    while(1)
+    {
+        OSReceiveMessage(&saveQueue, &msg, OS_MESSAGE_FLAGS_BLOCKING);
+        SAVE_JOB *job = msg.message;
+        if(job == NULL) // stopSaveThread()
+            return 0;
+
+        job->result = saveFile(job->path, job->data, job->size);
+        OSSendMessage(&doneQueue, &msg, OS_MESSAGE_FLAGS_BLOCKING);
+    }
+}
+
+static bool startSaveThread()
+{
+    OSInitMessageQueue(&saveQueue, saveMessages, SAVE_QUEUE_SIZE);
+    OSInitMessageQueue(&doneQueue, doneMessages, SAVE_QUEUE_SIZE);
+    // One below the UI thread, which only needs the CPU for a few microseconds per frame
+    if(!OSCreateThread(&saveThread, saveThreadMain, 0, NULL, saveStack + SAVE_STACK_SIZE, SAVE_STACK_SIZE, 17, OS_THREAD_ATTRIB_AFFINITY_ANY))
+        return false;
+
+    OSSetThreadName(&saveThread, "Nincfg save");
+    OSResumeThread(&saveThread);
+    saveThreadRunning = true;
+    return true;
+}
+
+// Waits for all queued saves to finish, so nothing gets lost on exit
+static void stopSaveThread()
+{
+    if(!saveThreadRunning)
+        return;
+
+    OSMessage msg = { .message = NULL };
+    OSSendMessage(&saveQueue, &msg, OS_MESSAGE_FLAGS_BLOCKING);
+    OSJoinThread(&saveThread, NULL);
+    saveThreadRunning = false;
+}
+
+static void queueSave(uint32_t index, const char *path, const void *data, size_t size)
+{
+    SAVE_JOB *job = saveJobs + index;
+    job->path = path;
+    job->data = data;
+    job->size = size;
+    job->result = FS_ERROR_OK;
+
+    OSMessage msg = { .message = job };
+    OSSendMessage(&saveQueue, &msg, OS_MESSAGE_FLAGS_BLOCKING);
+    ++savesPending;
+}
+
+// Collects finished saves without blocking. Returns true once none are pending anymore.
+static bool pollSaves()
+{
+    OSMessage msg;
+    while(savesPending && OSReceiveMessage(&doneQueue, &msg, OS_MESSAGE_FLAGS_NONE))
+        --savesPending;
+
+    return savesPending == 0;
+}
+
 static uint32_t homeCallback(void *ctx)
 {
     uint64_t tid = OSGetTitleID();
@@ -185,425 +471,925 @@ static uint32_t homeCallback(void *ctx)
         SYSLaunchMenu();
 
 // TODO: This causes a blackscreen in the Wii U menu
-//    WHBLogConsoleFree();
+//    displayShutdown();
     return 0;
 }
-int readInput()
+// Drains the whole VPAD buffer and writes every press to triggers, oldest first. Returns the number of presses.
+// Triggers are calculated from the hold state so presses in between two reads don't get lost.
+static uint32_t readInput(uint32_t *triggers)
 {
+    static VPADStatus vpad[VPAD_SAMPLES];
+    static uint32_t lastHold = 0;
     VPADReadError vError;
-    VPADStatus vpad;
-    VPADRead(VPAD_CHAN_0, &vpad, 1, &vError);
-    if(vError == VPAD_READ_SUCCESS && vpad.trigger)
+    int32_t samples = VPADRead(VPAD_CHAN_0, vpad, VPAD_SAMPLES, &vError);
+    if(vError != VPAD_READ_SUCCESS)
+        return 0;
+
+    uint32_t count = 0;
+    for(int32_t i = samples - 1; i >= 0; --i) // vpad[0] is the newest one
     {
-        vpad.trigger &= ~(VPAD_STICK_R_EMULATION_LEFT | VPAD_STICK_R_EMULATION_RIGHT | VPAD_STICK_R_EMULATION_UP | VPAD_STICK_R_EMULATION_DOWN | VPAD_BUTTON_HOME);
-        return vpad.trigger;
+        uint32_t hold = vpad[i].hold & ~(VPAD_STICK_R_EMULATION_LEFT | VPAD_STICK_R_EMULATION_RIGHT | VPAD_STICK_R_EMULATION_UP | VPAD_STICK_R_EMULATION_DOWN | VPAD_BUTTON_HOME);
+        uint32_t trigger = hold & ~lastHold;
+        if((trigger & TRACE_CHORD) && (hold & TRACE_CHORD) == TRACE_CHORD) // No matter which button came last
+            trigger |= TRACE_CHORD;
+        lastHold = hold;
+        if(trigger)
+            triggers[count++] = trigger;
     }
 
-    return 0;
+    return count;
 }
 
-void mainLoop()
+// Runs the UI loops once per frame while in use and drops to IDLE_TICKS once nothing happened for IDLE_AFTER.
+// This is a free running clock, not synced to anything: OSScreen has no call to wait for a flip and VPAD samples
+// come without a timestamp to lock onto. So it drifts against both, a press can wait up to FRAME_TICKS in the
+// VPAD buffer and a drawn frame up to another FRAME_TICKS for the flip to show it.
+static void waitForFrame(bool input)
 {
-    WHBLogConsoleSetColor(COLOR_BACKGROUND);
+    OSTime now = OSGetSystemTime();
+    if(input)
+        lastInput = now;
 
-    bool redraw = true;
-    uint32_t buttons;
-    uint32_t cursor = 0;
+    nextFrame += now - lastInput > IDLE_AFTER ? IDLE_TICKS : FRAME_TICKS;
+    if(nextFrame > now)
+        OSSleepTicks(nextFrame - now);
+    else
+        nextFrame = now;
+}
+
+// Time from reading the presses to having them drawn. On top of that comes up to one frame (FRAME_TICKS) the press
+// waited in the VPAD buffer and up to one until the flip, see waitForFrame().
+static void reportLatency(OSTime readTime)
+{
+    OSTime time = OSGetSystemTime() - readTime;
+    latency.total += time;
+    if(time > latency.max)
+        latency.max = time;
 
-    NIN_CFG *cfg;
-    buttons = readFile(NINCFG_PATH, (void **)&cfg);
-    if(buttons != sizeof(NIN_CFG))
+    if(++latency.count == LATENCY_REPORT)
     {
-        WHBLogPrintf("%u vs %u", buttons, sizeof(NIN_CFG));
-        error = true;
-        return;
+        OSReport("Nincfg: input to draw %llu us avg, %llu us max (+ up to %llu us polling, %llu us to the flip)\n",
+                 OSTicksToMicroseconds(latency.total / latency.count), OSTicksToMicroseconds(latency.max),
+                 OSTicksToMicroseconds(FRAME_TICKS), OSTicksToMicroseconds(FRAME_TICKS));
+        latency.total = latency.max = 0;
+        latency.count = 0;
+    }
+}
+
+// Applies PROVISION_PATH to nincfg.bin with the same rules as the UI and saves it, then writes what happened and
+// how long it took to PROVISION_LOG and leaves. Nothing gets drawn, there isn't even a console. Once applied the
+// script becomes PROVISION_DONE, so the next start shows the UI and edits made there stay.
+// Returns false if there is no script, so the UI starts as usual.
+static bool provision()
+{
+    static char log[1024];
+    size_t len = 0;
+    if(!fileExists(PROVISION_PATH))
+        return false;
+
+    void *script;
+    size_t scriptSize = readFile(PROVISION_PATH, &script);
+    if(script == NULL)
+    {
+        len = snprintf(log, sizeof(log), "Result: Error reading %s\n", PROVISION_PATH);
+        goto writeLog;
+    }
+
+    NIN_CFG *cfg = &cfgBuffer.cfg;
+    recoverFile(NINCFG_PATH);
+    size_t size = loadConfig(NINCFG_PATH);
+    if(size <= sizeof(NIN_CFG))
+        OSBlockMove(&loadedCfg, cfg, size, false);
+
+    NCFG_STATUS status = migrationLoad(cfg, &loadedCfg, size, &migration);
+    if(status != NCFG_OK)
+    {
+        len = snprintf(log, sizeof(log), "Result: %s: %s\n", NINCFG_PATH, ncfgStatusStr(status));
+        MEMFreeToDefaultHeap(script);
+        goto writeLog;
     }
 
-    if(cfg->Magicbytes != 0x01070CF6)
+    // Nothing gets saved unless the whole script is fine
+    uint32_t line, edits;
+    ncfgNormalize(cfg);
+    PROVISION_STATUS result = provisionApply(cfg, script, scriptSize, &line, &edits);
+    MEMFreeToDefaultHeap(script);
+    if(result != PROVISION_OK)
+    {
+        len = snprintf(log, sizeof(log), "Result: %s in line %u of %s\n", provisionStatusStr(result), line, PROVISION_PATH);
+        goto writeLog;
+    }
+
+    ncfgSerialize(cfg, &saveCfg);
+    bool changed = memcmp(&saveCfg, &loadedCfg, sizeof(NIN_CFG)) != 0;
+    FSError err = changed ? saveFile(NINCFG_PATH, &saveCfg, sizeof(NIN_CFG)) : FS_ERROR_OK;
+    if(changed && err == FS_ERROR_OK)
+        savedConfig();
+
+    FSError moved = FS_ERROR_OK;
+    if(err == FS_ERROR_OK)
     {
-        WHBLogPrint("Magic bytes wrong!");
+        FSARemove(fsaClient, PROVISION_DONE);
+        moved = FSARename(fsaClient, PROVISION_PATH, PROVISION_DONE);
+    }
+
+    len = snprintf(log, sizeof(log), "Result: %s\nEdits: %u\n%s: %s\n%s: %s\n",
+                   err != FS_ERROR_OK ? "Error saving" : moved != FS_ERROR_OK ? "Error renaming script" : "OK", edits,
+                   NINCFG_PATH, err != FS_ERROR_OK ? FSAGetStatusStr(err) : changed ? "saved" : "unchanged",
+                   PROVISION_PATH, moved != FS_ERROR_OK ? FSAGetStatusStr(moved) : err == FS_ERROR_OK ? "renamed to " PROVISION_DONE : "kept");
+
+writeLog:
+    // Everything but writing the log itself
+    len += snprintf(log + len, sizeof(log) - len, "Time: %llu us\n", OSTicksToMicroseconds(OSGetSystemTime() - startupTimes.start));
+    OSReport("Nincfg: provisioning\n%s", log);
+    if(saveFile(PROVISION_LOG, log, len) != FS_ERROR_OK)
+    {
+        logPrint("Error writing " PROVISION_LOG "!");
         error = true;
+        return true;
+    }
+
+    homeCallback(NULL);
+    while(1)
+    {
+        switch(ProcUIProcessMessages(true))
+        {
+            case PROCUI_STATUS_EXITING:
+                return true;
+            case PROCUI_STATUS_RELEASE_FOREGROUND:
+                ProcUIDrawDoneRelease();
+                break;
+            default:
+                OSSleepTicks(IDLE_TICKS);
+                break;
+        }
+    }
+}
+
+// Hands the traced frames as CSV and their p50/p99 to the save thread. Returns false while the last dump
+// is still being written, as that's the same buffers.
+static bool dumpTrace()
+{
+    if(traceSaving && !pollSaves())
+        return false;
+
+    uint32_t count = traceCopy(&trace, traceFrames);
+    size_t csvSize = traceWriteCsv(traceFrames, count, trace.ticksPerSecond, traceCsv, TRACE_CSV_SIZE);
+    size_t statsSize = traceWriteStats(traceFrames, count, trace.ticksPerSecond, traceStats, TRACE_STATS_SIZE);
+    OSReport("Nincfg: trace of %u frames\n%s", count, traceStats);
+
+    queueSave(SAVE_TRACE, TRACE_PATH, traceCsv, csvSize);
+    queueSave(SAVE_TRACE_STATS, TRACE_STATS_PATH, traceStats, statsSize);
+    traceSaving = true;
+    return true;
+}
+
+// Applies PATCH_PATH to cfg (nincfg.bin as loaded) and saves the result right away. The patch gets removed
+// afterwards, so it's applied once and edits made in the UI survive the next start. The outcome goes to info.
+static void applyPatch(NIN_CFG *cfg, char *info)
+{
+    if(!fileExists(PATCH_PATH))
+        return;
+
+    void *buffer;
+    size_t size = readFile(PATCH_PATH, &buffer);
+    if(buffer == NULL)
+        return;
+
+    PATCH_STATUS status = patchLoad(&patch, buffer, size);
+    MEMFreeToDefaultHeap(buffer);
+    if(status != PATCH_OK)
+    {
+        snprintf(info, SCREEN_LINE_LENGTH, "Ignoring broken " PATCH_PATH ": %s", patchStatusStr(status));
         return;
     }
 
-    if(cfg->Version != NIN_CFG_VERSION)
+    patchApply(&patch, cfg);
+    ncfgSerialize(cfg, &saveCfg);
+    FSError err = FS_ERROR_OK;
+    if(memcmp(&saveCfg, &loadedCfg, sizeof(NIN_CFG)) != 0)
     {
-        WHBLogPrintf("Wrong version (got %u but we support %u only)", cfg->Version, NIN_CFG_VERSION);
-        error = true;
+        err = saveFile(NINCFG_PATH, &saveCfg, sizeof(NIN_CFG));
+        if(err == FS_ERROR_OK)
+        {
+            OSBlockMove(&loadedCfg, &saveCfg, sizeof(NIN_CFG), false);
+            savedConfig();
+        }
+    }
+
+    if(err == FS_ERROR_OK)
+        err = FSARemove(fsaClient, PATCH_PATH);
+
+    if(err == FS_ERROR_OK)
+        snprintf(info, SCREEN_LINE_LENGTH, "Applied %u changes from " PATCH_PATH, patch.count);
+    else
+        snprintf(info, SCREEN_LINE_LENGTH, "Error applying " PATCH_PATH ": %s", FSAGetStatusStr(err));
+}
+
+static bool fsaOpenDir(void *ctx, const char *path, uintptr_t *dir)
+{
+    FSADirectoryHandle handle;
+    if(FSAOpenDir(fsaClient, path, &handle) != FS_ERROR_OK)
+        return false;
+
+    *dir = handle;
+    return true;
+}
+
+static bool fsaReadDir(void *ctx, uintptr_t dir, GAMES_DIR_ENTRY *entry)
+{
+    FSADirectoryEntry de;
+    if(FSAReadDir(fsaClient, dir, &de) != FS_ERROR_OK)
+        return false;
+
+    strcpy(entry->name, de.name);
+    entry->dir = de.info.flags & FS_STAT_DIRECTORY;
+    entry->mtime = de.info.modified;
+    entry->size = de.info.size;
+    return true;
+}
+
+static void fsaCloseDir(void *ctx, uintptr_t dir)
+{
+    FSACloseDir(fsaClient, dir);
+}
+
+static bool fsaStat(void *ctx, const char *path, uint64_t *mtime, uint64_t *size)
+{
+    FSStat stat;
+    if(FSAGetStat(fsaClient, path, &stat) != FS_ERROR_OK || (stat.flags & FS_STAT_DIRECTORY))
+        return false;
+
+    *mtime = stat.modified;
+    *size = stat.size;
+    return true;
+}
+
+static bool fsaRead(void *ctx, const char *path, uint32_t offset, void *buffer, uint32_t size)
+{
+    FSAFileHandle handle;
+    if(size > sizeof(gameHeader) || FSAOpenFileEx(fsaClient, path, "r", 0x000, FS_OPEN_FLAG_NONE, 0, &handle) != FS_ERROR_OK)
+        return false;
+
+    FSError err = FSAReadFileWithPos(fsaClient, gameHeader, size, 1, offset, handle, 0);
+    FSACloseFile(fsaClient, handle);
+    if(err != 1)
+        return false;
+
+    OSBlockMove(buffer, gameHeader, size, false);
+    return true;
+}
+
+static const GAMES_FS fsaFS = {
+    .openDir = fsaOpenDir,
+    .readDir = fsaReadDir,
+    .closeDir = fsaCloseDir,
+    .stat = fsaStat,
+    .read = fsaRead,
+};
+
+// Brings the game index up to date: With an index from the last start this only lists GAMES_DIR and stats the
+// games in it, disc headers get read for new or changed files only. full lists every game directory, too.
+static void scanGames(bool full)
+{
+    GAMES *scanned = MEMAllocFromDefaultHeapEx(sizeof(GAMES), 0x40);
+    if(scanned == NULL)
         return;
+
+    OSTime start = OSGetSystemTime();
+    GAMES_STATS stats;
+    gamesScan(scanned, games, &fsaFS, SD_PATH, full, &stats);
+    OSReport("Nincfg: %u games (%u dirs listed, %u files stated, %u headers read) in %llu us\n", scanned->count,
+             stats.dirs, stats.stats, stats.reads, OSTicksToMicroseconds(OSGetSystemTime() - start));
+
+    bool changed = games == NULL || games->count != scanned->count ||
+                   memcmp(games->games, scanned->games, sizeof(GAME) * scanned->count) != 0;
+    if(games != NULL)
+        MEMFreeToDefaultHeap(games);
+
+    games = scanned;
+    if(changed)
+    {
+        void *buffer = MEMAllocFromDefaultHeapEx(FS_ALIGN(GAMES_FILE_MAX), 0x40);
+        if(buffer != NULL)
+        {
+            saveFile(GAMES_INDEX_PATH, buffer, gamesSerialize(games, buffer));
+            MEMFreeToDefaultHeap(buffer);
+        }
     }
+}
 
-    // Apply unchangeable (Wii U specific) things, copied from https://github.com/FIX94/Nintendont/blob/master/kernel/Config.c
-    cfg->MaxPads = 0; // Wii U mode
-    cfg-> Config &= ~(NIN_CFG_DEBUGGER | NIN_CFG_DEBUGWAIT | NIN_CFG_LED); // Disables debugging and the drive access LED
+static void loadGames()
+{
+    recoverFile(GAMES_INDEX_PATH);
+    if(fileExists(GAMES_INDEX_PATH))
+    {
+        void *buffer;
+        size_t size = readFile(GAMES_INDEX_PATH, &buffer);
+        if(buffer != NULL)
+        {
+            games = MEMAllocFromDefaultHeapEx(sizeof(GAMES), 0x40);
+            if(games != NULL && !gamesLoad(games, buffer, size))
+                OSReport("Nincfg: ignoring broken " GAMES_INDEX_PATH "\n");
 
-    // Disable cheats
-    cfg->Config &= ~(NIN_CFG_CHEATS);
-    OSBlockSet(cfg->CheatPath, 0, sizeof(char) * 255);
+            MEMFreeToDefaultHeap(buffer);
+        }
+    }
 
-    // Disable autoboot
-    cfg->Config &= ~(NIN_CFG_AUTO_BOOT);
-    OSBlockSet(cfg->GamePath, 0, sizeof(char) * 255);
-    cfg->GameID = 0;
+    scanGames(false);
+}
 
-    // Make sure widescreen is enabled correctly
-    if(cfg->Config & (NIN_CFG_FORCE_WIDE | NIN_CFG_WIIU_WIDE))
-        cfg->Config |= NIN_CFG_FORCE_WIDE | NIN_CFG_WIIU_WIDE;
+static void loadProfiles()
+{
+    recoverFile(PROFILES_PATH);
+    if(!fileExists(PROFILES_PATH))
+        return; // No profiles, edit nincfg.bin only
 
-    // Transform NIN_LAN_AUTO to enum compatible format
-    if(cfg->Language == NIN_LAN_AUTO)
-        cfg->Language = NIN_LAN_LAST;
+    profileStoreSize = readFile(PROFILES_PATH, &profileStore);
+    if(profileStore != NULL && !profilesCheck(profileStore, profileStoreSize))
+    {
+        logPrint("Ignoring broken " PROFILES_PATH);
+        MEMFreeToDefaultHeap(profileStore);
+        profileStore = NULL;
+    }
+}
 
-    // Disable MC multi in case of no memcard emulation
-    if((cfg->Config & NIN_CFG_MC_MULTI) && !(cfg->Config & NIN_CFG_MEMCARDEMU))
-        cfg->Config &= ~(NIN_CFG_MC_MULTI);
+// Adds a profile for gameID, starting from nincfg.bin. Returns its position or PROFILE_EXIT if out of memory.
+static int32_t createProfile(uint32_t gameID)
+{
+    size_t size = profilesStoreSize((profileStore == NULL ? 0 : profilesCount(profileStore)) + 1);
+    void *store = MEMAllocFromDefaultHeapEx(FS_ALIGN(size), 0x40);
+    if(store == NULL)
+    {
+        logPrint("EOM!");
+        error = true;
+        return PROFILE_EXIT;
+    }
 
-    // Set sane defaults for things not fitting on the screen
-    cfg->Config &= ~(NIN_CFG_OSREPORT | NIN_CFG_LOG | NIN_CFG_USB | NIN_CFG_BBA_EMU);
+    profilesPut(profileStore, store, gameID, &loadedCfg);
+    if(profileStore != NULL)
+        MEMFreeToDefaultHeap(profileStore);
 
-    // Things not used on the Wii U
-    cfg->Config &= ~(NIN_CFG_NATIVE_SI);
-    cfg->NetworkProfile = 0;
+    profileStore = store;
+    profileStoreSize = size;
+    return profilesFind(store, gameID);
+}
 
-    // Fix progressive setting
-    if(cfg->Config & NIN_CFG_FORCE_PROG)
-        cfg->VideoMode &= ~(NIN_VID_PROG);
-    else
-        cfg->VideoMode |= NIN_VID_PROG;
+// Games without a profile, disc 2 shares the profile of disc 1
+static uint32_t listNewGames(uint16_t *newGames)
+{
+    uint32_t count = 0;
+    for(uint32_t i = 0; games != NULL && i < games->count; ++i)
+    {
+        const GAME *game = games->games + i;
+        if(game->disc == 0 && (profileStore == NULL || profilesFind(profileStore, game->gameID) < 0))
+            newGames[count++] = i;
+    }
+
+    return count;
+}
 
-    // Fix video mode
-    if(cfg->VideoMode & (NIN_VID_FORCE | NIN_VID_FORCE_DF) == (NIN_VID_FORCE | NIN_VID_FORCE_DF))
-        cfg->VideoMode &= ~(NIN_VID_FORCE);
+// Returns the position of the profile in the store, PROFILE_DEFAULT for nincfg.bin or PROFILE_EXIT.
+// Picking a game without a profile creates one, which sets created.
+static int32_t selectProfile(bool *created)
+{
+    uint16_t newGames[GAMES_MAX];
+    uint32_t profiles = profileStore == NULL ? 0 : profilesCount(profileStore);
+    uint32_t entries = 1 + profiles + listNewGames(newGames); // + nincfg.bin
+    uint32_t cursor = 0;
+    uint32_t triggers[VPAD_SAMPLES];
+    uint32_t count = 0;
+    bool redraw = true;
+    char id[9];
+
+    *created = false;
+    screenClear(&screen);
+    screenSetLine(&screen, 0, "Select the profile to edit or a game to create one for:");
+    screenSetLine(&screen, MAX_LINES - 1, "Press (A) to select, (Y) to rescan games, (-) or (HOME) to exit");
 
     while(1)
     {
+        count = 0;
         switch(ProcUIProcessMessages(true))
         {
             case PROCUI_STATUS_EXITING:
-                return;
+                return PROFILE_EXIT;
             case PROCUI_STATUS_RELEASE_FOREGROUND:
                 ProcUIDrawDoneRelease();
                 goto nextRound;
+            case PROCUI_STATUS_IN_FOREGROUND:
+            case PROCUI_STATUS_IN_BACKGROUND:
+                break;
         }
 
-        buttons = readInput();
-        if(buttons & VPAD_BUTTON_PLUS)
+        count = readInput(triggers);
+        for(uint32_t t = 0; t < count; ++t)
         {
-            if(cfg->Language == NIN_LAN_LAST)
-                cfg->Language = NIN_LAN_AUTO;
+            uint32_t buttons = triggers[t];
+            if(buttons & VPAD_BUTTON_A)
+            {
+                if(cursor <= profiles)
+                    return (int32_t)cursor - 1;
 
-            writeFile(NINCFG_PATH, cfg, sizeof(NIN_CFG));
-            homeCallback(NULL);
-            goto nextRound;
-        }
-        else if(buttons & VPAD_BUTTON_MINUS)
-        {
-            homeCallback(NULL);
-            goto nextRound;
-        }
-        else if(buttons & VPAD_BUTTON_DOWN)
-        {
-            if(++cursor == 13)
+                *created = true;
+                return createProfile(games->games[newGames[cursor - profiles - 1]].gameID);
+            }
+            else if(buttons & VPAD_BUTTON_Y)
+            {
+                screenSetLine(&screen, MAX_LINES - 1, "Scanning " SD_PATH GAMES_DIR "...");
+                drawScreen();
+                scanGames(true);
+                entries = 1 + profiles + listNewGames(newGames);
                 cursor = 0;
+                screenPrintf(&screen, MAX_LINES - 1, "Found %u games. Press (A) to select, (-) or (HOME) to exit",
+                             games == NULL ? 0 : games->count);
+                redraw = true;
+            }
+            else if(buttons & VPAD_BUTTON_MINUS)
+            {
+                homeCallback(NULL);
+                goto nextRound;
+            }
+            else if(buttons & VPAD_BUTTON_DOWN)
+            {
+                if(++cursor == entries)
+                    cursor = 0;
+
+                redraw = true;
+            }
+            else if(buttons & VPAD_BUTTON_UP)
+            {
+                if(--cursor == (uint32_t)-1)
+                    cursor = entries - 1;
 
-            redraw = true;
+                redraw = true;
+            }
         }
-        else if(buttons & VPAD_BUTTON_UP)
+
+        if(redraw)
         {
-            if(--cursor == (uint32_t)-1)
-                cursor = 12;
+            redraw = false;
 
-            redraw = true;
+            // Scroll so the cursor stays visible
+            uint32_t first = cursor < PROFILE_LINES ? 0 : cursor - PROFILE_LINES + 1;
+            for(uint32_t i = first, row = 2; row < PROFILE_LINES + 2; ++i, ++row)
+            {
+                const char *arrow = cursor == i ? "->" : "  ";
+                if(i >= entries)
+                    screenSetLine(&screen, row, "");
+                else if(i == 0)
+                    screenPrintf(&screen, row, "%s Default (nincfg.bin)", arrow);
+                else if(i <= profiles)
+                {
+                    uint32_t gameID = profilesGameID(profileStore, i - 1);
+                    int32_t game = games == NULL ? -1 : gamesFind(games, gameID);
+                    profilesFormatID(gameID, id);
+                    screenPrintf(&screen, row, "%s %-4s %s", arrow, id, game < 0 ? "" : games->games[game].title);
+                }
+                else
+                {
+                    const GAME *game = games->games + newGames[i - profiles - 1];
+                    profilesFormatID(game->gameID, id);
+                    screenPrintf(&screen, row, "%s %-4s %s (new profile)", arrow, id, game->title);
+                }
+            }
         }
-        else if(buttons & (VPAD_BUTTON_RIGHT | VPAD_BUTTON_LEFT))
+
+        // Also after getting the foreground back, the framebuffers are blank then
+        drawScreen();
+
+nextRound:
+        waitForFrame(count != 0);
+    }
+}
+
+static void initSettingRows()
+{
+    settingsInit();
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+        snprintf(settingRows[i], SCREEN_LINE_LENGTH, "   %-*s<", LABEL_WIDTH, settings[i].label);
+}
+
+// Copies the value from the settings string pool into the prebuilt row, no formatting involved
+static void drawSetting(const NIN_CFG *cfg, uint32_t i, uint32_t cursor)
+{
+    char *row = settingRows[i];
+    char value[SETTING_VALUE_SIZE];
+    size_t len;
+    const char *text = settingText(cfg, i, &len);
+    if(text == NULL) // E.g. "Invalid"
+    {
+        settingFormat(cfg, i, value);
+        text = value;
+        len = strlen(value);
+    }
+
+    memcpy(row, cursor == i ? "->" : "  ", 2);
+    memcpy(row + VALUE_COLUMN, text, len);
+    row[VALUE_COLUMN + len] = '>';
+    row[VALUE_COLUMN + len + 1] = '\0';
+    screenSetLine(&screen, i, row);
+}
+
+// Checks if others wrote to nincfg.bin since it got loaded, each RELOAD_POLL or right away if forced. If so, it
+// gets read again and merged with the edits made in the UI since (see settingsMerge()). Only the rows that
+// changed get redrawn. Files which can't be loaded are skipped, the next poll tries again.
+static void pollConfig(NIN_CFG *cfg, uint32_t cursor, bool force)
+{
+    OSTime now = OSGetSystemTime();
+    if(!force && now - lastPoll < RELOAD_POLL)
+        return;
+
+    lastPoll = now;
+    FSStat stat;
+    if(FSAGetStat(fsaClient, NINCFG_PATH, &stat) != FS_ERROR_OK || (stat.size == loadedStat.size && stat.modified == loadedStat.modified))
+        return;
+
+    NIN_CFG theirs;
+    int32_t read = readConfig(NINCFG_PATH, &reloadBuffer, &stat, NULL);
+    if(read <= 0 || read > (int32_t)sizeof(NIN_CFG) || migrationLoad(&theirs, &reloadBuffer.cfg, read, &migration) != NCFG_OK)
+        return;
+
+    ncfgNormalize(&theirs);
+    NIN_CFG before = *cfg;
+    uint32_t conflicts;
+    uint32_t taken = settingsMerge(cfg, &baseCfg, &theirs, &conflicts);
+    ncfgNormalize(cfg);
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+        if(!settingEqual(&before, cfg, i))
+            drawSetting(cfg, i, cursor);
+
+    OSBlockMove(&baseCfg, &theirs, sizeof(NIN_CFG), false);
+    OSBlockMove(&loadedCfg, &reloadBuffer.cfg, sizeof(NIN_CFG), false);
+    loadedStat = stat;
+
+    // A write which didn't change any option (like a save with the same values) isn't worth a message
+    if(taken | conflicts)
+        screenPrintf(&screen, ROW_INFO, "%s changed: took %u options, kept %u of yours%s", NINCFG_PATH,
+                     __builtin_popcount(taken & ~SETTINGS_MERGE_OTHER), __builtin_popcount(conflicts & ~SETTINGS_MERGE_OTHER),
+                     (conflicts & SETTINGS_MERGE_OTHER) ? " and other data" : "");
+    OSReport("Nincfg: %s changed by someone else, took %08X, conflicts %08X\n", NINCFG_PATH, taken, conflicts);
+}
+
+// Queues everything which changed for saving. Profiles get written to both files.
+static void startSave(const NIN_CFG *cfg, int32_t profile)
+{
+    saveStart = OSGetSystemTime();
+    saveJobs[SAVE_NINCFG].path = saveJobs[SAVE_PROFILES].path = NULL;
+    ncfgSerialize(cfg, &saveCfg);
+    if(profile >= 0)
+    {
+        NIN_CFG *record = profilesRecord(profileStore, profile);
+        OSBlockMove(record, &saveCfg, sizeof(NIN_CFG), false);
+        record->GameID = ncfgBE32(profilesGameID(profileStore, profile));
+        int32_t game = games == NULL ? -1 : gamesFind(games, profilesGameID(profileStore, profile));
+        if(game >= 0)
+            strcpy(record->GamePath, games->games[game].path); // GAMES_PATH_SIZE makes sure it fits
+        if(memcmp(record, &loadedProfile, sizeof(NIN_CFG)) != 0)
+            queueSave(SAVE_PROFILES, PROFILES_PATH, profileStore, profileStoreSize);
+    }
+
+    if(memcmp(&saveCfg, &loadedCfg, sizeof(NIN_CFG)) != 0)
+        queueSave(SAVE_NINCFG, NINCFG_PATH, &saveCfg, sizeof(NIN_CFG));
+    else
+        OSReport("Nincfg: %s unchanged, not saving\n", NINCFG_PATH);
+}
+
+// Shows how the save went. Returns true if everything got saved.
+static bool finishSave(int32_t profile)
+{
+    const SAVE_JOB *failed = NULL;
+    for(uint32_t i = 0; i < 2; ++i)
+    {
+        const SAVE_JOB *job = saveJobs + i;
+        if(job->path == NULL)
+            continue;
+
+        if(job->result != FS_ERROR_OK)
+            failed = job;
+        else if(i == SAVE_NINCFG)
         {
-            uint32_t mask;
+            OSBlockMove(&loadedCfg, &saveCfg, sizeof(NIN_CFG), false);
+            savedConfig();
+        }
+        else
+            OSBlockMove(&loadedProfile, profilesRecord(profileStore, profile), sizeof(NIN_CFG), false);
+    }
 
-            switch(cursor)
-            {
-                case 0:
-                    mask = 0;
-                    if(buttons & VPAD_BUTTON_RIGHT)
-                    {
-                        if(cfg->Config & NIN_CFG_MEMCARDEMU)
-                        {
-                            if(cfg->Config & NIN_CFG_MC_MULTI)
-                                cfg->Config &= ~(NIN_CFG_MEMCARDEMU | NIN_CFG_MC_MULTI);
-                            else
-                                cfg->Config |= NIN_CFG_MC_MULTI;
-                        }
-                        else
-                            cfg->Config |= NIN_CFG_MEMCARDEMU;
-                    }
-                    else
-                    {
-                        if(cfg->Config & NIN_CFG_MEMCARDEMU)
-                        {
-                            if(cfg->Config & NIN_CFG_MC_MULTI)
-                                cfg->Config &= ~(NIN_CFG_MC_MULTI);
-                            else
-                                cfg->Config &= ~(NIN_CFG_MEMCARDEMU | NIN_CFG_MC_MULTI);
-                        }
-                        else
-                            cfg->Config |= NIN_CFG_MEMCARDEMU | NIN_CFG_MC_MULTI;
-                    }
+    if(failed != NULL)
+    {
+        screenPrintf(&screen, ROW_INFO, "Error saving %s: %s", failed->path, FSAGetStatusStr(failed->result));
+        return false;
+    }
 
-                    break;
-                case 1:
-                    mask = 0;
-                    if(buttons & VPAD_BUTTON_RIGHT)
-                    {
-                        if(++cfg->MemCardBlocks == MEM_CARD_MAX + 1)
-                            cfg->MemCardBlocks = 0;
-                    }
-                    else
-                    {
-                        if(--cfg->MemCardBlocks == (unsigned char)-1)
-                            cfg->MemCardBlocks = MEM_CARD_MAX;
-                    }
-                    break;
-                case 2:
-                    mask = NIN_CFG_FORCE_WIDE | NIN_CFG_WIIU_WIDE;
-                    break;
-                case 3:
-                    mask = NIN_CFG_FORCE_PROG;
-                    if(cfg->Config & NIN_CFG_FORCE_PROG)
-                        cfg->VideoMode &= ~(NIN_VID_PROG);
-                    else
-                        cfg->VideoMode |= NIN_VID_PROG;
-
-                    break;
-                case 4:
-                    mask = NIN_CFG_REMLIMIT;
-                    break;
-                case 5:
-                    mask = NIN_CFG_ARCADE_MODE;
-                    break;
-                case 6:
-                    mask = NIN_CFG_CC_RUMBLE;
-                    break;
-                case 7:
-                    mask = NIN_CFG_SKIP_IPL;
-                    break;
-                case 8:
-                    mask = 0;
-                    if(buttons & VPAD_BUTTON_RIGHT)
-                    {
-                        if(++cfg->Language == NIN_LAN_LAST + 1)
-                            cfg->Language = 0;
-                    }
-                    else
-                    {
-                        if(--cfg->Language == (unsigned int)-1)
-                            cfg->Language = NIN_LAN_LAST;
-                    }
+    if(saveJobs[SAVE_NINCFG].path == NULL && saveJobs[SAVE_PROFILES].path == NULL)
+        screenSetLine(&screen, ROW_INFO, "Nothing changed");
+    else
+        screenPrintf(&screen, ROW_INFO, "Saved in %llu ms", OSTicksToMilliseconds(OSGetSystemTime() - saveStart));
 
-                    break;
-                case 9:
-                    mask = 0;
-                    uint32_t vidMask = cfg->VideoMode;
-                    vidMask >>= 16;
+    return true;
+}
 
-                    uint32_t forceMask = cfg->VideoMode & NIN_VID_FORCE_MASK;
+// Runs entry on core (one of the OS_THREAD_ATTRIB_AFFINITY_CPUs) or right away if there is no thread for it
+static void startTask(STARTUP_TASK *task, OSThreadEntryPointFn entry, OSThreadAttributes core, const char *name)
+{
+    task->running = OSCreateThread(&task->thread, entry, 0, NULL, task->stack + TASK_STACK_SIZE, TASK_STACK_SIZE, 16, core);
+    if(task->running)
+    {
+        OSSetThreadName(&task->thread, name);
+        OSResumeThread(&task->thread);
+    }
+    else
+        task->result = entry(0, NULL);
+}
 
-                    if(buttons & VPAD_BUTTON_RIGHT)
-                    {
-                        if(vidMask & (NIN_VID_INDEX_FORCE | NIN_VID_INDEX_FORCE_DF))
-                        {
-                            if(++forceMask == NIN_VID_INDEX_FORCE_MPAL + 1)
-                                goto switchVidMaskRight;
-                        }
-                        else
-                        {
-switchVidMaskRight:
-                            forceMask = NIN_VID_INDEX_FORCE_PAL50;
-                            switch(vidMask)
-                            {
-                                case NIN_VID_INDEX_AUTO:
-                                    vidMask = NIN_VID_INDEX_FORCE;
-                                    break;
-                                case NIN_VID_INDEX_FORCE:
-                                    vidMask = NIN_VID_INDEX_NONE;
-                                    break;
-                                case NIN_VID_INDEX_NONE:
-                                    vidMask = NIN_VID_INDEX_FORCE_DF;
-                                    break;
-                                case NIN_VID_INDEX_FORCE_DF:
-                                    vidMask = NIN_VID_INDEX_AUTO;
-                                    break;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        if(vidMask & (NIN_VID_INDEX_FORCE | NIN_VID_INDEX_FORCE_DF))
-                        {
-                            if(--forceMask == (uint32_t)-1)
-                                goto switchVidMaskLeft;
-                        }
-                        else
-                        {
-switchVidMaskLeft:
-                            forceMask = NIN_VID_INDEX_FORCE_MPAL;
-                            switch(vidMask)
-                            {
-                                case NIN_VID_INDEX_AUTO:
-                                    vidMask = NIN_VID_INDEX_FORCE_DF;
-                                    break;
-                                case NIN_VID_INDEX_FORCE_DF:
-                                    vidMask = NIN_VID_INDEX_NONE;
-                                    break;
-                                case NIN_VID_INDEX_NONE:
-                                    vidMask = NIN_VID_INDEX_FORCE;
-                                    break;
-                                case NIN_VID_INDEX_FORCE:
-                                    vidMask = NIN_VID_INDEX_AUTO;
-                                    break;
-                            }
-                        }
-                    }
+static int finishTask(STARTUP_TASK *task)
+{
+    if(task->running)
+    {
+        OSJoinThread(&task->thread, &task->result);
+        task->running = false;
+    }
 
-                    vidMask <<= 16;
-                    vidMask |= forceMask;
-                    cfg->VideoMode &= ~(NIN_VID_MASK | NIN_VID_FORCE_MASK); // Delete original settings w/o deleting extended settings
-                    cfg->VideoMode |= vidMask; // Set new settings w/o deleting extended settings
+    return task->result;
+}
 
-                    break;
-                case 10:
-                    mask = 0;
+static int mochaTaskMain(int argc, const char **argv)
+{
+    return Mocha_InitLibrary();
+}
 
-                    if(buttons & VPAD_BUTTON_RIGHT)
-                    {
-                        if(cfg->VideoScale == 0)
-                            cfg->VideoScale = 40;
-                        else {
-                            cfg->VideoScale += 2;
-                            if(cfg->VideoScale > 120)
-                                cfg->VideoScale = 0; //auto
-                        }
-                    }
-                    else
-                    {
-                        if(cfg->VideoScale == 0)
-                            cfg->VideoScale = 120;
-                        else {
-                            cfg->VideoScale -= 2;
-                            if(cfg->VideoScale < 40)
-                                cfg->VideoScale = 0; //auto
-                        }
-                    }
+static int consoleTaskMain(int argc, const char **argv)
+{
+    startupTimes.consoleStart = OSGetSystemTime();
+    bool ret = displayInit();
+    startupTimes.console = OSGetSystemTime();
+    return ret;
+}
 
-                    break;
-                case 11:
-                    mask = 0;
+static void startConsole()
+{
+    startTask(&consoleTask, consoleTaskMain, OS_THREAD_ATTRIB_AFFINITY_CPU2, "Nincfg console");
+    consoleStarted = true;
+}
 
-                    if(buttons & VPAD_BUTTON_RIGHT)
-                    {
-                        if(++cfg->VideoOffset == 21)
-                            cfg->VideoOffset = -20;
-                    }
-                    else
-                    {
-                        if(--cfg->VideoOffset == -21)
-                            cfg->VideoOffset = 20;
-                    }
+// Blocks until the console from startConsole() (started here if it wasn't yet) is up
+static void waitForConsole()
+{
+    if(consoleReady)
+        return;
 
-                    break;
-                case 12:
-                    mask = 0;
+    if(!consoleStarted)
+        startConsole();
 
-                    if(buttons & VPAD_BUTTON_RIGHT)
-                    {
-                        if(++cfg->WiiUGamepadSlot == NIN_CFG_MAXPAD + 1)
-                            cfg->WiiUGamepadSlot = 0;
-                    }
-                    else
-                    {
-                        if(--cfg->WiiUGamepadSlot == (unsigned int)-1)
-                            cfg->WiiUGamepadSlot = NIN_CFG_MAXPAD;
-                    }
+    finishTask(&consoleTask);
+    displayAttach();
+    consoleReady = true;
+}
 
-                    break;
-                default:
-                    //TODO
-                    break;
-            }
+void mainLoop()
+{
+    displaySetColor(COLOR_BACKGROUND);
 
-            if(mask)
+    uint32_t buttons;
+    uint32_t cursor = 0;
+    uint32_t triggers[VPAD_SAMPLES];
+    uint32_t count;
+    bool leaving = false;
+    bool saving = false;
+    OSTime readTime;
+
+    nextFrame = lastInput = lastPoll = OSGetSystemTime();
+
+    NIN_CFG *cfg = &cfgBuffer.cfg;
+    recoverFile(NINCFG_PATH);
+    buttons = loadConfig(NINCFG_PATH);
+    if(buttons == sizeof(NIN_CFG))
+        OSBlockMove(&loadedCfg, cfg, sizeof(NIN_CFG), false);
+
+    // Configs from older Nintendont versions get upgraded here and saved in the new format
+    NCFG_STATUS status = migrationLoad(cfg, &loadedCfg, buttons, &migration);
+    startupTimes.validate = OSGetSystemTime();
+    reportStartup();
+    switch(status)
+    {
+        case NCFG_ERROR_SIZE:
+            logPrintf("%u%s vs %zu", buttons, buttons > sizeof(NIN_CFG) ? "+" : "", sizeof(NIN_CFG));
+            error = true;
+            return;
+        case NCFG_ERROR_MAGIC:
+            logPrint("Magic bytes wrong!");
+            error = true;
+            return;
+        case NCFG_ERROR_VERSION:
+            logPrintf("Wrong version (got %u but we support %u to %u only)", cfg->Version, MIGRATION_MIN_VERSION, NIN_CFG_VERSION);
+            error = true;
+            return;
+        case NCFG_OK:
+            break;
+    }
+
+    // Changes pushed to many consoles at once, see patch.h
+    char patchInfo[SCREEN_LINE_LENGTH] = "";
+    applyPatch(cfg, patchInfo);
+
+    // Profiles get edited in place of nincfg.bin and written to both files on save
+    int32_t profile = PROFILE_DEFAULT;
+    char profileName[16] = "";
+    loadProfiles();
+    loadGames();
+
+    // Everything from here on draws
+    waitForConsole();
+    if(profileStore != NULL || (games != NULL && games->count != 0))
+    {
+        bool created;
+        profile = selectProfile(&created);
+        if(profile == PROFILE_EXIT)
+            return;
+
+        if(profile != PROFILE_DEFAULT)
+        {
+            NIN_CFG *record = profilesRecord(profileStore, profile);
+            if(record == NULL || migrationLoad(cfg, record, sizeof(NIN_CFG), &migration) != NCFG_OK)
             {
-                if(cfg->Config & mask)
-                    cfg->Config &= ~(mask);
-                else
-                    cfg->Config |= mask;
+                logPrint("Broken profile!");
+                error = true;
+                return;
             }
 
-            redraw = true;
+            // A new profile isn't on the SD card yet, so it gets saved even without edits
+            if(created)
+                OSBlockSet(&loadedProfile, 0, sizeof(NIN_CFG));
+            else
+                OSBlockMove(&loadedProfile, record, sizeof(NIN_CFG), false);
+
+            profileName[0] = ' ';
+            profilesFormatID(profilesGameID(profileStore, profile), profileName + 1);
         }
+    }
 
-        if(redraw)
+    ncfgNormalize(cfg);
+    if(profile == PROFILE_DEFAULT)
+        OSBlockMove(&baseCfg, cfg, sizeof(NIN_CFG), false);
+
+    // Everything gets formatted once here, afterwards only the rows a button press changes
+    initSettingRows();
+    screenClear(&screen);
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+        drawSetting(cfg, i, cursor);
+
+    screenSetLine(&screen, ROW_INFO, patchInfo[0] != '\0' ? patchInfo : settings[cursor].info);
+    screenPrintf(&screen, ROW_HELP, "Press (+) to save%s, (-) or (HOME) to exit", profileName);
+
+    traceInit(&trace, OSTimerClockSpeed, OSGetSystemTime());
+    while(1)
+    {
+        count = 0;
+        ProcUIStatus status = ProcUIProcessMessages(true);
+        readTime = OSGetSystemTime();
+        traceMark(&trace, TRACE_PROCUI, readTime);
+        switch(status)
         {
-            redraw = false;
-            clearScreen();
-
-            WHBLogPrintf("%s Memcard emulation:      <%s>", (cursor == 0  ? "->" : "  "), (cfg->Config & NIN_CFG_MEMCARDEMU) ? ((cfg->Config & NIN_CFG_MC_MULTI) ? "Multi" : "Single") : "Off");
-            WHBLogPrintf("%s Memcard size:           <%s (%u blocks)>", (cursor == 1 ? "->" : "  "), getSizeStr(MEM_CARD_SIZE(cfg->MemCardBlocks)), MEM_CARD_BLOCKS(cfg->MemCardBlocks));
-            WHBLogPrintf("%s Force widescreen:       <%s>", (cursor == 2  ? "->" : "  "), (cfg->Config & NIN_CFG_FORCE_WIDE) ? "On" : "Off"); // Keep in sync with NIN_CFG_WIIU_WIDE
-            WHBLogPrintf("%s Force progressive:      <%s>", (cursor == 3  ? "->" : "  "), (cfg->Config & NIN_CFG_FORCE_PROG) ? "On" : "Off");
-            WHBLogPrintf("%s Remove read limit:      <%s>", (cursor == 4  ? "->" : "  "), (cfg->Config & NIN_CFG_REMLIMIT) ? "On" : "Off");
-            WHBLogPrintf("%s Arcade mode:            <%s>", (cursor == 5  ? "->" : "  "), (cfg->Config & NIN_CFG_ARCADE_MODE) ? "On" : "Off");
-            WHBLogPrintf("%s Wiimote CC rumble:      <%s>", (cursor == 6  ? "->" : "  "), (cfg->Config & NIN_CFG_CC_RUMBLE) ? "On" : "Off");
-            WHBLogPrintf("%s Skip IPL:               <%s>", (cursor == 7  ? "->" : "  "), (cfg->Config & NIN_CFG_SKIP_IPL) ? "On" : "Off");
-            WHBLogPrintf("%s Language:               <%s>", (cursor == 8  ? "->" : "  "), languages[cfg->Language]);
-            WHBLogPrintf("%s Video mode:             <%s>", (cursor == 9  ? "->" : "  "), getVidMode(cfg->VideoMode));
-            WHBLogPrintf("%s Video scale:            <%i>", (cursor == 10 ? "->" : "  "), cfg->VideoScale);
-            WHBLogPrintf("%s Video offset:           <%i>", (cursor == 11 ? "->" : "  "), cfg->VideoOffset);
-            if(cfg->WiiUGamepadSlot < NIN_CFG_MAXPAD)
-                WHBLogPrintf("%s Wii U gamepad slot:     <%i>", (cursor == 12 ? "->" : "  "), cfg->WiiUGamepadSlot + 1);
-            else
-                WHBLogPrintf("%s Wii U gamepad slot:     <None>", (cursor == 12 ? "->" : "  "));
+            case PROCUI_STATUS_EXITING:
+                return;
+            case PROCUI_STATUS_RELEASE_FOREGROUND:
+                ProcUIDrawDoneRelease();
+                goto nextRound;
+            case PROCUI_STATUS_IN_FOREGROUND:
+            case PROCUI_STATUS_IN_BACKGROUND:
+                break;
+        }
+
+        // While saving or once we're on our way out presses only get drained
+        count = readInput(triggers);
+        traceMark(&trace, TRACE_INPUT, OSGetSystemTime());
+        for(uint32_t t = 0; t < count && !leaving && !saving; ++t)
+        {
+            buttons = triggers[t];
+            if((buttons & TRACE_CHORD) == TRACE_CHORD)
+                screenSetLine(&screen, ROW_INFO, dumpTrace() ? "Writing trace to " TRACE_PATH : "Still writing the last trace");
+            else if(buttons & VPAD_BUTTON_PLUS)
+            {
+                // Don't overwrite what others wrote since the last poll
+                if(profile == PROFILE_DEFAULT)
+                    pollConfig(cfg, cursor, true);
+
+                startSave(cfg, profile);
+                screenSetLine(&screen, ROW_INFO, "Saving...");
+                saving = true;
+            }
+            else if(buttons & VPAD_BUTTON_MINUS)
+            {
+                homeCallback(NULL);
+                leaving = true;
+            }
+            else if(buttons & (VPAD_BUTTON_DOWN | VPAD_BUTTON_UP))
+            {
+                uint32_t old = cursor;
+                if(buttons & VPAD_BUTTON_DOWN)
+                {
+                    if(++cursor == SETTINGS_COUNT)
+                        cursor = 0;
+                }
+                else
+                {
+                    if(--cursor == (uint32_t)-1)
+                        cursor = SETTINGS_COUNT - 1;
+                }
 
-            WHBLogPrint("");
-            WHBLogPrint(infoTexts[cursor]);
-            WHBLogPrint("Press (+) to save, (-) or (HOME) to exit");
+                drawSetting(cfg, old, cursor);
+                drawSetting(cfg, cursor, cursor);
+                screenSetLine(&screen, ROW_INFO, settings[cursor].info);
+            }
+            else if(buttons & (VPAD_BUTTON_RIGHT | VPAD_BUTTON_LEFT))
+            {
+                settingEdit(cfg, cursor, buttons & VPAD_BUTTON_RIGHT);
+                drawSetting(cfg, cursor, cursor);
+            }
+        }
+        if(profile == PROFILE_DEFAULT && !saving && !leaving)
+            pollConfig(cfg, cursor, false);
+        traceMark(&trace, TRACE_UPDATE, OSGetSystemTime());
 
-            WHBLogConsoleDraw();
+        // Exit only after the data is on the SD card. On errors stay, so the user can retry.
+        if(saving && pollSaves())
+        {
+            saving = false;
+            if(finishSave(profile))
+            {
+                drawScreen();
+                homeCallback(NULL);
+                leaving = true;
+            }
+        }
+        traceMark(&trace, TRACE_SAVE, OSGetSystemTime());
+
+        if((screen.dirty || displayStale()) && !leaving)
+        {
+            drawScreen();
+            if(count)
+                reportLatency(readTime);
         }
+        traceMark(&trace, TRACE_DRAW, OSGetSystemTime());
 
 nextRound:
-        OSSleepTicks(OSMillisecondsToTicks(20));
+        waitForFrame(count != 0);
+        traceMark(&trace, TRACE_SLEEP, OSGetSystemTime());
+        traceCommit(&trace, count);
     }
 }
 
 int main()
 {
+    startupTimes.start = OSGetSystemTime();
     ProcUIInit(OSSavesDone_ReadyToRelease);
     ProcUIRegisterCallback(PROCUI_CALLBACK_HOME_BUTTON_DENIED, homeCallback, NULL, 100);
     OSEnableHomeButtonMenu(false);
-    WHBLogConsoleInit();
     writeBuffer = MEMAllocFromDefaultHeapEx(FS_ALIGN(WRITE_BUFSIZE), 0x40);
     if(writeBuffer != NULL)
     {
+        // Opening libmocha doesn't need the FSA client, so core 0 does that meanwhile
+        startTask(&mochaTask, mochaTaskMain, OS_THREAD_ATTRIB_AFFINITY_CPU0, "Nincfg Mocha");
         FSAInit();
         fsaClient = FSAAddClient(NULL);
+        startupTimes.fsa = OSGetSystemTime();
+        MochaUtilsStatus ret = finishTask(&mochaTask);
+        bool mocha = ret == MOCHA_RESULT_SUCCESS;
         if(fsaClient)
         {
-            MochaUtilsStatus ret = Mocha_InitLibrary();
-            if(ret == MOCHA_RESULT_SUCCESS)
+            if(mocha)
             {
                 ret = Mocha_UnlockFSClientEx(fsaClient);
+                startupTimes.mocha = OSGetSystemTime();
                 if(ret == MOCHA_RESULT_SUCCESS)
-                    mainLoop();
+                {
+                    // The console only comes up if there is no provisioning script. It gets ready on core 2
+                    // while mainLoop() loads the config, which waits for it before drawing.
+                    if(!provision())
+                    {
+                        startConsole();
+                        if(startSaveThread())
+                        {
+                            mainLoop();
+                            stopSaveThread();
+                        }
+                        else
+                        {
+                            logPrint("Error creating save thread!");
+                            error = true;
+                        }
+                    }
+                }
                 else
                 {
-                    WHBLogPrint("Error unlocking FSA client!");
+                    logPrint("Error unlocking FSA client!");
                     error = true;
                 }
-
-                Mocha_DeInitLibrary();
             }
             else
             {
-                WHBLogPrint("Libmocha error!");
+                logPrint("Libmocha error!");
                 error = true;
             }
 
@@ -611,28 +1397,39 @@ int main()
         }
         else
         {
-            WHBLogPrint("No FSA client!");
+            logPrint("No FSA client!");
             error = true;
         }
 
+        if(mocha)
+            Mocha_DeInitLibrary();
+
         FSAShutdown();
         MEMFreeToDefaultHeap(writeBuffer);
+        if(profileStore != NULL)
+            MEMFreeToDefaultHeap(profileStore);
+        if(games != NULL)
+            MEMFreeToDefaultHeap(games);
     }
     else
     {
-        WHBLogPrint("EOM!");
+        logPrint("EOM!");
         error = true;
     }
 
     if(error)
     {
-        WHBLogPrint("");
-        WHBLogPrint("Press HOME to exit");
-        WHBLogConsoleSetColor(COLOR_RED);
-        WHBLogConsoleDraw();
+        waitForConsole();
+        logPrint("");
+        logPrint("Press HOME to exit");
+        displaySetColor(COLOR_RED);
+        drawScreen();
 
         while(ProcUIProcessMessages(true) != PROCUI_STATUS_EXITING)
+        {
+            drawScreen(); // After coming back from the HOME menu
             OSSleepTicks(OSMillisecondsToTicks(1000 / 60));
+        }
     }
 
     return 0;
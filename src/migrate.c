@@ -0,0 +1,148 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <migrate.h>
+
+#include <string.h>
+
+#define FIELD(x) offsetof(NIN_CFG, x), sizeof(((NIN_CFG *)0)->x)
+
+typedef struct
+{
+    uint16_t offset;
+    uint16_t size;
+    uint8_t value;
+} MIGRATION_FIELD;
+
+// The differences between version - 1 and version. Fields and flags introduced by a version get reset when
+// going up (so old garbage doesn't suddenly mean something) and when going down (the old version doesn't know them).
+// Taken from UpdateNincfg() in the Nintendont loader.
+typedef struct
+{
+    uint32_t version;
+    uint32_t size;
+    uint32_t configClear;
+    uint32_t videoClear;
+    MIGRATION_FIELD reset[2];
+} MIGRATION_STEP;
+
+static const MIGRATION_STEP steps[] = {
+    // MemCardBlocks was unused, 2 means the 251 blocks card used before
+    { .version = 3, .size = sizeof(NIN_CFG), .reset = { { FIELD(MemCardBlocks), 2 } } },
+    { .version = 4, .size = sizeof(NIN_CFG), .reset = { { FIELD(VideoScale), 0 }, { FIELD(VideoOffset), 0 } } },
+    // The bit used to be NIN_CFG_HID
+    { .version = 5, .size = sizeof(NIN_CFG), .configClear = NIN_CFG_REMLIMIT },
+    { .version = 6, .size = sizeof(NIN_CFG), .videoClear = NIN_VID_PATCH_PAL50 },
+    { .version = 7, .size = sizeof(NIN_CFG), .configClear = NIN_CFG_ARCADE_MODE },
+    { .version = 8, .size = sizeof(NIN_CFG), .configClear = NIN_CFG_CC_RUMBLE },
+    { .version = 9, .size = sizeof(NIN_CFG), .configClear = NIN_CFG_SKIP_IPL },
+    { .version = 10, .size = sizeof(NIN_CFG), .configClear = NIN_CFG_BBA_EMU, .reset = { { FIELD(NetworkProfile), 0 } } },
+};
+
+#define STEP_COUNT  (sizeof(steps) / sizeof(steps[0]))
+#define MAX_VERSION (MIGRATION_MIN_VERSION + STEP_COUNT)
+
+size_t migrationSize(uint32_t version)
+{
+    if(version < MIGRATION_MIN_VERSION || version > MAX_VERSION)
+        return 0;
+
+    // Version 2 shares the layout of version 3
+    return steps[version == MIGRATION_MIN_VERSION ? 0 : version - MIGRATION_MIN_VERSION - 1].size;
+}
+
+static void resetField(MIGRATION *migration, const MIGRATION_FIELD *field)
+{
+    for(uint16_t i = 0; i < field->size; ++i)
+    {
+        migration->source[field->offset + i] = -1;
+        migration->value[field->offset + i] = field->value;
+    }
+}
+
+static void setConstant(MIGRATION *migration, size_t offset, uint32_t value)
+{
+    value = ncfgBE32(value);
+    memcpy(migration->value + offset, &value, sizeof(uint32_t));
+    for(size_t i = 0; i < sizeof(uint32_t); ++i)
+        migration->source[offset + i] = -1;
+}
+
+bool migrationBuild(MIGRATION *migration, uint32_t from, uint32_t to)
+{
+    if(migrationSize(from) == 0 || migrationSize(to) == 0)
+        return false;
+
+    migration->from = from;
+    migration->to = to;
+    migration->fromSize = migrationSize(from);
+    migration->toSize = migrationSize(to);
+    migration->configMask = migration->videoMask = 0xFFFFFFFF;
+    for(size_t i = 0; i < MIGRATION_MAX_SIZE; ++i)
+    {
+        migration->source[i] = i < migration->fromSize ? (int16_t)i : -1;
+        migration->value[i] = 0;
+    }
+
+    // Every step only resets things, so the steps compose by stacking them up
+    uint32_t low = from < to ? from : to;
+    uint32_t high = from < to ? to : from;
+    for(uint32_t v = low + 1; v <= high; ++v)
+    {
+        const MIGRATION_STEP *step = steps + (v - MIGRATION_MIN_VERSION - 1);
+        migration->configMask &= ~step->configClear;
+        migration->videoMask &= ~step->videoClear;
+        for(size_t i = 0; i < sizeof(step->reset) / sizeof(step->reset[0]); ++i)
+            if(step->reset[i].size)
+                resetField(migration, step->reset + i);
+    }
+
+    setConstant(migration, offsetof(NIN_CFG, Version), to);
+    return true;
+}
+
+void migrationApply(const MIGRATION *migration, const void *in, void *out)
+{
+    uint8_t tmp[MIGRATION_MAX_SIZE];
+    const uint8_t *src = in;
+    if(in == out)
+    {
+        memcpy(tmp, in, migration->fromSize);
+        src = tmp;
+    }
+
+    uint8_t *dst = out;
+    for(uint32_t i = 0; i < migration->toSize; ++i)
+        dst[i] = migration->source[i] < 0 ? migration->value[i] : src[migration->source[i]];
+
+    NIN_CFG *cfg = out;
+    cfg->Config &= ncfgBE32(migration->configMask);
+    cfg->VideoMode &= ncfgBE32(migration->videoMask);
+}
+
+NCFG_STATUS migrationLoad(NIN_CFG *cfg, const void *data, size_t size, MIGRATION *migration)
+{
+    NCFG_STATUS status = ncfgLoad(cfg, data, size);
+    if(status == NCFG_ERROR_VERSION && migrationBuild(migration, cfg->Version, NIN_CFG_VERSION))
+    {
+        migrationApply(migration, data, cfg);
+        status = ncfgLoad(cfg, cfg, sizeof(NIN_CFG));
+    }
+
+    return status;
+}
@@ -0,0 +1,219 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <ncfg.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#define SKIP(field)
+#define FIELD_SIZE(field) +sizeof(((NIN_CFG *)0)->field)
+#define CHECK_WORD(field) \
+    _Static_assert(sizeof(((NIN_CFG *)0)->field) == 4 && offsetof(NIN_CFG, field) % 4 == 0, #field " is no aligned word");
+
+NCFG_LAYOUT(CHECK_WORD, SKIP)
+// Up to 3 bytes padding, so a new field can't go unnoticed
+_Static_assert(0 NCFG_LAYOUT(FIELD_SIZE, FIELD_SIZE) + 4 > sizeof(NIN_CFG), "NCFG_LAYOUT misses fields");
+
+#define SWAP_WORD(field) cfg->field = __builtin_bswap32(cfg->field);
+
+void ncfgByteSwap(NIN_CFG *cfg)
+{
+    NCFG_LAYOUT(SWAP_WORD, SKIP)
+}
+
+// nincfg.bin is big endian as that's what the PowerPC sees
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define swapCfg(cfg) ncfgByteSwap(cfg)
+
+// Swapping moves byte i of a config to i ^ swapDelta[i]. WORDs are aligned, so that's 3 for their bytes.
+#define DELTA_WORD(field)                                                                   \
+    [offsetof(NIN_CFG, field)] = 3, [offsetof(NIN_CFG, field) + 1] = 3,                     \
+    [offsetof(NIN_CFG, field) + 2] = 3, [offsetof(NIN_CFG, field) + 3] = 3,
+
+static const uint8_t swapDelta[sizeof(NIN_CFG)] = { NCFG_LAYOUT(DELTA_WORD, SKIP) };
+
+#define SWAP_LANES      16
+#define SWAP_MAX_CHUNKS (sizeof(NIN_CFG) / SWAP_LANES + 1)
+#define SWAP_BLOCK      32 // 17.5 KB of configs
+
+typedef uint8_t SWAP_VECTOR __attribute__((vector_size(SWAP_LANES)));
+
+#define OFFSET_WORD(field) offsetof(NIN_CFG, field),
+
+static const uint16_t wordOffsets[] = { NCFG_LAYOUT(OFFSET_WORD, SKIP) };
+
+// Covers all WORDs with as few non-overlapping SWAP_LANES byte chunks as possible, each with the shuffle
+// mask doing its swaps. Chunks start at WORD offsets, so they never split one. Returns 0 if the layout
+// doesn't allow that.
+static uint32_t swapChunks(uint32_t *offsets, SWAP_VECTOR *masks)
+{
+    uint32_t chunks = 0;
+    uint32_t next = 0;
+    for(uint32_t w = 0; w < sizeof(wordOffsets) / sizeof(wordOffsets[0]); ++w)
+    {
+        uint32_t start = wordOffsets[w];
+        if(start < next)
+            continue;
+
+        if(start + SWAP_LANES > sizeof(NIN_CFG))
+            start = sizeof(NIN_CFG) - SWAP_LANES;
+        if(start < next || start % 4 != 0)
+            return 0;
+
+        offsets[chunks] = start;
+        for(uint32_t i = 0; i < SWAP_LANES; ++i)
+            masks[chunks][i] = i ^ swapDelta[start + i];
+
+        ++chunks;
+        next = start + SWAP_LANES;
+    }
+
+    return chunks;
+}
+
+// __builtin_shuffle() becomes a single pshufb with SSSE3 (or tbl on ARM)
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target_clones("ssse3", "default")))
+#endif
+void ncfgSwapBatch(NIN_CFG *cfgs, size_t count)
+{
+    uint32_t offsets[SWAP_MAX_CHUNKS];
+    SWAP_VECTOR masks[SWAP_MAX_CHUNKS];
+    uint32_t chunks = swapChunks(offsets, masks);
+    if(chunks == 0)
+    {
+        for(size_t i = 0; i < count; ++i)
+            ncfgByteSwap(cfgs + i);
+
+        return;
+    }
+
+    // Chunk by chunk over blocks of configs which stay in the L1 cache, so the mask stays in a register
+    for(size_t block = 0; block < count; block += SWAP_BLOCK)
+    {
+        size_t end = count - block > SWAP_BLOCK ? block + SWAP_BLOCK : count;
+        for(uint32_t c = 0; c < chunks; ++c)
+        {
+            SWAP_VECTOR mask = masks[c];
+            uint8_t *p = (uint8_t *)(cfgs + block) + offsets[c];
+            for(size_t i = block; i < end; ++i, p += sizeof(NIN_CFG))
+            {
+                SWAP_VECTOR v;
+                memcpy(&v, p, SWAP_LANES);
+                v = __builtin_shuffle(v, mask);
+                memcpy(p, &v, SWAP_LANES);
+            }
+        }
+    }
+}
+#else
+#define swapCfg(cfg)
+#endif
+
+NCFG_STATUS ncfgLoad(NIN_CFG *cfg, const void *data, size_t size)
+{
+    if(size != sizeof(NIN_CFG))
+        return NCFG_ERROR_SIZE;
+
+    if(data != cfg)
+        memmove(cfg, data, sizeof(NIN_CFG));
+
+    swapCfg(cfg);
+
+    if(cfg->Magicbytes != NCFG_MAGIC)
+        return NCFG_ERROR_MAGIC;
+
+    if(cfg->Version != NIN_CFG_VERSION)
+        return NCFG_ERROR_VERSION;
+
+    return NCFG_OK;
+}
+
+void ncfgNormalize(NIN_CFG *cfg)
+{
+    // Apply unchangeable (Wii U specific) things, copied from https://github.com/FIX94/Nintendont/blob/master/kernel/Config.c
+    cfg->MaxPads = 0; // Wii U mode
+    cfg->Config &= ~(NIN_CFG_DEBUGGER | NIN_CFG_DEBUGWAIT | NIN_CFG_LED); // Disables debugging and the drive access LED
+
+    // Disable cheats
+    cfg->Config &= ~(NIN_CFG_CHEATS);
+    memset(cfg->CheatPath, 0, sizeof(char) * 255);
+
+    // Disable autoboot
+    cfg->Config &= ~(NIN_CFG_AUTO_BOOT);
+    memset(cfg->GamePath, 0, sizeof(char) * 255);
+    cfg->GameID = 0;
+
+    // Make sure widescreen is enabled correctly
+    if(cfg->Config & (NIN_CFG_FORCE_WIDE | NIN_CFG_WIIU_WIDE))
+        cfg->Config |= NIN_CFG_FORCE_WIDE | NIN_CFG_WIIU_WIDE;
+
+    // Transform NIN_LAN_AUTO to enum compatible format
+    if(cfg->Language == NIN_LAN_AUTO)
+        cfg->Language = NIN_LAN_LAST;
+
+    // Disable MC multi in case of no memcard emulation
+    if((cfg->Config & NIN_CFG_MC_MULTI) && !(cfg->Config & NIN_CFG_MEMCARDEMU))
+        cfg->Config &= ~(NIN_CFG_MC_MULTI);
+
+    // Set sane defaults for things not fitting on the screen
+    cfg->Config &= ~(NIN_CFG_OSREPORT | NIN_CFG_LOG | NIN_CFG_USB | NIN_CFG_BBA_EMU);
+
+    // Things not used on the Wii U
+    cfg->Config &= ~(NIN_CFG_NATIVE_SI);
+    cfg->NetworkProfile = 0;
+
+    // Fix progressive setting
+    if(cfg->Config & NIN_CFG_FORCE_PROG)
+        cfg->VideoMode &= ~(NIN_VID_PROG);
+    else
+        cfg->VideoMode |= NIN_VID_PROG;
+
+    // Fix video mode, force and force with deflicker at once is the latter
+    if((cfg->VideoMode & (NIN_VID_FORCE | NIN_VID_FORCE_DF)) == (NIN_VID_FORCE | NIN_VID_FORCE_DF))
+        cfg->VideoMode &= ~(NIN_VID_FORCE);
+}
+
+void ncfgSerialize(const NIN_CFG *cfg, NIN_CFG *out)
+{
+    if(out != cfg)
+        memcpy(out, cfg, sizeof(NIN_CFG));
+
+    if(out->Language == NIN_LAN_LAST)
+        out->Language = NIN_LAN_AUTO;
+
+    swapCfg(out);
+}
+
+const char *ncfgStatusStr(NCFG_STATUS status)
+{
+    switch(status)
+    {
+        case NCFG_OK:
+            return "OK";
+        case NCFG_ERROR_SIZE:
+            return "Wrong size";
+        case NCFG_ERROR_MAGIC:
+            return "Magic bytes wrong";
+        case NCFG_ERROR_VERSION:
+            return "Wrong version";
+    }
+
+    return "Unknown error";
+}
@@ -0,0 +1,245 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <patch.h>
+
+#include <string.h>
+
+#define FIELD(x)    offsetof(NIN_CFG, x), sizeof(((NIN_CFG *)0)->x)
+#define HEADER_SIZE offsetof(PATCH, entries)
+#define WHOLE       { 0xFFFFFFFF }
+
+typedef struct
+{
+    const char *name;
+    uint16_t offset;
+    uint16_t size;
+    // Bits which only mean something together and get patched as a unit. Bits outside are independent flags.
+    uint32_t groups[2];
+} PATCH_FIELD_INFO;
+
+static const PATCH_FIELD_INFO fields[PATCH_FIELD_COUNT] = {
+    [PATCH_FIELD_CONFIG] = { "Config", FIELD(Config) },
+    // The video mode index and the forced mode are enums, the rest (like NIN_VID_PROG) flags
+    [PATCH_FIELD_VIDEO_MODE] = { "VideoMode", FIELD(VideoMode), { NIN_VID_MASK, NIN_VID_FORCE_MASK } },
+    [PATCH_FIELD_LANGUAGE] = { "Language", FIELD(Language), WHOLE },
+    [PATCH_FIELD_GAME_PATH] = { "GamePath", FIELD(GamePath), WHOLE },
+    [PATCH_FIELD_CHEAT_PATH] = { "CheatPath", FIELD(CheatPath), WHOLE },
+    [PATCH_FIELD_MAX_PADS] = { "MaxPads", FIELD(MaxPads), WHOLE },
+    [PATCH_FIELD_GAME_ID] = { "GameID", FIELD(GameID), WHOLE },
+    [PATCH_FIELD_MEMCARD_BLOCKS] = { "MemCardBlocks", FIELD(MemCardBlocks), WHOLE },
+    [PATCH_FIELD_VIDEO_SCALE] = { "VideoScale", FIELD(VideoScale), WHOLE },
+    [PATCH_FIELD_VIDEO_OFFSET] = { "VideoOffset", FIELD(VideoOffset), WHOLE },
+    [PATCH_FIELD_NETWORK_PROFILE] = { "NetworkProfile", FIELD(NetworkProfile), WHOLE },
+    [PATCH_FIELD_GAMEPAD_SLOT] = { "WiiUGamepadSlot", FIELD(WiiUGamepadSlot), WHOLE },
+};
+
+static inline uint32_t wordCount(const PATCH_FIELD_INFO *field)
+{
+    return (field->size + 3) / 4;
+}
+
+static inline uint32_t wordBytes(const PATCH_FIELD_INFO *field, uint32_t word)
+{
+    uint32_t bytes = field->size - word * 4;
+    return bytes < 4 ? bytes : 4;
+}
+
+static inline uint32_t wordMask(const PATCH_FIELD_INFO *field, uint32_t word)
+{
+    uint32_t bytes = wordBytes(field, word);
+    return bytes == 4 ? 0xFFFFFFFF : (1u << (bytes * 8)) - 1;
+}
+
+// 32 bit fields are used as they are, everything else byte by byte
+static uint32_t readWord(const NIN_CFG *cfg, const PATCH_FIELD_INFO *field, uint32_t word)
+{
+    const uint8_t *data = (const uint8_t *)cfg + field->offset;
+    if(field->size == sizeof(uint32_t))
+        return *(const uint32_t *)data;
+
+    data += word * 4;
+    uint32_t bytes = wordBytes(field, word);
+    uint32_t value = 0;
+    if(bytes == 4)
+    {
+        memcpy(&value, data, sizeof(uint32_t));
+        return ncfgBE32(value);
+    }
+
+    for(uint32_t i = 0; i < bytes; ++i)
+        value = (value << 8) | data[i];
+
+    return value;
+}
+
+static void writeWord(NIN_CFG *cfg, const PATCH_FIELD_INFO *field, uint32_t word, uint32_t value)
+{
+    uint8_t *data = (uint8_t *)cfg + field->offset;
+    if(field->size == sizeof(uint32_t))
+    {
+        *(uint32_t *)data = value;
+        return;
+    }
+
+    data += word * 4;
+    uint32_t bytes = wordBytes(field, word);
+    if(bytes == 4)
+    {
+        value = ncfgBE32(value);
+        memcpy(data, &value, sizeof(uint32_t));
+        return;
+    }
+
+    for(uint32_t i = bytes; i > 0; --i, value >>= 8)
+        data[i - 1] = value;
+}
+
+uint32_t patchDiff(PATCH *patch, const NIN_CFG *from, const NIN_CFG *to)
+{
+    patch->magic = PATCH_MAGIC;
+    patch->version = NIN_CFG_VERSION;
+    patch->count = 0;
+
+    for(uint32_t f = 0; f < PATCH_FIELD_COUNT; ++f)
+    {
+        const PATCH_FIELD_INFO *field = fields + f;
+        if(memcmp((const uint8_t *)from + field->offset, (const uint8_t *)to + field->offset, field->size) == 0)
+            continue;
+
+        for(uint32_t w = 0; w < wordCount(field); ++w)
+        {
+            uint32_t value = readWord(to, field, w);
+            uint32_t mask = readWord(from, field, w) ^ value;
+            if(mask == 0)
+                continue;
+
+            for(uint32_t g = 0; g < sizeof(field->groups) / sizeof(field->groups[0]); ++g)
+                if(mask & field->groups[g])
+                    mask |= field->groups[g];
+
+            mask &= wordMask(field, w);
+
+            PATCH_ENTRY *entry = patch->entries + patch->count++;
+            entry->field = f;
+            entry->word = w;
+            entry->reserved = 0;
+            entry->mask = mask;
+            entry->value = value & mask;
+        }
+    }
+
+    return patch->count;
+}
+
+void patchApply(const PATCH *patch, NIN_CFG *cfg)
+{
+    for(uint32_t i = 0; i < patch->count; ++i)
+    {
+        const PATCH_ENTRY *entry = patch->entries + i;
+        const PATCH_FIELD_INFO *field = fields + entry->field;
+        writeWord(cfg, field, entry->word, (readWord(cfg, field, entry->word) & ~entry->mask) | entry->value);
+    }
+}
+
+size_t patchSize(const PATCH *patch)
+{
+    return HEADER_SIZE + patch->count * sizeof(PATCH_ENTRY);
+}
+
+// reserved needs no swapping as it has to be 0
+static void swapEntries(PATCH_ENTRY *entries, uint32_t count)
+{
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        entries[i].mask = ncfgBE32(entries[i].mask);
+        entries[i].value = ncfgBE32(entries[i].value);
+    }
+#endif
+}
+
+PATCH_STATUS patchLoad(PATCH *patch, const void *data, size_t size)
+{
+    if(size < HEADER_SIZE || size > sizeof(PATCH) || (size - HEADER_SIZE) % sizeof(PATCH_ENTRY) != 0)
+        return PATCH_ERROR_SIZE;
+
+    if(data != patch)
+        memmove(patch, data, size);
+
+    patch->magic = ncfgBE32(patch->magic);
+    patch->version = ncfgBE32(patch->version);
+    patch->count = ncfgBE32(patch->count);
+
+    if(patch->magic != PATCH_MAGIC)
+        return PATCH_ERROR_MAGIC;
+
+    if(patch->version != NIN_CFG_VERSION)
+        return PATCH_ERROR_VERSION;
+
+    if(patch->count != (size - HEADER_SIZE) / sizeof(PATCH_ENTRY))
+        return PATCH_ERROR_SIZE;
+
+    swapEntries(patch->entries, patch->count);
+
+    // patchApply() trusts every entry, so nothing may point outside of its field
+    for(uint32_t i = 0; i < patch->count; ++i)
+    {
+        const PATCH_ENTRY *entry = patch->entries + i;
+        if(entry->field >= PATCH_FIELD_COUNT || entry->word >= wordCount(fields + entry->field) || entry->reserved != 0 ||
+           (entry->mask & ~wordMask(fields + entry->field, entry->word)) != 0 || (entry->value & ~entry->mask) != 0)
+            return PATCH_ERROR_ENTRY;
+    }
+
+    return PATCH_OK;
+}
+
+void patchSerialize(const PATCH *patch, PATCH *out)
+{
+    if(out != patch)
+        memcpy(out, patch, patchSize(patch));
+
+    swapEntries(out->entries, out->count);
+    out->magic = ncfgBE32(out->magic);
+    out->version = ncfgBE32(out->version);
+    out->count = ncfgBE32(out->count);
+}
+
+const char *patchFieldName(uint32_t field)
+{
+    return field < PATCH_FIELD_COUNT ? fields[field].name : "Unknown";
+}
+
+const char *patchStatusStr(PATCH_STATUS status)
+{
+    switch(status)
+    {
+        case PATCH_OK:
+            return "OK";
+        case PATCH_ERROR_SIZE:
+            return "Wrong size";
+        case PATCH_ERROR_MAGIC:
+            return "Magic bytes wrong";
+        case PATCH_ERROR_VERSION:
+            return "Wrong version";
+        case PATCH_ERROR_ENTRY:
+            return "Broken entry";
+    }
+
+    return "Unknown error";
+}
@@ -0,0 +1,212 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <profiles.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline const PROFILES_HEADER *getHeader(const void *store)
+{
+    return (const PROFILES_HEADER *)store;
+}
+
+static inline const PROFILES_ENTRY *getIndex(const void *store)
+{
+    return (const PROFILES_ENTRY *)(getHeader(store) + 1);
+}
+
+static inline size_t recordsOffset(uint32_t count)
+{
+    size_t offset = sizeof(PROFILES_HEADER) + sizeof(PROFILES_ENTRY) * count;
+    return (offset + PROFILES_ALIGN - 1) & ~(PROFILES_ALIGN - 1);
+}
+
+bool profilesCheck(const void *store, size_t size)
+{
+    if(size < sizeof(PROFILES_HEADER))
+        return false;
+
+    const PROFILES_HEADER *header = getHeader(store);
+    if(ncfgBE32(header->magic) != PROFILES_MAGIC || ncfgBE32(header->version) != PROFILES_VERSION ||
+       ncfgBE32(header->recordSize) != PROFILES_RECORD_SIZE)
+        return false;
+
+    // 64 bit math so a huge count can't wrap around
+    uint64_t count = ncfgBE32(header->count);
+    uint64_t offset = ncfgBE32(header->recordsOffset);
+    return offset % PROFILES_ALIGN == 0 && offset >= sizeof(PROFILES_HEADER) + sizeof(PROFILES_ENTRY) * count &&
+           offset + PROFILES_RECORD_SIZE * count <= size;
+}
+
+uint32_t profilesCount(const void *store)
+{
+    return ncfgBE32(getHeader(store)->count);
+}
+
+uint32_t profilesGameID(const void *store, uint32_t i)
+{
+    return ncfgBE32(getIndex(store)[i].gameID);
+}
+
+NIN_CFG *profilesRecord(const void *store, uint32_t i)
+{
+    uint32_t record = ncfgBE32(getIndex(store)[i].record);
+    if(record >= profilesCount(store))
+        return NULL;
+
+    return (NIN_CFG *)((uint8_t *)store + ncfgBE32(getHeader(store)->recordsOffset) + PROFILES_RECORD_SIZE * record);
+}
+
+int32_t profilesFind(const void *store, uint32_t gameID)
+{
+    const PROFILES_ENTRY *index = getIndex(store);
+    uint32_t low = 0;
+    uint32_t high = profilesCount(store);
+    while(low < high)
+    {
+        uint32_t mid = low + ((high - low) >> 1);
+        uint32_t id = ncfgBE32(index[mid].gameID);
+        if(id == gameID)
+            return mid;
+
+        if(id < gameID)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    return -1;
+}
+
+size_t profilesStoreSize(uint32_t count)
+{
+    return recordsOffset(count) + PROFILES_RECORD_SIZE * count;
+}
+
+static void writeHeader(void *out, uint32_t count)
+{
+    PROFILES_HEADER *header = (PROFILES_HEADER *)out;
+    memset(out, 0, recordsOffset(count));
+    header->magic = ncfgBE32(PROFILES_MAGIC);
+    header->version = ncfgBE32(PROFILES_VERSION);
+    header->count = ncfgBE32(count);
+    header->recordSize = ncfgBE32(PROFILES_RECORD_SIZE);
+    header->recordsOffset = ncfgBE32(recordsOffset(count));
+}
+
+// Appends entry number i of out. The output is always compacted, records in index order.
+static void writeEntry(void *out, uint32_t count, uint32_t i, uint32_t gameID, const NIN_CFG *raw)
+{
+    PROFILES_ENTRY *entry = (PROFILES_ENTRY *)getIndex(out) + i;
+    entry->gameID = ncfgBE32(gameID);
+    entry->record = ncfgBE32(i);
+
+    // raw is NULL for broken entries, these end up as zeroed records which fail ncfgLoad()
+    uint8_t *record = (uint8_t *)out + recordsOffset(count) + PROFILES_RECORD_SIZE * i;
+    if(raw != NULL)
+    {
+        memcpy(record, raw, sizeof(NIN_CFG));
+        memset(record + sizeof(NIN_CFG), 0, PROFILES_RECORD_SIZE - sizeof(NIN_CFG));
+    }
+    else
+        memset(record, 0, PROFILES_RECORD_SIZE);
+}
+
+size_t profilesPut(const void *store, void *out, uint32_t gameID, const NIN_CFG *raw)
+{
+    uint32_t oldCount = store == NULL ? 0 : profilesCount(store);
+    bool replace = store != NULL && profilesFind(store, gameID) >= 0;
+    uint32_t count = replace ? oldCount : oldCount + 1;
+
+    writeHeader(out, count);
+    uint32_t o = 0;
+    bool done = false;
+    for(uint32_t i = 0; i < oldCount; ++i)
+    {
+        uint32_t id = profilesGameID(store, i);
+        if(!done && id >= gameID)
+        {
+            writeEntry(out, count, o++, gameID, raw);
+            done = true;
+            if(id == gameID)
+                continue;
+        }
+
+        writeEntry(out, count, o++, id, profilesRecord(store, i));
+    }
+
+    if(!done)
+        writeEntry(out, count, o, gameID, raw);
+
+    return profilesStoreSize(count);
+}
+
+size_t profilesRemove(const void *store, void *out, uint32_t gameID)
+{
+    uint32_t oldCount = profilesCount(store);
+    uint32_t count = profilesFind(store, gameID) >= 0 ? oldCount - 1 : oldCount;
+
+    writeHeader(out, count);
+    uint32_t o = 0;
+    for(uint32_t i = 0; i < oldCount; ++i)
+    {
+        uint32_t id = profilesGameID(store, i);
+        if(id != gameID)
+            writeEntry(out, count, o++, id, profilesRecord(store, i));
+    }
+
+    return profilesStoreSize(count);
+}
+
+void profilesFormatID(uint32_t gameID, char *out)
+{
+    for(int i = 0; i < 4; ++i)
+    {
+        char c = gameID >> (24 - i * 8);
+        if(c < '0' || c > 'Z' || (c > '9' && c < 'A'))
+        {
+            snprintf(out, 9, "%08X", gameID);
+            return;
+        }
+
+        out[i] = c;
+    }
+
+    out[4] = '\0';
+}
+
+bool profilesParseID(const char *str, uint32_t *gameID)
+{
+    size_t len = strlen(str);
+    if(len == 4)
+    {
+        *gameID = ((uint32_t)str[0] << 24) | ((uint32_t)str[1] << 16) | ((uint32_t)str[2] << 8) | (uint32_t)str[3];
+        return true;
+    }
+
+    if(len == 8)
+    {
+        char *end;
+        *gameID = strtoul(str, &end, 16);
+        return *end == '\0';
+    }
+
+    return false;
+}
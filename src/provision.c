@@ -0,0 +1,111 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <provision.h>
+#include <settings.h>
+
+#include <stdbool.h>
+#include <string.h>
+
+static inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+PROVISION_STATUS provisionApply(NIN_CFG *cfg, const char *data, size_t size, uint32_t *line, uint32_t *edits)
+{
+    *line = *edits = 0;
+    if(size > PROVISION_MAX_SIZE)
+        return PROVISION_ERROR_SIZE;
+
+    NIN_CFG tmp = *cfg;
+    const char *p = data;
+    const char *end = data + size;
+    while(p < end)
+    {
+        ++*line;
+        const char *eol = memchr(p, '\n', end - p);
+        if(eol == NULL)
+            eol = end;
+
+        while(p < eol && isBlank(*p))
+            ++p;
+
+        const char *lineEnd = eol;
+        while(lineEnd > p && isBlank(lineEnd[-1]))
+            --lineEnd;
+
+        const char *start = p;
+        p = eol + 1;
+        if(start == lineEnd || *start == '#')
+            continue;
+
+        // settingFind() and settingParse() want strings, so both halves get copied out
+        char buffer[PROVISION_MAX_LINE];
+        size_t len = lineEnd - start;
+        if(len >= PROVISION_MAX_LINE)
+            return PROVISION_ERROR_SYNTAX;
+
+        memcpy(buffer, start, len);
+        buffer[len] = '\0';
+
+        char *value = strchr(buffer, '=');
+        if(value == NULL)
+            return PROVISION_ERROR_SYNTAX;
+
+        char *nameEnd = value;
+        while(nameEnd > buffer && isBlank(nameEnd[-1]))
+            --nameEnd;
+        *nameEnd = '\0';
+
+        for(++value; isBlank(*value); ++value)
+            ;
+        if(buffer[0] == '\0' || *value == '\0')
+            return PROVISION_ERROR_SYNTAX;
+
+        int setting = settingFind(buffer);
+        if(setting < 0)
+            return PROVISION_ERROR_SETTING;
+        if(!settingParse(&tmp, setting, value))
+            return PROVISION_ERROR_VALUE;
+
+        ++*edits;
+    }
+
+    *cfg = tmp;
+    return PROVISION_OK;
+}
+
+const char *provisionStatusStr(PROVISION_STATUS status)
+{
+    switch(status)
+    {
+        case PROVISION_OK:
+            return "OK";
+        case PROVISION_ERROR_SIZE:
+            return "Too big";
+        case PROVISION_ERROR_SYNTAX:
+            return "Syntax error";
+        case PROVISION_ERROR_SETTING:
+            return "Unknown setting";
+        case PROVISION_ERROR_VALUE:
+            return "Invalid value";
+    }
+
+    return "Unknown error";
+}
@@ -0,0 +1,118 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <render.h>
+
+#include <string.h>
+
+void renderCaptureAtlas(RENDER_ATLAS *atlas, const uint32_t *pixels, uint32_t pitch, uint32_t background)
+{
+    for(uint32_t g = 0; g < RENDER_GLYPHS; ++g)
+    {
+        const uint32_t *line = pixels + g * RENDER_GLYPH_WIDTH;
+        for(uint32_t y = 0; y < RENDER_GLYPH_HEIGHT; ++y, line += pitch)
+        {
+            uint16_t bits = 0;
+            for(uint32_t x = 0; x < RENDER_GLYPH_WIDTH; ++x)
+                if(line[x] != background)
+                    bits |= 1 << x;
+
+            atlas->rows[g][y] = bits;
+        }
+    }
+}
+
+void renderInvalidate(RENDER_FRAME *frame)
+{
+    frame->valid = false;
+}
+
+static void drawGlyph(RENDER_FRAME *frame, const RENDER_ATLAS *atlas, uint32_t column, uint32_t row, char c,
+                      uint32_t background, uint32_t foreground)
+{
+    uint32_t x0 = column * RENDER_GLYPH_WIDTH;
+    uint32_t y0 = row * RENDER_GLYPH_HEIGHT;
+    uint32_t w = frame->width - x0 < RENDER_GLYPH_WIDTH ? frame->width - x0 : RENDER_GLYPH_WIDTH;
+    uint32_t h = frame->height - y0 < RENDER_GLYPH_HEIGHT ? frame->height - y0 : RENDER_GLYPH_HEIGHT;
+
+    const uint16_t *glyph = atlas->rows[c - RENDER_FIRST_GLYPH];
+    uint32_t *line = frame->pixels + y0 * frame->pitch + x0;
+    for(uint32_t y = 0; y < h; ++y, line += frame->pitch)
+    {
+        uint16_t bits = glyph[y];
+        for(uint32_t x = 0; x < w; ++x)
+            line[x] = (bits >> x) & 1 ? foreground : background;
+    }
+}
+
+uint32_t renderScreen(RENDER_FRAME *frame, const RENDER_ATLAS *atlas, const SCREEN *screen, uint32_t background, uint32_t foreground)
+{
+    uint32_t changed = 0;
+    if(!frame->valid || frame->background != background)
+    {
+        uint32_t *line = frame->pixels;
+        for(uint32_t y = 0; y < frame->height; ++y, line += frame->pitch)
+            for(uint32_t x = 0; x < frame->width; ++x)
+                line[x] = background;
+
+        memset(frame->cells, ' ', sizeof(frame->cells));
+        frame->background = background;
+        frame->valid = true;
+        changed = RENDER_REPAINT;
+    }
+
+    // Cells outside of the frame (the DRC is narrower than the TV) are skipped
+    uint32_t columns = (frame->width + RENDER_GLYPH_WIDTH - 1) / RENDER_GLYPH_WIDTH;
+    uint32_t rows = (frame->height + RENDER_GLYPH_HEIGHT - 1) / RENDER_GLYPH_HEIGHT;
+    if(columns > SCREEN_LINE_LENGTH)
+        columns = SCREEN_LINE_LENGTH;
+    if(rows > SCREEN_LINES)
+        rows = SCREEN_LINES;
+
+    for(uint32_t row = 0; row < rows; ++row)
+    {
+        const char *text = screen->lines[row];
+        char *cells = frame->cells[row];
+        bool end = false;
+        for(uint32_t column = 0; column < columns; ++column)
+        {
+            char c = end ? '\0' : text[column];
+            if(c == '\0')
+            {
+                end = true;
+                c = ' ';
+            }
+            else if(c < RENDER_FIRST_GLYPH || c > '~')
+                c = '?';
+
+            if(cells[column] == c)
+                continue;
+
+            drawGlyph(frame, atlas, column, row, c, background, foreground);
+            cells[column] = c;
+            if(!(changed & (1u << row)))
+            {
+                changed |= 1u << row;
+                frame->first[row] = column;
+            }
+            frame->last[row] = column;
+        }
+    }
+
+    return changed;
+}
@@ -0,0 +1,59 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <screen.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+void screenClear(SCREEN *screen)
+{
+    memset(screen->lines, 0, sizeof(screen->lines));
+    screen->dirty = (uint32_t)((1ull << SCREEN_LINES) - 1);
+}
+
+void screenSetLine(SCREEN *screen, uint32_t row, const char *text)
+{
+    char *line = screen->lines[row];
+    if(strncmp(line, text, SCREEN_LINE_LENGTH - 1) == 0)
+        return;
+
+    strncpy(line, text, SCREEN_LINE_LENGTH - 1);
+    line[SCREEN_LINE_LENGTH - 1] = '\0';
+    screen->dirty |= 1u << row;
+}
+
+void screenPrintf(SCREEN *screen, uint32_t row, const char *format, ...)
+{
+    char line[SCREEN_LINE_LENGTH];
+    va_list va;
+    va_start(va, format);
+    vsnprintf(line, SCREEN_LINE_LENGTH, format, va);
+    va_end(va);
+
+    screenSetLine(screen, row, line);
+}
+
+void screenScroll(SCREEN *screen)
+{
+    for(uint32_t row = 1; row < SCREEN_LINES; ++row)
+        screenSetLine(screen, row - 1, screen->lines[row]);
+
+    screenSetLine(screen, SCREEN_LINES - 1, "");
+}
@@ -0,0 +1,717 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <settings.h>
+#include <ncfg.h>
+#include <CommonConfigStrings.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#define FIELD(x)                                    \
+    .offset = offsetof(NIN_CFG, x),                 \
+    .size = sizeof(((NIN_CFG *)0)->x),              \
+    .sign = ((__typeof__(((NIN_CFG *)0)->x))-1 < 0)
+
+#define VIDEO_SCALE_AUTO 0
+
+// Fixed width rows, pool[poolBase[i] + slot] is value slot of settings[i]. Empty rows aren't cached.
+static char pool[SETTING_POOL_SIZE][SETTING_VALUE_SIZE];
+static uint8_t poolLength[SETTING_POOL_SIZE];
+static uint16_t poolBase[SETTINGS_COUNT];
+static uint32_t poolSettings = 0; // settings[] cached so far
+
+static const char *languages[7] = {
+    "English",
+    "German",
+    "French",
+    "Spanish",
+    "Italian",
+    "Dutch",
+    "Auto",
+};
+
+static int32_t getValue(const SETTING *setting, const NIN_CFG *cfg)
+{
+    const uint8_t *field = (const uint8_t *)cfg + setting->offset;
+    if(setting->size == 1)
+        return setting->sign ? *(const int8_t *)field : *field;
+
+    return *(const int32_t *)field;
+}
+
+static void setValue(const SETTING *setting, NIN_CFG *cfg, int32_t value)
+{
+    uint8_t *field = (uint8_t *)cfg + setting->offset;
+    if(setting->size == 1)
+        *field = (uint8_t)value;
+    else
+        *(int32_t *)field = value;
+}
+
+static bool validAlways(const SETTING *setting, const NIN_CFG *cfg)
+{
+    return true;
+}
+
+static bool validRange(const SETTING *setting, const NIN_CFG *cfg)
+{
+    int32_t value = getValue(setting, cfg);
+    return value >= setting->min && value <= setting->max;
+}
+
+static bool validRangeAuto(const SETTING *setting, const NIN_CFG *cfg)
+{
+    return getValue(setting, cfg) == VIDEO_SCALE_AUTO || validRange(setting, cfg);
+}
+
+static bool validVideoMode(const SETTING *setting, const NIN_CFG *cfg)
+{
+    uint32_t vidMask = cfg->VideoMode >> 16;
+    switch(vidMask)
+    {
+        case NIN_VID_INDEX_AUTO:
+        case NIN_VID_INDEX_NONE:
+            return true;
+        case NIN_VID_INDEX_FORCE:
+        case NIN_VID_INDEX_FORCE_DF:
+            return ncfgForceIndex(cfg->VideoMode) >= 0;
+    }
+
+    return false;
+}
+
+static void editFlag(const SETTING *setting, NIN_CFG *cfg, bool right)
+{
+    if(cfg->Config & setting->mask)
+        cfg->Config &= ~(setting->mask);
+    else
+        cfg->Config |= setting->mask;
+}
+
+// Ranges wrap around to the other end. Out of range values from the file snap back into the range
+// before stepping, as INT32_MAX + step would overflow.
+static void editRange(const SETTING *setting, NIN_CFG *cfg, bool right)
+{
+    int32_t value = getValue(setting, cfg);
+    if(validRange(setting, cfg))
+        value += right ? setting->step : -setting->step;
+    if(value < setting->min || value > setting->max)
+        value = right ? setting->min : setting->max;
+
+    setValue(setting, cfg, value);
+}
+
+// Like editRange() but wraps through "Auto" in between the two ends
+static void editRangeAuto(const SETTING *setting, NIN_CFG *cfg, bool right)
+{
+    int32_t value = getValue(setting, cfg);
+    if(value == VIDEO_SCALE_AUTO)
+        value = right ? setting->min : setting->max;
+    else
+    {
+        if(validRange(setting, cfg))
+            value += right ? setting->step : -setting->step;
+        if(value < setting->min || value > setting->max)
+            value = VIDEO_SCALE_AUTO;
+    }
+
+    setValue(setting, cfg, value);
+}
+
+// Off -> Single -> Multi -> Off
+static void editMemcardEmu(const SETTING *setting, NIN_CFG *cfg, bool right)
+{
+    if(right)
+    {
+        if(cfg->Config & NIN_CFG_MEMCARDEMU)
+        {
+            if(cfg->Config & NIN_CFG_MC_MULTI)
+                cfg->Config &= ~(NIN_CFG_MEMCARDEMU | NIN_CFG_MC_MULTI);
+            else
+                cfg->Config |= NIN_CFG_MC_MULTI;
+        }
+        else
+            cfg->Config |= NIN_CFG_MEMCARDEMU;
+    }
+    else
+    {
+        if(cfg->Config & NIN_CFG_MEMCARDEMU)
+        {
+            if(cfg->Config & NIN_CFG_MC_MULTI)
+                cfg->Config &= ~(NIN_CFG_MC_MULTI);
+            else
+                cfg->Config &= ~(NIN_CFG_MEMCARDEMU | NIN_CFG_MC_MULTI);
+        }
+        else
+            cfg->Config |= NIN_CFG_MEMCARDEMU | NIN_CFG_MC_MULTI;
+    }
+}
+
+static void editProgressive(const SETTING *setting, NIN_CFG *cfg, bool right)
+{
+    if(cfg->Config & NIN_CFG_FORCE_PROG)
+        cfg->VideoMode &= ~(NIN_VID_PROG);
+    else
+        cfg->VideoMode |= NIN_VID_PROG;
+
+    editFlag(setting, cfg, right);
+}
+
+// Video mode transitions, packed as mode index << 4 | force flags. Right walks Auto, Force PAL50 to MPAL, None,
+// Force (deflicker) PAL50 to MPAL and back to Auto, left the other way round. The force flags are one-hot and
+// only count for the two force modes, they're cleared for the others. Invalid modes from the file (no or several
+// force flags) snap back to Auto. This is about having the whole cycle in one place nincfg-bench can check every
+// state of, not about speed: a press costs about the same as with branches.
+#define VID_STATE(mode, force)  ((mode) << 4 | (force))
+#define VID_FORCED(mode)        ((mode) == NIN_VID_INDEX_FORCE || (mode) == NIN_VID_INDEX_FORCE_DF)
+#define VID_ONE_HOT(force)      ((force) != 0 && ((force) & ((force) - 1)) == 0)
+#define VID_VALID(mode, force)  ((mode) == NIN_VID_INDEX_AUTO || (mode) == NIN_VID_INDEX_NONE || \
+                                 (VID_FORCED(mode) && VID_ONE_HOT(force)))
+
+#define VID_RIGHT(mode, force)                                                                          \
+    (!VID_VALID(mode, force)                                ? VID_STATE(NIN_VID_INDEX_AUTO, 0) :        \
+     VID_FORCED(mode) && (force) < NIN_VID_FORCE_MPAL       ? VID_STATE(mode, (force) << 1) :           \
+     (mode) == NIN_VID_INDEX_AUTO  ? VID_STATE(NIN_VID_INDEX_FORCE, NIN_VID_FORCE_PAL50) :              \
+     (mode) == NIN_VID_INDEX_FORCE ? VID_STATE(NIN_VID_INDEX_NONE, 0) :                                 \
+     (mode) == NIN_VID_INDEX_NONE  ? VID_STATE(NIN_VID_INDEX_FORCE_DF, NIN_VID_FORCE_PAL50) :           \
+                                     VID_STATE(NIN_VID_INDEX_AUTO, 0))
+
+#define VID_LEFT(mode, force)                                                                           \
+    (!VID_VALID(mode, force)                                ? VID_STATE(NIN_VID_INDEX_AUTO, 0) :        \
+     VID_FORCED(mode) && (force) > NIN_VID_FORCE_PAL50      ? VID_STATE(mode, (force) >> 1) :           \
+     (mode) == NIN_VID_INDEX_AUTO     ? VID_STATE(NIN_VID_INDEX_FORCE_DF, NIN_VID_FORCE_MPAL) :         \
+     (mode) == NIN_VID_INDEX_FORCE_DF ? VID_STATE(NIN_VID_INDEX_NONE, 0) :                              \
+     (mode) == NIN_VID_INDEX_NONE     ? VID_STATE(NIN_VID_INDEX_FORCE, NIN_VID_FORCE_MPAL) :            \
+                                        VID_STATE(NIN_VID_INDEX_AUTO, 0))
+
+#define VID_ROW(next, mode)                                                                             \
+    { next(mode, 0), next(mode, 1), next(mode, 2), next(mode, 3), next(mode, 4), next(mode, 5),         \
+      next(mode, 6), next(mode, 7), next(mode, 8), next(mode, 9), next(mode, 10), next(mode, 11),       \
+      next(mode, 12), next(mode, 13), next(mode, 14), next(mode, 15) }
+#define VID_TABLE(next) \
+    { VID_ROW(next, 0), VID_ROW(next, 1), VID_ROW(next, 2), VID_ROW(next, 3), \
+      VID_ROW(next, 4), VID_ROW(next, 5), VID_ROW(next, 6), VID_ROW(next, 7) }
+
+// [right][mode index][force flags], all evaluated by the compiler
+static const uint8_t videoModeNext[2][(NIN_VID_MASK >> 16) + 1][NIN_VID_FORCE_MASK + 1] = {
+    VID_TABLE(VID_LEFT),
+    VID_TABLE(VID_RIGHT),
+};
+
+static void editVideoMode(const SETTING *setting, NIN_CFG *cfg, bool right)
+{
+    uint8_t next = videoModeNext[right][(cfg->VideoMode & NIN_VID_MASK) >> 16][cfg->VideoMode & NIN_VID_FORCE_MASK];
+    cfg->VideoMode &= ~(NIN_VID_MASK | NIN_VID_FORCE_MASK); // Delete original settings w/o deleting extended settings
+    cfg->VideoMode |= ((uint32_t)(next >> 4) << 16) | (next & NIN_VID_FORCE_MASK);
+}
+
+static void formatOnOff(const SETTING *setting, const NIN_CFG *cfg, char *out)
+{
+    strcpy(out, (cfg->Config & setting->mask) ? "On" : "Off");
+}
+
+static void formatInt(const SETTING *setting, const NIN_CFG *cfg, char *out)
+{
+    snprintf(out, SETTING_VALUE_SIZE, "%i", getValue(setting, cfg));
+}
+
+static void formatMemcardEmu(const SETTING *setting, const NIN_CFG *cfg, char *out)
+{
+    strcpy(out, (cfg->Config & NIN_CFG_MEMCARDEMU) ? ((cfg->Config & NIN_CFG_MC_MULTI) ? "Multi" : "Single") : "Off");
+}
+
+static void formatMemcardSize(const SETTING *setting, const NIN_CFG *cfg, char *out)
+{
+    if(!validRange(setting, cfg))
+    {
+        strcpy(out, "Invalid");
+        return;
+    }
+
+    uint32_t size = MEM_CARD_SIZE(cfg->MemCardBlocks);
+    const char *suffix;
+    if(size >= 1024)
+    {
+        size >>= 10;
+        if(size >= 1024)
+        {
+            size >>= 10;
+            suffix = "MB";
+        }
+        else
+            suffix = "KB";
+    }
+    else
+        suffix = "B";
+
+    snprintf(out, SETTING_VALUE_SIZE, "%u%s (%u blocks)", size, suffix, MEM_CARD_BLOCKS(cfg->MemCardBlocks));
+}
+
+static void formatLanguage(const SETTING *setting, const NIN_CFG *cfg, char *out)
+{
+    strcpy(out, validRange(setting, cfg) ? languages[cfg->Language] : "Invalid");
+}
+
+static void formatVideoMode(const SETTING *setting, const NIN_CFG *cfg, char *out)
+{
+    if(!validVideoMode(setting, cfg))
+    {
+        strcpy(out, "Invalid");
+        return;
+    }
+
+    uint32_t vidMask = cfg->VideoMode >> 16;
+    if(vidMask & (NIN_VID_INDEX_FORCE | NIN_VID_INDEX_FORCE_DF))
+        snprintf(out, SETTING_VALUE_SIZE, "%s %s", VideoStrings[vidMask], VideoModeStrings[ncfgForceIndex(cfg->VideoMode)]);
+    else
+        snprintf(out, SETTING_VALUE_SIZE, "%s", VideoStrings[vidMask]);
+}
+
+static void formatGamepadSlot(const SETTING *setting, const NIN_CFG *cfg, char *out)
+{
+    if(cfg->WiiUGamepadSlot < NIN_CFG_MAXPAD)
+        snprintf(out, SETTING_VALUE_SIZE, "%u", cfg->WiiUGamepadSlot + 1);
+    else
+        strcpy(out, validRange(setting, cfg) ? "None" : "Invalid");
+}
+
+static int32_t slotFlag(const SETTING *setting, const NIN_CFG *cfg)
+{
+    if(cfg == NULL)
+        return 2;
+
+    return (cfg->Config & setting->mask) ? 1 : 0;
+}
+
+static int32_t slotMemcardEmu(const SETTING *setting, const NIN_CFG *cfg)
+{
+    if(cfg == NULL)
+        return 3;
+
+    return (cfg->Config & NIN_CFG_MEMCARDEMU) ? ((cfg->Config & NIN_CFG_MC_MULTI) ? 2 : 1) : 0;
+}
+
+static int32_t slotRange(const SETTING *setting, const NIN_CFG *cfg)
+{
+    if(cfg == NULL)
+        return (setting->max - setting->min) / setting->step + 1;
+
+    int32_t value = getValue(setting, cfg) - setting->min;
+    if(!validRange(setting, cfg) || value % setting->step)
+        return -1;
+
+    return value / setting->step;
+}
+
+// Slot 0 is VIDEO_SCALE_AUTO
+static int32_t slotRangeAuto(const SETTING *setting, const NIN_CFG *cfg)
+{
+    if(cfg != NULL && getValue(setting, cfg) == VIDEO_SCALE_AUTO)
+        return 0;
+
+    int32_t slot = slotRange(setting, cfg);
+    return slot < 0 ? -1 : slot + 1;
+}
+
+// Auto, None, then all forced modes and all forced modes with deflicker
+static int32_t slotVideoMode(const SETTING *setting, const NIN_CFG *cfg)
+{
+    if(cfg == NULL)
+        return 2 + (NIN_VID_INDEX_FORCE_MPAL + 1) * 2;
+    if(!validVideoMode(setting, cfg))
+        return -1;
+
+    int32_t force = ncfgForceIndex(cfg->VideoMode);
+    switch(cfg->VideoMode >> 16)
+    {
+        case NIN_VID_INDEX_AUTO:
+            return 0;
+        case NIN_VID_INDEX_NONE:
+            return 1;
+        case NIN_VID_INDEX_FORCE:
+            return 2 + force;
+        default: // NIN_VID_INDEX_FORCE_DF
+            return 2 + NIN_VID_INDEX_FORCE_MPAL + 1 + force;
+    }
+}
+
+void settingsInit()
+{
+    memset(poolLength, 0, sizeof(poolLength));
+    uint32_t base = 0;
+    for(poolSettings = 0; poolSettings < SETTINGS_COUNT; ++poolSettings)
+    {
+        const SETTING *setting = settings + poolSettings;
+        uint32_t slots = setting->slot(setting, NULL);
+        if(base + slots > SETTING_POOL_SIZE)
+            return; // Not cached, settingText() returns NULL for these
+
+        poolBase[poolSettings] = base;
+
+        // Walk through the values like the UI would, starting at all zero which is valid for every option
+        NIN_CFG cfg;
+        memset(&cfg, 0, sizeof(NIN_CFG));
+        for(int n = 0; n < SETTING_MAX_VALUES; ++n)
+        {
+            int32_t slot = setting->slot(setting, &cfg);
+            if(slot >= 0 && poolLength[base + slot] == 0)
+            {
+                setting->format(setting, &cfg, pool[base + slot]);
+                poolLength[base + slot] = strlen(pool[base + slot]);
+            }
+
+            setting->edit(setting, &cfg, true);
+        }
+
+        base += slots;
+    }
+}
+
+const char *settingText(const NIN_CFG *cfg, uint32_t index, size_t *len)
+{
+    if(index >= poolSettings)
+        return NULL;
+
+    const SETTING *setting = settings + index;
+    int32_t slot = setting->slot(setting, cfg);
+    if(slot < 0)
+        return NULL;
+
+    slot += poolBase[index];
+    if(poolLength[slot] == 0)
+        return NULL;
+
+    *len = poolLength[slot];
+    return pool[slot];
+}
+
+int settingFind(const char *name)
+{
+    for(int i = 0; i < SETTINGS_COUNT; ++i)
+        if(strcmp(settings[i].name, name) == 0)
+            return i;
+
+    return -1;
+}
+
+bool settingParse(NIN_CFG *cfg, uint32_t index, const char *value)
+{
+    // Walk through the values like the UI would, so all the side effects of editing are the same. It goes all the
+    // way round unless there's an exact match, as a short form must not fit more than one value.
+    size_t len = strlen(value);
+    NIN_CFG tmp = *cfg;
+    NIN_CFG found;
+    bool matched = false;
+    bool ambiguous = false;
+    char formatted[SETTING_VALUE_SIZE];
+    for(int i = 0; i < SETTING_MAX_VALUES; ++i)
+    {
+        settingFormat(&tmp, index, formatted);
+        if(strncasecmp(formatted, value, len) == 0)
+        {
+            if(formatted[len] == '\0')
+            {
+                *cfg = tmp;
+                return true;
+            }
+
+            // Cut off right before " (", like "16MB" for "16MB (251 blocks)"
+            if(len && strncmp(formatted + len, " (", 2) == 0)
+            {
+                if(matched && !settingEqual(&found, &tmp, index))
+                    ambiguous = true;
+
+                found = tmp;
+                matched = true;
+            }
+        }
+
+        settingEdit(&tmp, index, true);
+    }
+
+    if(!matched || ambiguous)
+        return false;
+
+    *cfg = found;
+    return true;
+}
+
+// The bits of the field which belong to the option
+static uint32_t getBits(const SETTING *setting, const NIN_CFG *cfg)
+{
+    uint32_t value = (uint32_t)getValue(setting, cfg);
+    return setting->mask ? value & setting->mask : value;
+}
+
+bool settingEqual(const NIN_CFG *a, const NIN_CFG *b, uint32_t index)
+{
+    const SETTING *setting = settings + index;
+    return getBits(setting, a) == getBits(setting, b);
+}
+
+// Sets all bits of owned which belong to an option
+static void ownedBits(NIN_CFG *owned)
+{
+    memset(owned, 0, sizeof(NIN_CFG));
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+    {
+        const SETTING *setting = settings + i;
+        setValue(setting, owned, getValue(setting, owned) | (setting->mask ? setting->mask : UINT32_MAX));
+    }
+}
+
+// settingsMerge() for the bits of a field no option owns. Fields options own a part of (Config, VideoMode) hold
+// flags, so each bit counts on its own. Others (GamePath, GameID, ...) only make sense as a whole.
+static void mergeField(NIN_CFG *cfg, const NIN_CFG *base, const NIN_CFG *theirs, const NIN_CFG *owned, size_t offset,
+                       size_t size, uint32_t *taken, uint32_t *conflicts)
+{
+    const uint8_t *own = (const uint8_t *)owned + offset;
+    const uint8_t *old = (const uint8_t *)base + offset;
+    const uint8_t *other = (const uint8_t *)theirs + offset;
+    uint8_t *ours = (uint8_t *)cfg + offset;
+
+    bool flags = false;
+    for(size_t i = 0; i < size; ++i)
+        flags |= own[i] != 0;
+
+    if(!flags)
+    {
+        if(memcmp(other, old, size) == 0 || memcmp(other, ours, size) == 0)
+            return;
+
+        if(memcmp(ours, old, size) != 0)
+            *conflicts |= SETTINGS_MERGE_OTHER;
+        else
+        {
+            memcpy(ours, other, size);
+            *taken |= SETTINGS_MERGE_OTHER;
+        }
+        return;
+    }
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        uint8_t changed = (other[i] ^ old[i]) & ~own[i];
+        uint8_t mine = (ours[i] ^ old[i]) & ~own[i];
+        if(changed & mine & (ours[i] ^ other[i]))
+            *conflicts |= SETTINGS_MERGE_OTHER;
+
+        uint8_t take = changed & ~mine;
+        if(take)
+        {
+            ours[i] = (ours[i] & ~take) | (other[i] & take);
+            *taken |= SETTINGS_MERGE_OTHER;
+        }
+    }
+}
+
+uint32_t settingsMerge(NIN_CFG *cfg, const NIN_CFG *base, const NIN_CFG *theirs, uint32_t *conflicts)
+{
+    uint32_t taken = 0;
+    *conflicts = 0;
+    for(uint32_t i = 0; i < SETTINGS_COUNT; ++i)
+    {
+        const SETTING *setting = settings + i;
+        uint32_t old = getBits(setting, base);
+        uint32_t ours = getBits(setting, cfg);
+        uint32_t other = getBits(setting, theirs);
+        if(other == old || other == ours)
+            continue;
+
+        if(ours != old)
+        {
+            *conflicts |= 1u << i;
+            continue;
+        }
+
+        // Flags share Config and VideoMode with other options
+        int32_t value = getValue(setting, theirs);
+        if(setting->mask)
+            value = (getValue(setting, cfg) & ~setting->mask) | (value & setting->mask);
+
+        setValue(setting, cfg, value);
+        taken |= 1u << i;
+    }
+
+    // Everything else, field by field
+    NIN_CFG owned;
+    ownedBits(&owned);
+#define MERGE_FIELD(x) mergeField(cfg, base, theirs, &owned, offsetof(NIN_CFG, x), sizeof(((NIN_CFG *)0)->x), &taken, conflicts);
+    NCFG_LAYOUT(MERGE_FIELD, MERGE_FIELD)
+#undef MERGE_FIELD
+
+    return taken;
+}
+
+const SETTING settings[SETTINGS_COUNT] = {
+    {
+        .name = "memcard",
+        .label = "Memcard emulation:",
+        .info = "Emulate memory card (you want this to be \"Single\")",
+        FIELD(Config),
+        .mask = NIN_CFG_MEMCARDEMU | NIN_CFG_MC_MULTI,
+        .edit = editMemcardEmu,
+        .valid = validAlways,
+        .format = formatMemcardEmu,
+        .slot = slotMemcardEmu,
+    },
+    {
+        .name = "memcard_size",
+        .label = "Memcard size:",
+        .info = "Size of the emulated memory card",
+        FIELD(MemCardBlocks),
+        .min = 0,
+        .max = MEM_CARD_MAX,
+        .step = 1,
+        .edit = editRange,
+        .valid = validRange,
+        .format = formatMemcardSize,
+        .slot = slotRange,
+    },
+    {
+        .name = "widescreen",
+        .label = "Force widescreen:",
+        .info = "Force 16:9 widescreen for 4:3 games",
+        FIELD(Config),
+        .mask = NIN_CFG_FORCE_WIDE | NIN_CFG_WIIU_WIDE, // Keep in sync with NIN_CFG_WIIU_WIDE
+        .edit = editFlag,
+        .valid = validAlways,
+        .format = formatOnOff,
+        .slot = slotFlag,
+    },
+    {
+        .name = "progressive",
+        .label = "Force progressive:",
+        .info = "Force progressive for inerlaced games",
+        FIELD(Config),
+        .mask = NIN_CFG_FORCE_PROG,
+        .edit = editProgressive,
+        .valid = validAlways,
+        .format = formatOnOff,
+        .slot = slotFlag,
+    },
+    {
+        .name = "remove_read_limit",
+        .label = "Remove read limit:",
+        .info = "Allows to read faster than a GCN disc drive",
+        FIELD(Config),
+        .mask = NIN_CFG_REMLIMIT,
+        .edit = editFlag,
+        .valid = validAlways,
+        .format = formatOnOff,
+        .slot = slotFlag,
+    },
+    {
+        .name = "arcade_mode",
+        .label = "Arcade mode:",
+        .info = "Move the C stick to insert coins",
+        FIELD(Config),
+        .mask = NIN_CFG_ARCADE_MODE,
+        .edit = editFlag,
+        .valid = validAlways,
+        .format = formatOnOff,
+        .slot = slotFlag,
+    },
+    {
+        .name = "cc_rumble",
+        .label = "Wiimote CC rumble:",
+        .info = "Rumble the wiimote with classic or pro controller",
+        FIELD(Config),
+        .mask = NIN_CFG_CC_RUMBLE,
+        .edit = editFlag,
+        .valid = validAlways,
+        .format = formatOnOff,
+        .slot = slotFlag,
+    },
+    {
+        .name = "skip_ipl",
+        .label = "Skip IPL:",
+        .info = "Skip loading the IPL",
+        FIELD(Config),
+        .mask = NIN_CFG_SKIP_IPL,
+        .edit = editFlag,
+        .valid = validAlways,
+        .format = formatOnOff,
+        .slot = slotFlag,
+    },
+    {
+        .name = "language",
+        .label = "Language:",
+        .info = "Game language (only for PAL)",
+        FIELD(Language),
+        .min = 0,
+        .max = NIN_LAN_LAST,
+        .step = 1,
+        .edit = editRange,
+        .valid = validRange,
+        .format = formatLanguage,
+        .slot = slotRange,
+    },
+    {
+        .name = "video_mode",
+        .label = "Video mode:",
+        .info = "The video mode the game renders",
+        FIELD(VideoMode),
+        .mask = NIN_VID_MASK | NIN_VID_FORCE_MASK,
+        .edit = editVideoMode,
+        .valid = validVideoMode,
+        .format = formatVideoMode,
+        .slot = slotVideoMode,
+    },
+    {
+        .name = "video_scale",
+        .label = "Video scale:",
+        .info = "Video scaling. Set to \"Auto\" or \"104\"",
+        FIELD(VideoScale),
+        .min = 40,
+        .max = 120,
+        .step = 2,
+        .edit = editRangeAuto,
+        .valid = validRangeAuto,
+        .format = formatInt,
+        .slot = slotRangeAuto,
+    },
+    {
+        .name = "video_offset",
+        .label = "Video offset:",
+        .info = "The offset. You want this to be 0",
+        FIELD(VideoOffset),
+        .min = -20,
+        .max = 20,
+        .step = 1,
+        .edit = editRange,
+        .valid = validRange,
+        .format = formatInt,
+        .slot = slotRange,
+    },
+    {
+        .name = "gamepad_slot",
+        .label = "Wii U gamepad slot:",
+        .info = "The controller the gamepad replaces",
+        FIELD(WiiUGamepadSlot),
+        .min = 0,
+        .max = NIN_CFG_MAXPAD,
+        .step = 1,
+        .edit = editRange,
+        .valid = validRange,
+        .format = formatGamepadSlot,
+        .slot = slotRange,
+    },
+};
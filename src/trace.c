@@ -0,0 +1,149 @@
+/***************************************************************************
+ * This file is part of Nincfg.                                            *
+ * Copyright (c) 2023 V10lator <v10lator@myway.de>                         *
+ *                                                                         *
+ * This program is free software; you can redistribute it and/or modify    *
+ * it under the terms of the GNU General Public License as published by    *
+ * the Free Software Foundation; either version 3 of the License, or       *
+ * (at your option) any later version.                                     *
+ *                                                                         *
+ * This program is distributed in the hope that it will be useful,         *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of          *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the           *
+ * GNU General Public License for more details.                            *
+ *                                                                         *
+ * You should have received a copy of the GNU General Public License along *
+ * with this program; if not, If not, see <http://www.gnu.org/licenses/>.  *
+ ***************************************************************************/
+
+#include <trace.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *const traceStageNames[TRACE_STAGES] = {
+    [TRACE_PROCUI] = "procui",
+    [TRACE_INPUT] = "input",
+    [TRACE_UPDATE] = "update",
+    [TRACE_SAVE] = "save",
+    [TRACE_DRAW] = "draw",
+    [TRACE_SLEEP] = "sleep",
+};
+
+void traceInit(TRACE *trace, uint64_t ticksPerSecond, uint64_t now)
+{
+    memset(trace, 0, sizeof(TRACE));
+    trace->ticksPerSecond = ticksPerSecond;
+    trace->current.start = trace->last = now;
+}
+
+uint32_t traceCopy(const TRACE *trace, TRACE_FRAME *out)
+{
+    uint32_t head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+    uint32_t count = head < TRACE_FRAMES ? head : TRACE_FRAMES;
+    for(uint32_t i = 0; i < count; ++i)
+        out[i] = trace->frames[(head - count + i) & (TRACE_FRAMES - 1)];
+
+    return count;
+}
+
+static uint64_t toNanoseconds(uint64_t ticks, uint64_t ticksPerSecond)
+{
+    return ticks / ticksPerSecond * 1000000000ull + ticks % ticksPerSecond * 1000000000ull / ticksPerSecond;
+}
+
+static uint32_t frameTicks(const TRACE_FRAME *frame)
+{
+    uint64_t total = 0;
+    for(uint32_t i = 0; i < TRACE_STAGES; ++i)
+        total += frame->ticks[i];
+
+    return total > UINT32_MAX ? UINT32_MAX : (uint32_t)total;
+}
+
+// Adds to out like snprintf() but never past size - 1
+static size_t append(char *out, size_t size, size_t len, const char *format, ...) __attribute__((format(printf, 4, 5)));
+static size_t append(char *out, size_t size, size_t len, const char *format, ...)
+{
+    if(len + 1 >= size)
+        return len;
+
+    va_list va;
+    va_start(va, format);
+    int ret = vsnprintf(out + len, size - len, format, va);
+    va_end(va);
+
+    if(ret < 0)
+        return len;
+
+    len += ret;
+    return len < size ? len : size - 1;
+}
+
+size_t traceWriteCsv(const TRACE_FRAME *frames, uint32_t count, uint64_t ticksPerSecond, char *out, size_t size)
+{
+    size_t len = append(out, size, 0, "frame,start_ns");
+    for(uint32_t s = 0; s < TRACE_STAGES; ++s)
+        len = append(out, size, len, ",%s_ns", traceStageNames[s]);
+    len = append(out, size, len, ",total_ns,presses\n");
+
+    uint64_t base = count ? frames[0].start : 0;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+        const TRACE_FRAME *frame = frames + i;
+        len = append(out, size, len, "%u,%llu", i, (unsigned long long)toNanoseconds(frame->start - base, ticksPerSecond));
+        for(uint32_t s = 0; s < TRACE_STAGES; ++s)
+            len = append(out, size, len, ",%llu", (unsigned long long)toNanoseconds(frame->ticks[s], ticksPerSecond));
+        len = append(out, size, len, ",%llu,%u\n", (unsigned long long)toNanoseconds(frameTicks(frame), ticksPerSecond), frame->presses);
+    }
+
+    return len;
+}
+
+static int compareTicks(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest rank
+static uint32_t percentile(const uint32_t *sorted, uint32_t count, uint32_t p)
+{
+    uint32_t rank = (count * p + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+size_t traceWriteStats(const TRACE_FRAME *frames, uint32_t count, uint64_t ticksPerSecond, char *out, size_t size)
+{
+    static uint32_t sorted[TRACE_FRAMES];
+    size_t len = append(out, size, 0, "stage,p50_us,p99_us,max_us,mean_us\n");
+    if(count == 0)
+        return len;
+
+    if(count > TRACE_FRAMES)
+        count = TRACE_FRAMES;
+
+    for(uint32_t s = 0; s <= TRACE_STAGES; ++s)
+    {
+        uint64_t total = 0;
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            sorted[i] = s == TRACE_STAGES ? frameTicks(frames + i) : frames[i].ticks[s];
+            total += sorted[i];
+        }
+
+        qsort(sorted, count, sizeof(uint32_t), compareTicks);
+        unsigned long long p50 = toNanoseconds(percentile(sorted, count, 50), ticksPerSecond);
+        unsigned long long p99 = toNanoseconds(percentile(sorted, count, 99), ticksPerSecond);
+        unsigned long long max = toNanoseconds(sorted[count - 1], ticksPerSecond);
+        unsigned long long mean = toNanoseconds(total / count, ticksPerSecond);
+        len = append(out, size, len, "%s,%llu.%03llu,%llu.%03llu,%llu.%03llu,%llu.%03llu\n",
+                     s == TRACE_STAGES ? "frame" : traceStageNames[s],
+                     p50 / 1000, p50 % 1000, p99 / 1000, p99 % 1000, max / 1000, max % 1000, mean / 1000, mean % 1000);
+    }
+
+    return len;
+}